@@ -0,0 +1,31 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <chrono>
+
+// Runs func once to warm up, then times it and prints the average
+template <typename F>
+inline double benchmark(string name, int iterations, F func)
+{
+    func();
+
+    auto start = chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        func();
+    }
+
+    auto end = chrono::high_resolution_clock::now();
+    double ms = chrono::duration<double, milli>(end - start).count() / iterations;
+
+    cout << "  " << name << ": " << ms << " ms\n";
+    return ms;
+}
+
+void runTransformBenchmark();
+void runTriangulateBenchmark();
+void runMeshBenchmark();
+void runAssetBenchmark();
+void runDrawContextBenchmark();
@@ -0,0 +1,109 @@
+#include "Benchmark.hpp"
+#include "MeshAsset.hpp"
+
+#include <filesystem>
+#include <numbers>
+
+static vector<vec2> star(size_t tips, float outer, float inner)
+{
+    vector<vec2> points;
+    for (size_t i = 0; i < tips * 2; i++)
+    {
+        float a = i * numbers::pi_v<float> / tips;
+        points.push_back(vec2(cos(a), sin(a)) * (i % 2 == 0 ? outer : inner));
+    }
+
+    return points;
+}
+
+static vector<vec2> circle(size_t sides, float radius, vec2 center)
+{
+    vector<vec2> points;
+    for (size_t i = 0; i < sides; i++)
+    {
+        float a = i * 2 * numbers::pi_v<float> / sides;
+        points.push_back(center + vec2(cos(a), sin(a)) * radius);
+    }
+
+    return points;
+}
+
+void runAssetBenchmark()
+{
+    struct Polygon
+    {
+        vector<vec2> outline;
+        vector<vector<vec2>> holes;
+    };
+
+    // Simple, concave and holed polygons of different sizes, like a level's worth of shapes
+    vector<Polygon> corpus;
+    for (int i = 0; i < 300; i++)
+    {
+        size_t size = 8 << (i % 5);
+
+        switch (i % 3)
+        {
+        case 0:
+            corpus.push_back({ circle(size, 100, vec2(0)) });
+            break;
+        case 1:
+            corpus.push_back({ star(size / 2, 100, 40) });
+            break;
+        default:
+            corpus.push_back({ circle(size, 100, vec2(0)), { circle(size / 2, 20, vec2(-40, 0)), circle(size / 2, 20, vec2(40, 0)) } });
+            break;
+        }
+    }
+
+    auto path = (filesystem::temp_directory_path() / "VulkanEngineBenchmark.mesh").string();
+
+    vector<MeshData> meshes;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+
+    for (size_t i = 0; i < corpus.size(); i++)
+    {
+        auto mesh = buildPolygonMesh("polygon" + to_string(i), corpus[i].outline, corpus[i].holes);
+        prepareMesh(mesh.vertices, mesh.indices);
+
+        vertexBytes += mesh.vertices.size() * sizeof(BasicVertex);
+        indexBytes += mesh.indices.size() * sizeof(uint32_t);
+        meshes.push_back(std::move(mesh));
+    }
+
+    writeMeshFile(path, meshes);
+
+    // Stands in for the staging buffer
+    vector<uint8_t> staging(vertexBytes + indexBytes);
+
+    cout << "Mesh loading (" << corpus.size() << " polygons, " << filesystem::file_size(path) << " byte file)\n";
+
+    auto runtimeTime = benchmark("triangulate at runtime", 20, [&]()
+    {
+        size_t offset = 0;
+
+        for (const auto& i : corpus)
+        {
+            auto mesh = buildPolygonMesh("", i.outline, i.holes);
+
+            memcpy(staging.data() + offset, mesh.vertices.data(), mesh.vertices.size() * sizeof(BasicVertex));
+            offset += mesh.vertices.size() * sizeof(BasicVertex);
+            memcpy(staging.data() + offset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+            offset += mesh.indices.size() * sizeof(uint32_t);
+        }
+    });
+
+    auto mappedTime = benchmark("mapped mesh file", 20, [&]()
+    {
+        MeshFile file(path);
+        auto& header = file.getHeader();
+
+        memcpy(staging.data(), file.getVertexData(), header.vertexBytes);
+        memcpy(staging.data() + header.vertexBytes, file.getIndexData(), header.indexBytes);
+    });
+
+    cout << "  mapped speedup: " << runtimeTime / mappedTime << "x\n";
+
+    filesystem::remove(path);
+}
@@ -0,0 +1,95 @@
+#include "Benchmark.hpp"
+#include "DrawContext.hpp"
+
+#include <mutex>
+#include <thread>
+
+// Total draws per frame, split between the threads
+constexpr int DRAWS = 200000;
+
+static void produce(DrawContext& context, int first, int count, const vector<vec2>& line)
+{
+    for (int i = first; i < first + count; i++)
+    {
+        context.drawRoundedRectangle(i % 1000, i / 1000, 10, 10, 3, i * 0.01f, { 1, 1, 1, 1 }, static_cast<float>(i % 4));
+
+        if (i % 32 == 0)
+        {
+            context.drawPolyline(line, {}, { 1, 0, 0, 1 });
+        }
+    }
+}
+
+// Starts the threads and waits for them, like a frame would
+template <typename F>
+static void runThreads(int threads, F func)
+{
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back(func, t);
+    }
+
+    for (auto& i : workers)
+    {
+        i.join();
+    }
+}
+
+void runDrawContextBenchmark()
+{
+    vector<vec2> line = { { 0, 0 }, { 10, 5 }, { 20, 0 }, { 30, 5 } };
+    int maxThreads = std::max(1u, thread::hardware_concurrency());
+
+    cout << "Draw recording (" << DRAWS << " shapes per frame)\n";
+
+    double single = 0;
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        auto per = DRAWS / threads;
+
+        // One context per thread, nothing shared until the merge
+        vector<DrawContext> contexts(threads, DrawContext(nullptr));
+
+        auto contextTime = benchmark("contexts, " + to_string(threads) + " threads", 10, [&]()
+        {
+            for (auto& i : contexts)
+            {
+                i.clear();
+            }
+
+            runThreads(threads, [&](int t) { produce(contexts[t], t * per, per, line); });
+        });
+
+        // What funnelling every draw through one lock looks like
+        DrawContext shared(nullptr);
+        mutex lock;
+
+        auto mutexTime = benchmark("mutex, " + to_string(threads) + " threads", 10, [&]()
+        {
+            shared.clear();
+
+            runThreads(threads, [&](int t)
+            {
+                for (int i = t * per; i < (t + 1) * per; i++)
+                {
+                    lock_guard guard(lock);
+                    shared.drawRoundedRectangle(i % 1000, i / 1000, 10, 10, 3, i * 0.01f, { 1, 1, 1, 1 }, static_cast<float>(i % 4));
+
+                    if (i % 32 == 0)
+                    {
+                        shared.drawPolyline(line, {}, { 1, 0, 0, 1 });
+                    }
+                }
+            });
+        });
+
+        if (threads == 1)
+        {
+            single = contextTime;
+        }
+
+        cout << "  scaling: " << single / contextTime << "x, " << mutexTime / contextTime << "x over the mutex\n";
+    }
+}
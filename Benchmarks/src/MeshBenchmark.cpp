@@ -0,0 +1,55 @@
+#include "Benchmark.hpp"
+#include "Mesh.hpp"
+
+#include <random>
+
+// Grid of quads with every triangle given its own vertices, in random order. About what
+// a mesh looks like coming out of a tool that doesn't index.
+static void makeGrid(int size, vector<BasicVertex>& vertices, vector<uint32_t>& indices)
+{
+    vector<array<BasicVertex, 3>> triangles;
+
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            BasicVertex a(x, y), b(x + 1, y), c(x + 1, y + 1), d(x, y + 1);
+            triangles.push_back({ a, b, c });
+            triangles.push_back({ a, c, d });
+        }
+    }
+
+    shuffle(triangles.begin(), triangles.end(), mt19937(1));
+
+    vertices.clear();
+    indices.clear();
+
+    for (auto& i : triangles)
+    {
+        for (auto& v : i)
+        {
+            indices.push_back(static_cast<uint32_t>(vertices.size()));
+            vertices.push_back(v);
+        }
+    }
+}
+
+void runMeshBenchmark()
+{
+    for (int size : { 32, 128, 512 })
+    {
+        vector<BasicVertex> vertices;
+        vector<uint32_t> indices;
+        MeshReport report;
+
+        cout << "Mesh preparation (" << size * size * 2 << " triangles)\n";
+
+        benchmark("prepareMesh", 5, [&]()
+        {
+            makeGrid(size, vertices, indices);
+            report = prepareMesh(vertices, indices);
+        });
+
+        cout << "  " << describe(report) << "\n";
+    }
+}
@@ -0,0 +1,41 @@
+#include "Benchmark.hpp"
+#include "TransformBatch.hpp"
+
+void runTransformBenchmark()
+{
+    const size_t count = 100000;
+
+    TransformBatch batch;
+    batch.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        batch.push(i % 800, i % 600, 10 + i % 50, 10 + i % 30, i * 0.01f, { 1, 1, 1, 1 });
+    }
+
+    vector<mat4> matrices(count);
+    vector<Instance2D> instances(count);
+
+    cout << "Transforms (" << count << " instances)\n";
+
+    // What Renderer::getNewUBO does for every draw
+    auto glmTime = benchmark("glm mat4", 50, [&]()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            matrices[i] = translate(mat4(1), vec3(batch.x[i], batch.y[i], 0)) * rotate(mat4(1), batch.rotation[i], vec3(0, 0, 1)) * scale(mat4(1), vec3(batch.width[i], batch.height[i], 0));
+        }
+    });
+
+    auto scalarTime = benchmark("scalar affine", 50, [&]()
+    {
+        buildInstancesScalar(batch.x.data(), batch.y.data(), batch.width.data(), batch.height.data(), batch.rotation.data(), batch.color.data(), count, instances.data());
+    });
+
+    auto simdTime = benchmark("simd affine", 50, [&]()
+    {
+        buildInstances(batch, instances.data());
+    });
+
+    cout << "  simd speedup: " << glmTime / simdTime << "x over glm, " << scalarTime / simdTime << "x over scalar\n";
+}
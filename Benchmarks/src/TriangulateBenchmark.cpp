@@ -0,0 +1,131 @@
+#include "Benchmark.hpp"
+#include "Triangulate.hpp"
+
+#include <numbers>
+
+static vector<vec2> regularPolygon(size_t sides, float radius)
+{
+    vector<vec2> points;
+    for (size_t i = 0; i < sides; i++)
+    {
+        float a = i * 2 * numbers::pi_v<float> / sides;
+        points.push_back(vec2(cos(a), sin(a)) * radius);
+    }
+
+    return points;
+}
+
+static vector<vec2> star(size_t tips, float outer, float inner)
+{
+    vector<vec2> points;
+    for (size_t i = 0; i < tips * 2; i++)
+    {
+        float a = i * numbers::pi_v<float> / tips;
+        points.push_back(vec2(cos(a), sin(a)) * (i % 2 == 0 ? outer : inner));
+    }
+
+    return points;
+}
+
+// Teeth pointing up from a bar, lots of reflex vertices
+static vector<vec2> comb(size_t teeth)
+{
+    vector<vec2> points = { { 0, 0 }, { teeth * 2.0f, 0 } };
+    for (size_t i = teeth; i > 0; i--)
+    {
+        float x = i * 2.0f;
+        points.insert(points.end(), { { x, 4 }, { x - 1, 4 }, { x - 1, 1 } });
+        points.push_back({ x - 2, 1 });
+    }
+
+    return points;
+}
+
+static void runCase(const string& name, const vector<vec2>& points, int iterations)
+{
+    vector<uint32_t> indices;
+    vector<vec2> added;
+    indices.reserve(points.size() * 3);
+
+    vector<pair<uint32_t, uint32_t>> edges;
+    for (uint32_t i = 0; i < points.size(); i++)
+    {
+        edges.emplace_back(i, static_cast<uint32_t>((i + 1) % points.size()));
+    }
+
+    cout << name << " (" << points.size() << " points)\n";
+
+    if (isConvex(points.data(), points.size()))
+    {
+        benchmark("fan", iterations, [&]()
+        {
+            indices.clear();
+            triangulateFan(points.size(), indices);
+        });
+    }
+
+    indices.clear();
+    if (triangulateEarClip(points.data(), points.size(), indices))
+    {
+        benchmark("ear clip", iterations, [&]()
+        {
+            indices.clear();
+            triangulateEarClip(points.data(), points.size(), indices);
+        });
+    }
+
+    benchmark("cdt", iterations, [&]()
+    {
+        indices.clear();
+        triangulateCDT(points.data(), points.size(), edges, indices, added);
+    });
+
+    benchmark("auto", iterations, [&]()
+    {
+        indices.clear();
+        triangulatePolygon(points.data(), points.size(), indices, added);
+    });
+}
+
+void runTriangulateBenchmark()
+{
+    cout << "Triangulation\n";
+
+    for (size_t sides : { 4, 16, 64, 256 })
+    {
+        runCase("convex", regularPolygon(sides, 100), 1000);
+    }
+
+    for (size_t tips : { 5, 16, 32, 128 })
+    {
+        runCase("star", star(tips, 100, 40), 1000);
+    }
+
+    for (size_t teeth : { 4, 16, 64 })
+    {
+        runCase("comb", comb(teeth), 1000);
+    }
+
+    vector<uint32_t> indices;
+    vector<vec2> added;
+    auto outline = regularPolygon(64, 100);
+    vector<vector<vec2>> holes;
+
+    for (int i = 0; i < 4; i++)
+    {
+        auto hole = regularPolygon(16, 15);
+        for (auto& p : hole)
+        {
+            p += vec2(i % 2 == 0 ? -40 : 40, i < 2 ? -40 : 40);
+        }
+
+        holes.push_back(hole);
+    }
+
+    cout << "holes (64 point outline, 4 holes)\n";
+    benchmark("cdt", 1000, [&]()
+    {
+        indices.clear();
+        triangulatePolygon(outline, holes, {}, indices, added);
+    });
+}
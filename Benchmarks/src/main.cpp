@@ -0,0 +1,10 @@
+#include "Benchmark.hpp"
+
+int main()
+{
+    runTransformBenchmark();
+    runTriangulateBenchmark();
+    runMeshBenchmark();
+    runAssetBenchmark();
+    runDrawContextBenchmark();
+}
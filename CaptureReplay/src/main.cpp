@@ -0,0 +1,158 @@
+#include "FrameCapture.hpp"
+#include "Renderer.hpp"
+
+#include <chrono>
+
+// Frames drawn before timing starts, so pipelines, caches and pools are warm like they were
+// in the app
+constexpr int WARMUP_LOOPS = 1;
+
+struct Timings
+{
+    double average;
+    double median;
+    double p99;
+    double max;
+};
+
+static Timings summarize(vector<double> samples)
+{
+    if (samples.empty())
+    {
+        return {};
+    }
+
+    sort(samples.begin(), samples.end());
+
+    double total = 0;
+    for (auto i : samples)
+    {
+        total += i;
+    }
+
+    auto percentile = [&](double p) { return samples[static_cast<size_t>(p * (samples.size() - 1))]; };
+    return { total / samples.size(), percentile(0.5), percentile(0.99), samples.back() };
+}
+
+static void print(const string& name, const Timings& timings)
+{
+    cout << "  " << name << ": " << timings.average << " ms average, " << timings.median << " median, " << timings.p99 << " p99, " << timings.max << " max\n";
+}
+
+// Draws a file written by FrameCapture again in a hidden window, in a loop, and prints
+// how long the frames took. Without a frame number every captured frame is drawn in
+// order each loop.
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 4)
+    {
+        cout << "Usage: CaptureReplay <capture.vecf> [loops] [frame]\n";
+        return 1;
+    }
+
+    try
+    {
+        auto replay = make_unique<FrameReplay>(argv[1]);
+        int loops = argc > 2 ? stoi(argv[2]) : 100;
+
+        size_t first = 0;
+        size_t count = replay->getFrameCount();
+
+        if (argc > 3)
+        {
+            first = stoul(argv[3]);
+            count = 1;
+
+            if (first >= replay->getFrameCount())
+            {
+                throw std::runtime_error("The capture only has " + to_string(replay->getFrameCount()) + " frames");
+            }
+        }
+
+        glfwInit();
+
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        // The renderer always presents, so it needs a surface, but nobody has to see it
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        auto extent = replay->getExtent(first);
+        auto window = glfwCreateWindow(extent.width, extent.height, "CaptureReplay", nullptr, nullptr);
+
+        if (!window)
+        {
+            throw std::runtime_error("Could not create a window");
+        }
+
+        auto renderer = make_unique<Renderer>("CaptureReplay", window, replay->getSettings());
+        renderer->enableDebugLogs = false;
+        replay->prepare(renderer.get());
+
+        vector<double> cpuTimes;
+        vector<double> gpuTimes;
+        uint64_t drawCalls = 0;
+
+        for (int loop = -WARMUP_LOOPS; loop < loops; loop++)
+        {
+            for (size_t i = first; i < first + count; i++)
+            {
+                glfwPollEvents();
+
+                // Includes waiting for a free frame in flight, so a GPU bound capture shows up
+                // here too
+                auto start = chrono::steady_clock::now();
+
+                renderer->beginFrame();
+                replay->drawFrame(i);
+                renderer->endFrame();
+
+                if (loop < 0)
+                {
+                    continue;
+                }
+
+                cpuTimes.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+
+                // From an earlier frame the GPU finished, which is just as representative
+                if (renderer->timestampsSupported && renderer->stats.gpuTime > 0)
+                {
+                    gpuTimes.push_back(renderer->stats.gpuTime);
+                }
+
+                drawCalls += renderer->stats.drawCalls;
+            }
+        }
+
+        renderer->stop();
+
+        cout << argv[1] << ": " << count << " of " << replay->getFrameCount() << " frames, " << extent.width << "x" << extent.height << ", " << loops << " loops\n";
+        print("frame", summarize(cpuTimes));
+
+        if (!gpuTimes.empty())
+        {
+            print("GPU", summarize(gpuTimes));
+        }
+
+        if (!cpuTimes.empty())
+        {
+            cout << "  " << drawCalls / cpuTimes.size() << " draw calls per frame\n";
+        }
+
+        if (replay->getSkipped() > 0)
+        {
+            cout << "  " << replay->getSkipped() << " draws skipped over all loops, for missing fonts, model geometry or GPU scene support\n";
+        }
+
+        // Everything the replay made has to go before the device does
+        replay = nullptr;
+        renderer = nullptr;
+
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+    catch (const std::exception& e)
+    {
+        cout << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,138 @@
+#include "MeshAsset.hpp"
+#include "JobSystem.hpp"
+
+#include <sstream>
+
+// Polygon source format, one command per line:
+//   mesh <name>           starts a mesh
+//   outline x y x y ...   the mesh's outline
+//   hole x y x y ...      any number of holes
+//   edge a b              extra constraint edge, numbered like triangulatePolygon
+// Lines starting with # are comments.
+struct PolygonSource
+{
+    string name;
+    vector<vec2> outline;
+    vector<vector<vec2>> holes;
+    vector<pair<uint32_t, uint32_t>> edges;
+};
+
+static vector<vec2> readPoints(istringstream& line)
+{
+    vector<vec2> points;
+    float x, y;
+
+    while (line >> x >> y)
+    {
+        points.push_back(vec2(x, y));
+    }
+
+    return points;
+}
+
+static vector<PolygonSource> readPolygons(const string& path)
+{
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not read file: " + path);
+    }
+
+    vector<PolygonSource> polygons;
+    string text;
+    int lineNumber = 0;
+
+    while (getline(file, text))
+    {
+        lineNumber++;
+
+        istringstream line(text);
+        string command;
+
+        if (!(line >> command) || command[0] == '#')
+        {
+            continue;
+        }
+
+        if (command == "mesh")
+        {
+            polygons.push_back({});
+            line >> polygons.back().name;
+            continue;
+        }
+
+        if (polygons.empty())
+        {
+            throw std::runtime_error(path + ":" + to_string(lineNumber) + ": expected a mesh first");
+        }
+
+        auto& polygon = polygons.back();
+
+        if (command == "outline")
+        {
+            polygon.outline = readPoints(line);
+        }
+        else if (command == "hole")
+        {
+            polygon.holes.push_back(readPoints(line));
+        }
+        else if (command == "edge")
+        {
+            uint32_t a, b;
+            line >> a >> b;
+            polygon.edges.emplace_back(a, b);
+        }
+        else
+        {
+            throw std::runtime_error(path + ":" + to_string(lineNumber) + ": unknown command " + command);
+        }
+    }
+
+    return polygons;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        cout << "Usage: MeshConverter <polygons.txt> <output.mesh>\n";
+        return 1;
+    }
+
+    try
+    {
+        auto polygons = readPolygons(argv[1]);
+
+        for (const auto& i : polygons)
+        {
+            if (i.outline.size() < 3)
+            {
+                throw std::runtime_error("Mesh " + i.name + " needs at least 3 outline points");
+            }
+        }
+
+        vector<MeshData> meshes(polygons.size());
+        vector<MeshReport> reports(polygons.size());
+
+        // Meshes don't depend on each other, so they're triangulated in parallel
+        JobSystem jobs;
+        jobs.parallelFor(polygons.size(), [&](size_t i)
+        {
+            meshes[i] = buildPolygonMesh(polygons[i].name, polygons[i].outline, polygons[i].holes, polygons[i].edges);
+            reports[i] = prepareMesh(meshes[i].vertices, meshes[i].indices);
+        });
+
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            cout << meshes[i].name << ": " << meshes[i].indices.size() / 3 << " triangles, " << describe(reports[i]) << "\n";
+        }
+
+        writeMeshFile(argv[2], meshes);
+        cout << "Wrote " << meshes.size() << " meshes to " << argv[2] << "\n";
+    }
+    catch (const std::exception& e)
+    {
+        cout << e.what() << "\n";
+        return 1;
+    }
+}
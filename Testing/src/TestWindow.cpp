@@ -12,6 +12,15 @@ void TestWindow::render()
     // renderer->drawRectangle(280, 280, 25, 25, 0, {0, 0, 1, 1});
     // renderer->drawRectangle(300, 300, 50, 50);
     // renderer->drawElipse(0, 100, 50, 50);
+    // renderer->drawRoundedRectangle(400, 100, 120, 80, 16, 0, {1, 0, 0, 1});
+    // renderer->drawRing(600, 300, 100, 60, 6, numbers::pi / 8, {0, 1, 0, 1});
+    // renderer->drawOutline(400, 300, 120, 80, 4, 12);
+    // renderer->drawRectangle(420, 120, 60, 60, 0, {0, 1, 1, 1}, 1); // On top of the red one
+    // renderer->drawText(make_shared<Font>(renderer.get(), "font.ttf", 24), "Hello, world!", 20, 500);
+    // renderer->drawSprite(renderer->registerTexture(Texture::load(renderer.get(), "sprite.png")), 300, 20, 64, 64);
+    // renderer->drawPolyline({ {100, 400}, {200, 450}, {300, 400} }, StrokeStyle{ .width = 4, .join = LineJoin::Round, .cap = LineCap::Round }, {1, 0.5, 0, 1});
+    // vector<BasicVertex> frame = { {0, 0}, {1, 0}, {1, 1}, {0, 1} };
+    // renderer->drawPolygon(frame, { { {0.25, 0.25}, {0.75, 0.25}, {0.75, 0.75}, {0.25, 0.75} } }, 500, 400, 100, 100);
 
     renderer->drawPolygon({ {10, 20}, {30, 40}, {50, 60}, {70, 80}, {90, 100} });
 }
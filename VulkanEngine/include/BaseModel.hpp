@@ -3,14 +3,46 @@
 #include "utils.hpp"
 #include "Renderer.hpp"
 
+#include <atomic>
+
+inline atomic<uint64_t> nextGeometryVersion = 1;
+
 class BaseModel
 {
 protected:
     Renderer* renderer;
 
 public:
+    // Model space bounds (min x, min y, max x, max y), only valid if hasBounds is set
+    vec4 bounds = vec4(0);
+    bool hasBounds = false;
+
+    // Changes whenever the geometry does, and is never shared between models
+    uint64_t geometryVersion = 0;
+    // Rewritten from the CPU when it changes, like DynamicModel
+    bool dynamic = false;
+
     inline BaseModel() {}
 
+    // Positions and indices for FrameCapture. False when the model doesn't keep them.
+    inline virtual bool getGeometry(vector<vec2>& positions, vector<uint32_t>& indices) { return false; }
+
     virtual void bind(vki::CommandBuffer& cmds) = 0;
     virtual void draw(vki::CommandBuffer& cmds) = 0;
+    virtual void drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance) = 0;
 };
+
+template <GenericVertex2D TVertex>
+inline vec4 computeBounds(const vector<TVertex>& vertices)
+{
+    vec2 lo = vec2(numeric_limits<float>::max());
+    vec2 hi = vec2(numeric_limits<float>::lowest());
+
+    for (const auto& i : vertices)
+    {
+        lo = glm::min(lo, vec2(i.pos));
+        hi = glm::max(hi, vec2(i.pos));
+    }
+
+    return vec4(lo, hi);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Shader.hpp"
+
+class Renderer; // Forward declaration
+
+class ComputePipeline
+{
+public:
+    Renderer* renderer;
+
+    vki::DescriptorSetLayout descriptorLayout;
+    vki::PipelineLayout layout;
+    vki::Pipeline handle;
+
+    // Every binding is in set 0, numbered in the order given
+    ComputePipeline(Renderer* renderer, shared_ptr<Shader> shader, vector<vk::DescriptorType> bindings, uint32_t pushConstantSize = 0);
+
+    void bind(vki::CommandBuffer& cmds);
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "utils.hpp"
+
+// Finds the parts of the screen that changed by hashing every draw into the tiles it
+// covers. Each swap chain image remembers the hashes it was last drawn with, so however
+// many frames ago that was, only the tiles that differ from it need redrawing.
+//
+// Bounds are in pixels from the framebuffer's origin (min x, min y, max x, max y).
+class DamageTracker
+{
+    uint32_t columns;
+    uint32_t rows;
+    vk::Extent2D extent;
+
+    // This frame's hashes. 0 is never a hash, so it marks tiles with unknown contents.
+    vector<uint64_t> tiles;
+    // Per swap chain image
+    vector<vector<uint64_t>> images;
+    // What was in the last image presented
+    vector<uint64_t> presented;
+
+    // Tiles the bounds touch, false if none
+    bool getTiles(vec4 bounds, uvec2& min, uvec2& max);
+    // Bounding box of the tiles that differ
+    vk::Rect2D getDifference(const vector<uint64_t>& other);
+
+    static constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+    static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+public:
+    static constexpr uint32_t TILE_SIZE = 64;
+
+    DamageTracker(vk::Extent2D extent, size_t imageCount);
+
+    // Every tile starts from the seed, so anything that changes the whole screen goes in it
+    void beginFrame(uint64_t seed);
+    void add(vec4 bounds, uint64_t hash);
+
+    // Area of the image that doesn't match this frame, with an empty extent if it all does
+    vk::Rect2D getDamage(uint32_t image);
+    // Area that changed since the last frame presented
+    vk::Rect2D getChanged();
+
+    // The image now holds this frame
+    void finishFrame(uint32_t image);
+    // The image was drawn without tracking, so its contents are unknown
+    void invalidate(uint32_t image);
+    // Changed by something that isn't a draw, so every image redraws it
+    void invalidate(vec4 bounds);
+
+    // Hashes the bytes of each value, so leave out anything with padding
+    template <typename... T>
+    static uint64_t hashValues(const T&... values);
+};
+
+template <typename... T>
+inline uint64_t DamageTracker::hashValues(const T&... values)
+{
+    uint64_t hash = FNV_OFFSET;
+
+    auto add = [&hash](const void* data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ static_cast<const uint8_t*>(data)[i]) * FNV_PRIME;
+        }
+    };
+
+    (add(&values, sizeof(T)), ...);
+    return hash;
+}
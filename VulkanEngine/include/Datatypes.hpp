@@ -4,10 +4,18 @@
 
 struct VertexDefinition
 {
-    vk::VertexInputBindingDescription binding;
+    vector<vk::VertexInputBindingDescription> bindings;
     vector<vk::VertexInputAttributeDescription> attributes;
 };
 
+// Combines two definitions, ex. per vertex data with per instance data
+inline VertexDefinition operator+(VertexDefinition a, const VertexDefinition& b)
+{
+    a.bindings.insert(a.bindings.end(), b.bindings.begin(), b.bindings.end());
+    a.attributes.insert(a.attributes.end(), b.attributes.begin(), b.attributes.end());
+    return a;
+}
+
 template <typename T>
 concept GenericVertex2D = requires(T x) {
     x.pos;
@@ -22,9 +30,11 @@ struct BasicVertex
 
     BasicVertex(float x, float y) : pos(x, y)
     {
-        
+
     }
 
+    bool operator==(const BasicVertex&) const = default;
+
     static VertexDefinition getVertexDefinition()
     {
         vk::VertexInputBindingDescription bindingDescription = {};
@@ -45,7 +55,31 @@ struct BasicVertex
         // attributeDescriptions[1].format = vk::Format::eR32G32B32Sfloat;
         // attributeDescriptions[1].offset = offsetof(BasicVertex, color);
 
-        return { bindingDescription, attributeDescriptions };
+        return { { bindingDescription }, attributeDescriptions };
+    }
+};
+
+// Vertex with its own color, so geometry with different colors can share a draw
+struct ColorVertex
+{
+    vec2 pos;
+    vec4 color;
+
+    bool operator==(const ColorVertex&) const = default;
+
+    static VertexDefinition getVertexDefinition()
+    {
+        vk::VertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(ColorVertex);
+        bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+
+        vector<vk::VertexInputAttributeDescription> attributeDescriptions = {
+            { 0, 0, vk::Format::eR32G32Sfloat, offsetof(ColorVertex, pos) },
+            { 1, 0, vk::Format::eR32G32B32A32Sfloat, offsetof(ColorVertex, color) },
+        };
+
+        return { { bindingDescription }, attributeDescriptions };
     }
 };
 
@@ -57,3 +91,202 @@ struct BasicUBO
     vec4 color;
 };
 
+// Must match the constants in shape.frag
+enum class ShapeType : uint32_t
+{
+    Rectangle = 0,
+    RoundedRectangle = 1,
+    Elipse = 2,
+    Ring = 3,
+    Outline = 4
+};
+
+// Per instance data for the shape pipeline. Every shape is a unit quad that gets
+// placed by the vertex shader and cut out by a signed distance function.
+struct ShapeInstance
+{
+    vec2 pos;
+    vec2 size;
+    vec2 origin; // Rotation pivot, relative to size (0, 0 is the bottom left corner)
+    float rotation;
+    ShapeType type;
+    vec4 color;
+    vec2 params; // x: corner radius, y: stroke thickness
+    float layer = 0; // Higher layers are drawn on top
+    float depth = 0; // Filled in by the renderer when the shape is flushed
+
+    // Covers the shape at any rotation (min x, min y, max x, max y)
+    inline vec4 getBounds() const
+    {
+        // No corner is further from the pivot than this, plus a pixel for antialiasing
+        auto radius = length(size * (glm::abs(origin) + 1.0f)) + 1.0f;
+        return vec4(pos - radius, pos + radius);
+    }
+
+    // view is (min x, min y, max x, max y)
+    inline bool isVisible(vec4 view) const
+    {
+        auto bounds = getBounds();
+        return !(bounds.z < view.x || bounds.w < view.y || bounds.x > view.z || bounds.y > view.w);
+    }
+
+    static VertexDefinition getVertexDefinition()
+    {
+        vk::VertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(ShapeInstance);
+        bindingDescription.inputRate = vk::VertexInputRate::eInstance;
+
+        vector<vk::VertexInputAttributeDescription> attributeDescriptions = {
+            { 1, 1, vk::Format::eR32G32Sfloat, offsetof(ShapeInstance, pos) },
+            { 2, 1, vk::Format::eR32G32Sfloat, offsetof(ShapeInstance, size) },
+            { 3, 1, vk::Format::eR32G32Sfloat, offsetof(ShapeInstance, origin) },
+            { 4, 1, vk::Format::eR32Sfloat, offsetof(ShapeInstance, rotation) },
+            { 5, 1, vk::Format::eR32Uint, offsetof(ShapeInstance, type) },
+            { 6, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(ShapeInstance, color) },
+            { 7, 1, vk::Format::eR32G32Sfloat, offsetof(ShapeInstance, params) },
+            { 8, 1, vk::Format::eR32Sfloat, offsetof(ShapeInstance, depth) },
+        };
+
+        return { { bindingDescription }, attributeDescriptions };
+    }
+};
+
+// Quad of a glyph in a font atlas page
+struct GlyphInstance
+{
+    vec2 pos; // Bottom left corner
+    vec2 size;
+    vec4 uv; // Texture coordinates of the bottom left and top right corners
+    vec4 color;
+
+    static VertexDefinition getVertexDefinition()
+    {
+        vk::VertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(GlyphInstance);
+        bindingDescription.inputRate = vk::VertexInputRate::eInstance;
+
+        vector<vk::VertexInputAttributeDescription> attributeDescriptions = {
+            { 1, 1, vk::Format::eR32G32Sfloat, offsetof(GlyphInstance, pos) },
+            { 2, 1, vk::Format::eR32G32Sfloat, offsetof(GlyphInstance, size) },
+            { 3, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(GlyphInstance, uv) },
+            { 4, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(GlyphInstance, color) },
+        };
+
+        return { { bindingDescription }, attributeDescriptions };
+    }
+};
+
+// Region of a texture in the renderer's bindless texture array
+struct Sprite
+{
+    uint32_t texture;
+    vec4 uv; // Texture coordinates of the bottom left and top right corners
+    ivec2 size; // In pixels
+};
+
+struct SpriteInstance
+{
+    vec2 pos;
+    vec2 size;
+    vec2 origin; // Rotation pivot, relative to size (0, 0 is the bottom left corner)
+    float rotation;
+    uint32_t texture; // Index into the bindless texture array
+    vec4 uv;
+    vec4 color; // Multiplied with the texture
+
+    inline vec4 getBounds() const
+    {
+        auto radius = length(size * (glm::abs(origin) + 1.0f));
+        return vec4(pos - radius, pos + radius);
+    }
+
+    inline bool isVisible(vec4 view) const
+    {
+        auto bounds = getBounds();
+        return !(bounds.z < view.x || bounds.w < view.y || bounds.x > view.z || bounds.y > view.w);
+    }
+
+    static VertexDefinition getVertexDefinition()
+    {
+        vk::VertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(SpriteInstance);
+        bindingDescription.inputRate = vk::VertexInputRate::eInstance;
+
+        vector<vk::VertexInputAttributeDescription> attributeDescriptions = {
+            { 1, 1, vk::Format::eR32G32Sfloat, offsetof(SpriteInstance, pos) },
+            { 2, 1, vk::Format::eR32G32Sfloat, offsetof(SpriteInstance, size) },
+            { 3, 1, vk::Format::eR32G32Sfloat, offsetof(SpriteInstance, origin) },
+            { 4, 1, vk::Format::eR32Sfloat, offsetof(SpriteInstance, rotation) },
+            { 5, 1, vk::Format::eR32Uint, offsetof(SpriteInstance, texture) },
+            { 6, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(SpriteInstance, uv) },
+            { 7, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(SpriteInstance, color) },
+        };
+
+        return { { bindingDescription }, attributeDescriptions };
+    }
+};
+
+// Object in a GPUScene. Laid out for std430 so the cull shader can read the
+// same buffer that feeds the vertex shader as per instance data.
+struct GPUObject
+{
+    vec2 pos;
+    vec2 size;
+    float rotation;
+    uint32_t mesh;
+    vec4 color;
+
+    static VertexDefinition getVertexDefinition()
+    {
+        vk::VertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(GPUObject);
+        bindingDescription.inputRate = vk::VertexInputRate::eInstance;
+
+        vector<vk::VertexInputAttributeDescription> attributeDescriptions = {
+            { 1, 1, vk::Format::eR32G32Sfloat, offsetof(GPUObject, pos) },
+            { 2, 1, vk::Format::eR32G32Sfloat, offsetof(GPUObject, size) },
+            { 3, 1, vk::Format::eR32Sfloat, offsetof(GPUObject, rotation) },
+            { 4, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(GPUObject, color) },
+        };
+
+        return { { bindingDescription }, attributeDescriptions };
+    }
+};
+
+struct GPUMesh
+{
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t padding;
+    vec4 bounds; // min x, min y, max x, max y in model space
+};
+
+// Per instance 2D affine transform and color for instanced draws
+struct Instance2D
+{
+    vec4 basis; // Transformed x axis in xy, y axis in zw
+    vec2 translation;
+    vec2 padding;
+    vec4 color;
+
+    static VertexDefinition getVertexDefinition()
+    {
+        vk::VertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(Instance2D);
+        bindingDescription.inputRate = vk::VertexInputRate::eInstance;
+
+        vector<vk::VertexInputAttributeDescription> attributeDescriptions = {
+            { 1, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(Instance2D, basis) },
+            { 2, 1, vk::Format::eR32G32Sfloat, offsetof(Instance2D, translation) },
+            { 3, 1, vk::Format::eR32G32B32A32Sfloat, offsetof(Instance2D, color) },
+        };
+
+        return { { bindingDescription }, attributeDescriptions };
+    }
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Datatypes.hpp"
+#include "Path.hpp"
+#include "TypedPipeline.hpp"
+
+class Renderer; // Forward declaration
+class BaseModel;
+
+// Records draws on one thread without touching the renderer, so several threads can draw
+// at once with no locking. Get one per producer thread from Renderer::createDrawContext.
+// At endFrame the renderer merges every context's queued draws into its own batches,
+// after the main thread's draws and in the order the contexts were created, so all
+// recording has to be finished by then.
+//
+// Text and paths use caches shared by the whole renderer, so those stay on the main
+// thread.
+class DrawContext
+{
+    // How much of each queue was recorded at some point
+    struct Mark
+    {
+        size_t shapes = 0;
+        size_t sprites = 0;
+        size_t strokeVertices = 0;
+        size_t strokeIndices = 0;
+    };
+
+    struct ModelDraw
+    {
+        shared_ptr<BaseModel> model;
+        shared_ptr<Pipeline> pipeline;
+        size_t uboOffset;
+        // Queued draws before this get drawn before it
+        Mark queued;
+    };
+
+    Renderer* renderer;
+
+    vector<ShapeInstance> shapes;
+    vector<SpriteInstance> sprites;
+    vector<ColorVertex> strokeVertices;
+    vector<uint32_t> strokeIndices;
+    vector<vec2> strokeScratch;
+    vector<uint32_t> strokeScratchIndices;
+
+    vector<ModelDraw> models;
+    // UBOs of the model draws, back to back
+    vector<uint8_t> ubos;
+
+    uint32_t shapesCulled = 0;
+
+    Mark getMark();
+    void queueModel(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, const void* ubo, size_t size);
+
+    friend class Renderer;
+public:
+    // Culling bounds, refreshed from the camera by the renderer every beginFrame so
+    // producers never read the camera while the main thread moves it
+    vec4 view = vec4(numeric_limits<float>::lowest(), numeric_limits<float>::lowest(), numeric_limits<float>::max(), numeric_limits<float>::max());
+
+    DrawContext(Renderer* renderer);
+
+    // Drops everything recorded, which the renderer does after merging
+    void clear();
+
+    void drawRectangle(int x, int y, int width, int height, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawElipse(int x, int y, int width, int height, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawRoundedRectangle(int x, int y, int width, int height, float radius, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawRing(int x, int y, int width, int height, float thickness, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawOutline(int x, int y, int width, int height, float thickness, float radius = 0, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawShape(const ShapeInstance& shape);
+
+    void drawPolyline(const vector<vec2>& points, const StrokeStyle& style, vec4 color = {1, 1, 1, 1}, bool closed = false);
+
+    void drawSprite(const Sprite& sprite, int x, int y, int width, int height, float rotation = 0, vec4 color = {1, 1, 1, 1});
+    void drawSprite(const SpriteInstance& sprite);
+
+    // The UBO is copied now, the model is drawn at endFrame. Throws if the UBO isn't the
+    // pipeline's UBO size.
+    template <typename T>
+    void drawModel(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, const T& ubo);
+    // Checked at compile time instead
+    template <derived_from<BaseModel> TModel, typename TUBO, typename TVertex, typename TInstance>
+    void drawModel(const shared_ptr<TModel>& model, const shared_ptr<TypedPipeline<TUBO, TVertex, TInstance>>& pipeline, const TUBO& ubo);
+};
+
+template <typename T>
+inline void DrawContext::drawModel(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, const T& ubo)
+{
+    static_assert(is_trivially_copyable_v<T>, "UBOs are copied with memcpy");
+
+    if (sizeof(T) != pipeline->getUBOSize())
+    {
+        throw std::runtime_error("UBO is " + to_string(sizeof(T)) + " bytes but the pipeline expects " + to_string(pipeline->getUBOSize()));
+    }
+
+    queueModel(model, pipeline, &ubo, sizeof(T));
+}
+
+template <derived_from<BaseModel> TModel, typename TUBO, typename TVertex, typename TInstance>
+inline void DrawContext::drawModel(const shared_ptr<TModel>& model, const shared_ptr<TypedPipeline<TUBO, TVertex, TInstance>>& pipeline, const TUBO& ubo)
+{
+    if constexpr (requires { typename TModel::VertexType; })
+    {
+        static_assert(is_same_v<typename TModel::VertexType, TVertex>, "The model's vertices don't match the pipeline");
+    }
+
+    queueModel(model, pipeline, &ubo, sizeof(TUBO));
+}
@@ -1,16 +1,26 @@
 #pragma once
 
 #include "BaseModel.hpp"
+#include "Mesh.hpp"
+
+#include <atomic>
 
 template <typename TVertex>
-class DynamicModel : public BaseModel
+class DynamicModel final : public BaseModel
 {
     vki::Buffer handle;
-    vki::DeviceMemory memory;
+    TrackedMemory memory;
 
     vki::Buffer indicesHandle;
-    vki::DeviceMemory indicesMemory;
+    TrackedMemory indicesMemory;
+    vk::IndexType indexType = vk::IndexType::eUint32;
+
+    // In bytes, since the index size changes with the vertex count
+    size_t vertexCapacity = 0;
+    size_t indexCapacity = 0;
 public:
+    using VertexType = TVertex;
+
     vector<TVertex> vertices;
     vector<uint32_t> indices;
 
@@ -21,51 +31,71 @@ public:
     
     void bind(vki::CommandBuffer& cmds) override;
     void draw(vki::CommandBuffer& cmds) override;
+    void drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance) override;
+
+    bool getGeometry(vector<vec2>& positions, vector<uint32_t>& indices) override;
 };
 
 template<typename TVertex>
 inline DynamicModel<TVertex>::DynamicModel(Renderer* renderer) : handle({}), memory({}), indicesHandle({}), indicesMemory({})
 {
     this->renderer = renderer;
+    dynamic = true;
 }
 
 template<typename TVertex>
 inline DynamicModel<TVertex>::DynamicModel(Renderer* renderer, vector<TVertex>& vertices, vector<uint32_t>& indices) : handle({}), memory({}), indicesHandle({}), indicesMemory({})
 {
     this->renderer = renderer;
+    dynamic = true;
     update(vertices, indices);
 }
 
 template<typename TVertex>
 inline void DynamicModel<TVertex>::update(vector<TVertex>& vertices, vector<uint32_t>& indices)
 {
-    if (vertices.size() > this->vertices.size())
+    auto vertexBytes = vertices.size() * sizeof(TVertex);
+    auto indexBytes = indices.size() * getIndexSize(vertices.size());
+
+    if (vertexBytes > vertexCapacity)
     {
-        renderer->createBuffer(vertices.size() * sizeof(TVertex), vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, handle, memory);
+        renderer->createBuffer(vertexBytes, vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, handle, memory, MemoryCategory::DynamicGeometry);
+        vertexCapacity = vertexBytes;
     }
 
-    if (indices.size() > this->indices.size())
+    if (indexBytes > indexCapacity)
     {
-        renderer->createBuffer(indices.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, indicesHandle, indicesMemory);
+        renderer->createBuffer(indexBytes, vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, indicesHandle, indicesMemory, MemoryCategory::DynamicGeometry);
+        indexCapacity = indexBytes;
     }
 
-    auto verticesData = memory.mapMemory(0, vertices.size() * sizeof(TVertex));
-    memcpy(verticesData, vertices.data(), vertices.size() * sizeof(TVertex));
+    auto verticesData = memory.mapMemory(0, vertexBytes);
+    memcpy(verticesData, vertices.data(), vertexBytes);
     memory.unmapMemory();
 
-    auto indicesData = indicesMemory.mapMemory(0, indices.size() * sizeof(uint32_t));
-    memcpy(indicesData, indices.data(), indices.size() * sizeof(uint32_t));
+    auto indicesData = indicesMemory.mapMemory(0, indexBytes);
+    packIndices(indices, vertices.size(), indicesData);
     indicesMemory.unmapMemory();
+
+    indexType = getIndexType(vertices.size());
+    renderer->stats.uploadBytes += vertexBytes + indexBytes;
     
     this->vertices = vertices;
     this->indices = indices;
+    geometryVersion = nextGeometryVersion++;
+
+    if constexpr (GenericVertex2D<TVertex>)
+    {
+        bounds = computeBounds(vertices);
+        hasBounds = !vertices.empty();
+    }
 }
 
 template<typename TVertex>
 inline void DynamicModel<TVertex>::bind(vki::CommandBuffer& cmds)
 {
     cmds.bindVertexBuffers(0, { handle }, { 0 });
-    cmds.bindIndexBuffer(indicesHandle, 0, vk::IndexType::eUint32);
+    cmds.bindIndexBuffer(indicesHandle, 0, indexType);
 }
 
 template<typename TVertex>
@@ -73,27 +103,80 @@ inline void DynamicModel<TVertex>::draw(vki::CommandBuffer& cmds)
 {
     bind(cmds);
     cmds.drawIndexed(indices.size(), 1, 0, 0, 0);
+    renderer->countDraw();
+}
+
+template<typename TVertex>
+inline void DynamicModel<TVertex>::drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance)
+{
+    bind(cmds);
+    cmds.drawIndexed(indices.size(), instanceCount, 0, 0, firstInstance);
+    renderer->countDraw(instanceCount);
+}
+
+template<typename TVertex>
+inline bool DynamicModel<TVertex>::getGeometry(vector<vec2>& positions, vector<uint32_t>& indices)
+{
+    if constexpr (GenericVertex2D<TVertex>)
+    {
+        positions.clear();
+        for (const auto& i : vertices)
+        {
+            positions.push_back(i.pos);
+        }
+
+        indices = this->indices;
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+inline atomic<size_t> nextDynamicModelPool = 0;
+
+// Every vertex type gets its own pool in the renderer
+template <typename TVertex>
+inline size_t getDynamicModelPool()
+{
+    static const size_t pool = nextDynamicModelPool++;
+    return pool;
 }
 
 // I love C++ circular dependencies
 template <typename TVertex>
 shared_ptr<DynamicModel<TVertex>> Renderer::getDynamicModel(vector<TVertex>& vertices, vector<uint32_t>& indices)
 {
+    auto index = getDynamicModelPool<TVertex>();
+    if (index >= dynamicModels.size())
+    {
+        dynamicModels.resize(index + 1);
+    }
+
+    auto& pool = dynamicModels[index];
+    if (pool.models.empty())
+    {
+        pool.models.resize(MAX_FRAMES_IN_FLIGHT);
+    }
+
+    auto& models = pool.models[currentFlightFrame];
     shared_ptr<DynamicModel<TVertex>> model;
 
-    if (dynamicModelsThisFrame >= dynamicModels[currentFlightFrame].size())
+    if (pool.usedThisFrame >= models.size())
     {
         model = make_shared<DynamicModel<TVertex>>(this);
-        dynamicModels[currentFlightFrame].push_back(model);
+        models.push_back(model);
     }
     else
     {
-        model = static_pointer_cast<DynamicModel<TVertex>>(dynamicModels[currentFlightFrame][dynamicModelsThisFrame]);
+        // Only DynamicModel<TVertex> goes in this pool
+        model = static_pointer_cast<DynamicModel<TVertex>>(models[pool.usedThisFrame]);
     }
 
     model->update(vertices, indices);
 
-    dynamicModelsThisFrame++;
+    pool.usedThisFrame++;
 
     return model;
 }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Datatypes.hpp"
+#include "RectPacker.hpp"
+#include "Texture.hpp"
+
+#include <stb_truetype.h>
+
+class Renderer; // Forward declaration
+
+// TrueType font rasterized on demand into atlas pages. Laid out strings are cached, so
+// drawing the same label again only copies its quads.
+class Font
+{
+    struct Glyph
+    {
+        vec2 offset; // Bottom left corner relative to the pen on the baseline
+        vec2 size;
+        vec4 uv;
+        float advance;
+        uint32_t page;
+    };
+
+    struct Page
+    {
+        unique_ptr<Texture> texture;
+        RectPacker packer;
+        vector<uint8_t> pixels;
+
+        // Pixels written since the last upload, as min x, min y, max x, max y
+        ivec4 dirty;
+
+        vector<GlyphInstance> queued;
+        // Renderer run index and end in queued for every run that drew on this page, so
+        // text is drawn in order with other kinds of draws
+        vector<pair<uint32_t, uint32_t>> runs;
+        size_t flushedRuns = 0;
+    };
+
+    struct PlacedGlyph
+    {
+        vec2 offset;
+        vec2 size;
+        vec4 uv;
+        uint32_t page;
+    };
+
+    struct TextRun
+    {
+        vector<PlacedGlyph> glyphs;
+        vec4 bounds; // Relative to the origin of the first line's baseline
+    };
+
+    string path;
+    float pixelHeight;
+
+    vector<uint8_t> data;
+    stbtt_fontinfo info;
+
+    float scale;
+    float ascent;
+    float descent;
+    float lineHeight;
+
+    uint32_t pageSize;
+    vector<Page> pages;
+
+    unordered_map<uint32_t, Glyph> glyphs;
+    unordered_map<string, TextRun> runs;
+
+    const Glyph& getGlyph(uint32_t codepoint);
+    Page& addPage();
+    const TextRun& getRun(const string& text);
+
+    void upload();
+
+    friend class Renderer;
+public:
+    Renderer* renderer;
+
+    // Layed out strings kept around before the cache starts over
+    size_t maxCachedRuns = 4096;
+
+    Font(Renderer* renderer, const string& path, float pixelHeight, uint32_t pageSize = 1024);
+
+    // Size of text without scaling, as min x, min y, max x, max y around the first baseline
+    vec4 measure(const string& text);
+
+    inline float getLineHeight() { return lineHeight; }
+    inline float getAscent() { return ascent; }
+    inline float getDescent() { return descent; }
+    inline size_t getPageCount() { return pages.size(); }
+
+    inline const string& getPath() { return path; }
+    inline float getPixelHeight() { return pixelHeight; }
+    inline uint32_t getPageSize() { return pageSize; }
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Datatypes.hpp"
+#include "Path.hpp"
+
+#include <map>
+
+class Renderer; // Forward declaration
+struct RendererSettings;
+class BaseModel;
+class Font;
+class RenderLayer;
+class Texture;
+class GPUScene;
+struct TransformBatch;
+
+// Binary draw stream of a few frames, for reproducing a slow scene without the app that
+// drew it. The file is the header, then records of a type byte, a payload size and the
+// payload. Draws are recorded where the app calls the renderer, before culling and
+// tessellation, so a replay does the same CPU work. Fonts, textures, models and paths are
+// written the first time a captured frame uses them. Little endian only.
+constexpr char CAPTURE_FILE_MAGIC[4] = { 'V', 'E', 'C', 'F' };
+// Version 1 is the same without the scene records, so it's still read
+constexpr uint32_t CAPTURE_FILE_VERSION = 2;
+
+struct CaptureFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    // RendererSettings that change how draws are done
+    uint8_t depthBuffer;
+    uint8_t damageTracking;
+    uint8_t reserved[6];
+};
+
+static_assert(sizeof(CaptureFileHeader) == 16, "Capture header needs to match the file layout");
+
+enum class CaptureRecord : uint8_t
+{
+    BeginFrame, // Render extent
+    EndFrame, // Clear color
+    Camera,
+    Shape,
+    Sprite, // Texture is a capture texture id
+    Texture, // Only the size, replays sample blank textures
+    Stroke,
+    Path, // Flattened subpaths, only the first time a version is drawn
+    StrokeMesh, // Already tessellated by a DrawContext
+    Font, // Path of the font file
+    Text,
+    Polygon, // The outline and holes, before triangulation
+    ModelGeometry,
+    ModelDraw, // UBO bytes
+    Instances, // TransformBatch arrays
+    BeginLayer,
+    EndLayer,
+    DrawLayer,
+    SceneInstances, // Instance2D arrays a Scene drew, after culling
+    GPUScene // Meshes and objects, only the first time a version is drawn
+};
+
+// Records the renderer's draws for a number of frames, starting at the next beginFrame.
+// The renderer drops it once the last frame is written.
+//
+//     renderer->capture = make_shared<FrameCapture>(renderer, "slow.vecf", 10);
+//
+// Models are only captured when they keep their vertices, like Model and DynamicModel,
+// and only their positions, since app shaders aren't part of the file.
+class FrameCapture
+{
+    ofstream file;
+    string path;
+
+    uint32_t framesLeft;
+    bool recording = false;
+
+    CaptureRecord current = CaptureRecord::BeginFrame;
+    vector<uint8_t> payload;
+    vec2 camera = vec2(numeric_limits<float>::quiet_NaN());
+
+    // Capture ids by address, or by geometry version for models since those are unique.
+    // Addresses are reused once freed, so the entry only counts while it's the same object.
+    unordered_map<const void*, pair<weak_ptr<Font>, uint32_t>> fonts;
+    unordered_map<const void*, pair<weak_ptr<RenderLayer>, uint32_t>> layers;
+    unordered_map<uint64_t, uint32_t> models;
+    // Last version written per path id and GPU scene id
+    unordered_map<uint64_t, uint64_t> paths;
+    unordered_map<uint64_t, uint64_t> gpuScenes;
+    // Texture and capture texture id per bindless slot. Slots are reused once freed, so a
+    // slot whose texture changed is written again with a new id.
+    unordered_map<uint32_t, pair<weak_ptr<Texture>, uint32_t>> textures;
+    uint32_t nextId = 0;
+
+    template <typename T>
+    void put(const T& value);
+    template <typename T>
+    void putArray(const T* values, size_t count);
+    template <typename T>
+    void putVector(const vector<T>& values);
+    void putString(const string& value);
+
+    // Records are built in payload and written by end. Begin writes the camera first when
+    // it moved since the last record.
+    void begin(CaptureRecord type);
+    void end();
+
+    // Writes the definition the first time, UINT32_MAX when the model has no geometry
+    uint32_t getModel(BaseModel& model);
+    uint32_t getFont(shared_ptr<Font> font);
+    void putLayer(shared_ptr<RenderLayer> layer);
+public:
+    Renderer* renderer;
+
+    FrameCapture(Renderer* renderer, const string& path, uint32_t frames = 1);
+
+    inline bool isRecording() const { return recording; }
+    inline bool isDone() const { return framesLeft == 0; }
+
+    // Called by the renderer, only while recording except for beginFrame and endFrame
+    void beginFrame();
+    void endFrame();
+
+    void shape(const ShapeInstance& shape);
+    void sprite(const SpriteInstance& sprite);
+    void texture(uint32_t slot, shared_ptr<Texture> texture);
+    void stroke(const vector<vec2>& points, const StrokeStyle& style, vec4 color, bool closed);
+    void path(const Path& path, const StrokeStyle& style, vec4 color);
+    void strokeMesh(const ColorVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+    void text(shared_ptr<Font> font, const string& text, int x, int y, vec4 color, float scale);
+    void polygon(const vector<BasicVertex>& points, const vector<vector<BasicVertex>>* holes, int x, int y, int width, int height, float rotation, vec4 color);
+    void modelDraw(BaseModel& model, const void* ubo, size_t uboSize);
+    void instances(BaseModel& model, const TransformBatch& batch);
+    void sceneInstances(BaseModel& model, const vector<Instance2D>& instances);
+    void gpuScene(GPUScene& scene);
+    void beginLayer(shared_ptr<RenderLayer> layer);
+    void endLayer();
+    void drawLayer(shared_ptr<RenderLayer> layer, vec4 color);
+};
+
+// Draws the frames of a capture file again. The file is read and checked up front, then
+// prepare makes its fonts, textures, models and layers, and drawFrame can be called
+// between beginFrame and endFrame any number of times in any order.
+class FrameReplay
+{
+    vector<uint8_t> data;
+    CaptureFileHeader header;
+
+    struct Frame
+    {
+        size_t start;
+        size_t end;
+        vk::Extent2D extent;
+    };
+
+    vector<Frame> frames;
+
+    struct Geometry
+    {
+        vector<BasicVertex> vertices;
+        vector<uint32_t> indices;
+        bool dynamic;
+        // Only for static geometry, dynamic geometry is uploaded every draw like it was
+        shared_ptr<BaseModel> model;
+    };
+
+    unordered_map<uint32_t, Geometry> models;
+    // Null when the font file couldn't be loaded
+    unordered_map<uint32_t, shared_ptr<Font>> fonts;
+    unordered_map<uint32_t, pair<shared_ptr<Texture>, Sprite>> textures;
+    unordered_map<uint32_t, shared_ptr<RenderLayer>> layers;
+
+    // Flattened subpaths by path id and version, and one Path per id that's rebuilt when
+    // a new version is drawn, so the renderer's stroke cache behaves like it did
+    map<pair<uint64_t, uint64_t>, vector<pair<bool, vector<vec2>>>> pathVersions;
+    unordered_map<uint64_t, pair<uint64_t, Path>> paths;
+
+    // The same for GPU scenes, by version since versions are unique across scenes, and the
+    // scene built from one per scene id
+    struct GPUSceneVersion
+    {
+        vector<BasicVertex> vertices;
+        vector<uint32_t> indices;
+        vector<GPUMesh> meshes;
+        vector<GPUObject> objects;
+    };
+
+    unordered_map<uint64_t, GPUSceneVersion> gpuSceneVersions;
+    unordered_map<uint64_t, pair<uint64_t, shared_ptr<GPUScene>>> gpuScenes;
+
+    uint32_t skipped = 0;
+
+    shared_ptr<BaseModel> getModel(uint32_t id);
+public:
+    Renderer* renderer = nullptr;
+
+    FrameReplay(const string& path);
+
+    // Settings the frames were captured with
+    RendererSettings getSettings();
+    inline size_t getFrameCount() const { return frames.size(); }
+    inline vk::Extent2D getExtent(size_t frame) const { return frames[frame].extent; }
+
+    void prepare(Renderer* renderer);
+    void drawFrame(size_t frame);
+
+    // Draws that couldn't be done again, like text in a font that's missing, models that
+    // didn't keep their geometry or GPU scenes the device can't draw
+    inline uint32_t getSkipped() const { return skipped; }
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "utils.hpp"
+#include "MemoryTracker.hpp"
+#include "Datatypes.hpp"
+
+#include <atomic>
+
+class Renderer; // Forward declaration
+
+// Scene ids and versions come from the same counter, so a version is unique across scenes
+inline atomic<uint64_t> nextGPUSceneVersion = 1;
+
+// Static scene that lives entirely on the GPU. Every frame a render graph compute pass
+// culls the objects against the view and writes indirect draw commands, so drawing
+// costs the CPU the same no matter how many objects there are.
+class GPUScene
+{
+    struct CullParams
+    {
+        vec4 view;
+        uint32_t objectCount;
+    };
+
+    vector<BasicVertex> vertices;
+    vector<uint32_t> indices;
+    vector<GPUMesh> meshes;
+    vector<GPUObject> objects;
+
+    bool geometryDirty = false;
+    bool objectsDirty = false;
+
+    // For frame captures, the version changes whenever a draw uploads changes
+    uint64_t id = nextGPUSceneVersion++;
+    uint64_t version = nextGPUSceneVersion++;
+
+    vki::Buffer vertexBuffer;
+    TrackedMemory vertexMemory;
+    vki::Buffer indexBuffer;
+    TrackedMemory indexMemory;
+    vki::Buffer meshBuffer;
+    TrackedMemory meshMemory;
+    vki::Buffer objectBuffer;
+    TrackedMemory objectMemory;
+
+    // Written by the GPU every frame, so one per frame in flight
+    vector<vki::Buffer> commandBuffers;
+    vector<TrackedMemory> commandMemories;
+    vector<vki::Buffer> countBuffers;
+    vector<TrackedMemory> countMemories;
+    size_t commandCapacity = 0;
+
+    vki::DescriptorPool descriptorPool;
+    vector<vki::DescriptorSet> descriptorSets;
+
+    void upload();
+    void updateDescriptors();
+
+    friend class FrameCapture;
+    friend class FrameReplay;
+public:
+    Renderer* renderer;
+
+    // Throws unless isSupported
+    GPUScene(Renderer* renderer);
+
+    // The cull shader writes every object's draw into one indirect buffer and passes its
+    // index as firstInstance
+    static bool isSupported(Renderer* renderer);
+
+    uint32_t addMesh(const vector<BasicVertex>& vertices, const vector<uint32_t>& indices);
+    uint32_t addObject(uint32_t mesh, vec2 pos, vec2 size, float rotation = 0, vec4 color = {1, 1, 1, 1});
+    void setObject(uint32_t id, vec2 pos, vec2 size, float rotation, vec4 color);
+
+    size_t getObjectCount();
+
+    // Records culling into the pre-pass commands and the indirect draw into the frame.
+    // Only call once per frame.
+    void draw();
+};
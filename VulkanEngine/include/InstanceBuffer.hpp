@@ -0,0 +1,131 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Renderer.hpp"
+
+// Per frame streaming buffer for instance data. Everything pushed during a frame is
+// appended, so one buffer can feed any number of instanced draws. Also works for
+// streamed vertices and indices with the matching usage.
+template <typename TInstance>
+class InstanceBuffer
+{
+    struct FrameData
+    {
+        vki::Buffer handle = { nullptr };
+        TrackedMemory memory = { nullptr };
+        TInstance* mapped = nullptr;
+
+        size_t capacity = 0;
+        size_t count = 0;
+
+        // Buffers outgrown mid frame may still be referenced by the command buffer
+        vector<pair<vki::Buffer, TrackedMemory>> retired;
+    };
+
+    vector<FrameData> frames;
+    vk::BufferUsageFlags usage;
+
+    void grow(FrameData& frame, size_t minCapacity);
+public:
+    Renderer* renderer;
+
+    InstanceBuffer(Renderer* renderer, size_t initialCapacity = 256, vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eVertexBuffer);
+
+    void beginFrame();
+
+    // Copies the elements into this frame's buffer without binding anything. The buffer
+    // can change when it grows, so get it afterwards.
+    uint32_t write(const TInstance* data, size_t count);
+    vk::Buffer getBuffer();
+
+    // Reserves room for count instances in this frame's buffer and binds it. The instances
+    // are written through data, and the return value is the first instance index.
+    uint32_t allocate(vki::CommandBuffer& cmds, uint32_t binding, size_t count, TInstance** data);
+    // Copies the instances into this frame's buffer, binds it and returns the first instance index
+    uint32_t push(vki::CommandBuffer& cmds, uint32_t binding, const TInstance* data, size_t count);
+};
+
+template<typename TInstance>
+inline InstanceBuffer<TInstance>::InstanceBuffer(Renderer* renderer, size_t initialCapacity, vk::BufferUsageFlags usage) : renderer(renderer), usage(usage)
+{
+    frames.resize(renderer->MAX_FRAMES_IN_FLIGHT);
+
+    for (auto& i : frames)
+    {
+        grow(i, initialCapacity);
+    }
+}
+
+template<typename TInstance>
+inline void InstanceBuffer<TInstance>::grow(FrameData& frame, size_t minCapacity)
+{
+    auto capacity = std::max(minCapacity, frame.capacity * 2);
+
+    if (frame.mapped != nullptr)
+    {
+        frame.memory.unmapMemory();
+        frame.retired.emplace_back(std::move(frame.handle), std::move(frame.memory));
+        frame.handle = { nullptr };
+        frame.memory = { nullptr };
+    }
+
+    renderer->createBuffer(capacity * sizeof(TInstance), usage, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, frame.handle, frame.memory, MemoryCategory::DynamicGeometry);
+    frame.mapped = static_cast<TInstance*>(frame.memory.mapMemory(0, capacity * sizeof(TInstance)));
+    frame.capacity = capacity;
+}
+
+template<typename TInstance>
+inline void InstanceBuffer<TInstance>::beginFrame()
+{
+    auto& frame = frames[renderer->currentFlightFrame];
+    frame.count = 0;
+    frame.retired.clear();
+}
+
+template<typename TInstance>
+inline uint32_t InstanceBuffer<TInstance>::write(const TInstance* data, size_t count)
+{
+    auto& frame = frames[renderer->currentFlightFrame];
+
+    if (frame.count + count > frame.capacity)
+    {
+        // Previous draws keep using the retired buffer, so the new one starts empty
+        grow(frame, count);
+        frame.count = 0;
+    }
+
+    auto first = frame.count;
+    if (data != nullptr)
+    {
+        memcpy(frame.mapped + first, data, count * sizeof(TInstance));
+    }
+
+    frame.count += count;
+    renderer->stats.uploadBytes += count * sizeof(TInstance);
+    return static_cast<uint32_t>(first);
+}
+
+template<typename TInstance>
+inline vk::Buffer InstanceBuffer<TInstance>::getBuffer()
+{
+    return *frames[renderer->currentFlightFrame].handle;
+}
+
+template<typename TInstance>
+inline uint32_t InstanceBuffer<TInstance>::allocate(vki::CommandBuffer& cmds, uint32_t binding, size_t count, TInstance** data)
+{
+    auto first = write(nullptr, count);
+    *data = frames[renderer->currentFlightFrame].mapped + first;
+
+    cmds.bindVertexBuffers(binding, { getBuffer() }, { 0 });
+    return first;
+}
+
+template<typename TInstance>
+inline uint32_t InstanceBuffer<TInstance>::push(vki::CommandBuffer& cmds, uint32_t binding, const TInstance* data, size_t count)
+{
+    TInstance* ptr;
+    auto first = allocate(cmds, binding, count, &ptr);
+    memcpy(ptr, data, count * sizeof(TInstance));
+    return first;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class JobSystem; // Forward declaration
+
+// Work for a JobSystem. Runs once all of its dependencies have finished.
+class Job
+{
+    function<void()> func;
+    exception_ptr error;
+
+    // Unfinished dependencies, plus one while the job is being scheduled
+    atomic<uint32_t> pending = 1;
+    atomic<bool> finished = false;
+
+    mutex lock;
+    vector<shared_ptr<Job>> dependents;
+
+    friend class JobSystem;
+public:
+    inline bool isFinished() const { return finished.load(memory_order_acquire); }
+};
+
+struct WorkerStats
+{
+    uint64_t jobs = 0;
+    // Jobs taken from another worker's queue
+    uint64_t steals = 0;
+    // Time spent running jobs since the last reset, from 0 to 1
+    double utilization = 0;
+};
+
+// Work stealing scheduler. Every worker thread has its own queue, running its newest
+// jobs first and stealing the oldest from others when it runs dry. Threads that aren't
+// workers, like the main thread, share one more queue, and run jobs themselves while
+// they wait so they're never just blocked.
+class JobSystem
+{
+    struct Worker
+    {
+        mutex lock;
+        deque<shared_ptr<Job>> jobs;
+
+        atomic<uint64_t> jobsRun = 0;
+        atomic<uint64_t> steals = 0;
+        atomic<uint64_t> busyNanoseconds = 0;
+    };
+
+    // One per thread, then the one shared by everything else
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+
+    atomic<bool> running = true;
+    atomic<size_t> queued = 0;
+
+    mutex sleepLock;
+    condition_variable wake;
+
+    chrono::steady_clock::time_point statsStart;
+
+    size_t getWorkerIndex();
+    void push(shared_ptr<Job> job);
+    shared_ptr<Job> take(size_t index);
+    void run(Job& job, size_t index);
+    void workerLoop(size_t index);
+public:
+    // The calling thread helps out while waiting, so one less than the core count
+    // keeps every core busy
+    JobSystem(size_t threadCount = std::max(1u, thread::hardware_concurrency()) - 1);
+    ~JobSystem();
+
+    inline size_t getThreadCount() const { return threads.size(); }
+
+    shared_ptr<Job> schedule(function<void()> func, const vector<shared_ptr<Job>>& dependencies = {});
+    // Runs other jobs until this one is done, then rethrows anything it threw
+    void wait(const shared_ptr<Job>& job);
+
+    // Calls func(i) for every i below count, in chunks of at least grain, and waits
+    template <typename F>
+    void parallelFor(size_t count, F func, size_t grain = 1);
+
+    // One per worker thread, then one for every other thread that ran jobs while waiting
+    vector<WorkerStats> getStats();
+    void resetStats();
+};
+
+template <typename F>
+inline void JobSystem::parallelFor(size_t count, F func, size_t grain)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // A few chunks per thread so stealing can even out uneven work
+    auto chunks = std::min((count + std::max<size_t>(grain, 1) - 1) / std::max<size_t>(grain, 1), (threads.size() + 1) * 4);
+
+    if (chunks <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            func(i);
+        }
+
+        return;
+    }
+
+    auto chunkSize = (count + chunks - 1) / chunks;
+
+    vector<shared_ptr<Job>> jobs;
+    for (size_t start = 0; start < count; start += chunkSize)
+    {
+        auto end = std::min(start + chunkSize, count);
+        jobs.push_back(schedule([&func, start, end]()
+        {
+            for (size_t i = start; i < end; i++)
+            {
+                func(i);
+            }
+        }));
+    }
+
+    // Jobs reference func, so all of them have to finish even if one threw
+    exception_ptr error;
+    for (auto& i : jobs)
+    {
+        try
+        {
+            wait(i);
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = current_exception();
+            }
+        }
+    }
+
+    if (error)
+    {
+        rethrow_exception(error);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "utils.hpp"
+
+// Read only memory mapping of a whole file. Pages are loaded by the OS as they're touched,
+// so nothing is read up front.
+class MappedFile
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+public:
+    MappedFile() {}
+    MappedFile(const string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    void close();
+
+    inline const uint8_t* getData() { return data; }
+    inline size_t getSize() { return size; }
+    inline bool isOpen() { return data != nullptr; }
+};
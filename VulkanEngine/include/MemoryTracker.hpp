@@ -0,0 +1,109 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <functional>
+#include <mutex>
+
+class Renderer; // Forward declaration
+class MemoryTracker;
+
+// What device memory is used for, to see where it goes
+enum class MemoryCategory
+{
+    Uniforms,
+    // Rewritten every frame, like instance buffers and dynamic models
+    DynamicGeometry,
+    StaticGeometry,
+    Textures,
+    // Depth buffers and render graph images
+    Attachments,
+    Staging,
+    // Anything that can be thrown away and made again, like layers
+    Caches,
+    Other
+};
+
+constexpr size_t MEMORY_CATEGORY_COUNT = static_cast<size_t>(MemoryCategory::Other) + 1;
+
+// Device memory that counts against its category until it's freed
+class TrackedMemory : public vki::DeviceMemory
+{
+    MemoryTracker* tracker = nullptr;
+    MemoryCategory category = MemoryCategory::Other;
+    uint32_t heap = 0;
+    vk::DeviceSize size = 0;
+
+    void release();
+public:
+    TrackedMemory(std::nullptr_t = nullptr);
+    TrackedMemory(vki::DeviceMemory&& memory, MemoryTracker* tracker, MemoryCategory category, uint32_t heap, vk::DeviceSize size);
+    TrackedMemory(TrackedMemory&& other) noexcept;
+    ~TrackedMemory();
+
+    TrackedMemory& operator=(TrackedMemory&& other) noexcept;
+
+    inline vk::DeviceSize getSize() const { return size; }
+};
+
+struct MemoryHeapUsage
+{
+    // From VK_EXT_memory_budget when it's there. Otherwise the budget is the heap size and
+    // the usage is what this renderer allocated.
+    vk::DeviceSize budget = 0;
+    vk::DeviceSize usage = 0;
+    // Allocated through the tracker
+    vk::DeviceSize tracked = 0;
+    bool deviceLocal = false;
+};
+
+// Counts device memory per heap and per category. Once a heap gets close to its budget,
+// eviction callbacks get a chance to free caches at the start of the next frame, before
+// allocations start failing.
+class MemoryTracker
+{
+    Renderer* renderer;
+
+    vk::PhysicalDeviceMemoryProperties properties;
+
+    mutex lock;
+    array<vk::DeviceSize, MEMORY_CATEGORY_COUNT> categories = {};
+    vector<MemoryHeapUsage> heaps;
+
+    size_t nextCallback = 0;
+    vector<pair<size_t, function<vk::DeviceSize()>>> evictionCallbacks;
+
+    uint32_t evictions = 0;
+    uint64_t allocations = 0;
+    uint64_t liveAllocations = 0;
+
+    void untrack(MemoryCategory category, uint32_t heap, vk::DeviceSize size);
+
+    friend class TrackedMemory;
+public:
+    // Part of a heap's budget that can be used before caches get evicted
+    float pressureThreshold = 0.9f;
+
+    MemoryTracker(Renderer* renderer);
+
+    TrackedMemory allocate(vk::MemoryRequirements requirements, vk::MemoryPropertyFlags properties, MemoryCategory category);
+
+    // Called once the frames that could be using the evicted memory are done. Callbacks
+    // return roughly how many bytes they freed, and get called in the order they were
+    // added until enough was freed.
+    size_t addEvictionCallback(function<vk::DeviceSize()> callback);
+    void removeEvictionCallback(size_t id);
+
+    // Refreshes the budgets and evicts when needed. The renderer calls this in beginFrame.
+    void update();
+
+    vector<MemoryHeapUsage> getHeaps();
+    vk::DeviceSize getUsage(MemoryCategory category);
+    // Times caches were evicted
+    inline uint32_t getEvictions() const { return evictions; }
+    // Every allocation made so far, and the ones not freed yet
+    uint64_t getAllocationCount();
+    uint64_t getLiveAllocations();
+
+    static const char* getCategoryName(MemoryCategory category);
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Datatypes.hpp"
+
+#include <bit>
+#include <concepts>
+
+// Post transform cache size used for reordering and for reporting ACMR
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+// Where a mesh lives in buffers shared with other meshes
+struct MeshHandle
+{
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+    uint32_t indexCount = 0;
+};
+
+struct MeshStats
+{
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    float acmr = 0; // Vertices transformed per triangle, 0.5 is ideal and 3 is worst
+};
+
+struct MeshReport
+{
+    MeshStats before;
+    MeshStats after;
+};
+
+string describe(const MeshReport& report);
+
+// 0xFFFF is left alone since it's the restart index
+inline bool useShortIndices(size_t vertexCount)
+{
+    return vertexCount <= numeric_limits<uint16_t>::max();
+}
+
+inline vk::IndexType getIndexType(size_t vertexCount)
+{
+    return useShortIndices(vertexCount) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+}
+
+inline size_t getIndexSize(size_t vertexCount)
+{
+    return useShortIndices(vertexCount) ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+// Writes indices in the format getIndexType picks
+void packIndices(const vector<uint32_t>& indices, size_t vertexCount, void* dest);
+
+// FIFO cache simulation
+float computeACMR(const vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders triangles for the post transform cache (Forsyth's algorithm)
+void optimizeVertexCache(vector<uint32_t>& indices, size_t vertexCount);
+// Renumbers vertices in the order they're first used. Returns the new index of every old
+// vertex, unused ones get UINT32_MAX.
+vector<uint32_t> optimizeVertexFetch(vector<uint32_t>& indices, size_t vertexCount);
+
+template <typename TVertex>
+MeshStats getMeshStats(const vector<TVertex>& vertices, const vector<uint32_t>& indices)
+{
+    MeshStats stats = {};
+    stats.vertexCount = static_cast<uint32_t>(vertices.size());
+    stats.indexCount = static_cast<uint32_t>(indices.size());
+    stats.vertexBytes = vertices.size() * sizeof(TVertex);
+    stats.indexBytes = indices.size() * getIndexSize(vertices.size());
+    stats.acmr = computeACMR(indices, vertices.size());
+    return stats;
+}
+
+// Merges identical vertices, then reorders triangles and vertices for the GPU caches.
+// Meant for static meshes, it's too slow to run on every frame's dynamic geometry.
+template <GenericVertex2D TVertex>
+    requires equality_comparable<TVertex>
+MeshReport prepareMesh(vector<TVertex>& vertices, vector<uint32_t>& indices)
+{
+    MeshReport report = {};
+    report.before = getMeshStats(vertices, indices);
+    report.before.indexBytes = indices.size() * sizeof(uint32_t); // Always 32 bit before
+
+    // Keyed by vertex index so that the map doesn't copy vertices
+    auto hash = [&](uint32_t i)
+    {
+        // Adding 0 turns -0 into 0 so that they hash the same
+        auto x = std::bit_cast<uint32_t>(vertices[i].pos.x + 0.0f);
+        auto y = std::bit_cast<uint32_t>(vertices[i].pos.y + 0.0f);
+        return static_cast<size_t>((static_cast<uint64_t>(x) * 73856093) ^ (static_cast<uint64_t>(y) * 19349663));
+    };
+    auto equal = [&](uint32_t a, uint32_t b) { return vertices[a] == vertices[b]; };
+
+    unordered_map<uint32_t, uint32_t, decltype(hash), decltype(equal)> seen(vertices.size(), hash, equal);
+    vector<uint32_t> remap(vertices.size());
+    vector<TVertex> unique;
+    unique.reserve(vertices.size());
+
+    for (uint32_t i = 0; i < vertices.size(); i++)
+    {
+        auto [it, inserted] = seen.try_emplace(i, static_cast<uint32_t>(unique.size()));
+        if (inserted)
+        {
+            unique.push_back(vertices[i]);
+        }
+
+        remap[i] = it->second;
+    }
+
+    for (auto& i : indices)
+    {
+        i = remap[i];
+    }
+
+    optimizeVertexCache(indices, unique.size());
+    remap = optimizeVertexFetch(indices, unique.size());
+
+    vector<uint32_t> order;
+    for (uint32_t i = 0; i < unique.size(); i++)
+    {
+        if (remap[i] != numeric_limits<uint32_t>::max())
+        {
+            order.resize(std::max(order.size(), static_cast<size_t>(remap[i]) + 1));
+            order[remap[i]] = i;
+        }
+    }
+
+    vertices.clear();
+    for (auto i : order)
+    {
+        vertices.push_back(unique[i]);
+    }
+
+    report.after = getMeshStats(vertices, indices);
+    return report;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "utils.hpp"
+#include "BaseModel.hpp"
+#include "MappedFile.hpp"
+#include "Mesh.hpp"
+
+// Binary mesh container. The file is the header, then the mesh table, then every mesh's
+// vertices, then every mesh's indices. Vertex and index data are laid out exactly like the
+// GPU buffers, so loading is a copy. Little endian only.
+constexpr char MESH_FILE_MAGIC[4] = { 'V', 'E', 'M', 'F' };
+constexpr uint32_t MESH_FILE_VERSION = 1;
+
+struct MeshFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t vertexStride;
+    uint32_t indexSize; // 2 or 4
+    uint32_t reserved;
+
+    // From the start of the file
+    uint64_t vertexOffset;
+    uint64_t vertexBytes;
+    uint64_t indexOffset;
+    uint64_t indexBytes;
+};
+
+struct MeshFileEntry
+{
+    char name[48]; // Null terminated
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t indexCount;
+    uint32_t vertexCount;
+    float bounds[4];
+};
+
+static_assert(sizeof(MeshFileHeader) == 56 && sizeof(MeshFileEntry) == 80, "Mesh file structs need to match the file layout");
+
+struct MeshData
+{
+    string name;
+    vector<BasicVertex> vertices;
+    vector<uint32_t> indices;
+};
+
+// Triangulates a polygon the same way Renderer::triangulateModel does
+MeshData buildPolygonMesh(const string& name, const vector<vec2>& outline, const vector<vector<vec2>>& holes = {}, const vector<pair<uint32_t, uint32_t>>& edges = {});
+
+// Meshes are written as they are, run prepareMesh on them first for static geometry
+void writeMeshFile(const string& path, const vector<MeshData>& meshes);
+
+// Validated view of a mapped mesh file. Nothing is parsed or copied.
+class MeshFile
+{
+    MappedFile file;
+    const MeshFileHeader* header = nullptr;
+    const MeshFileEntry* entries = nullptr;
+public:
+    MeshFile() {}
+    MeshFile(const string& path);
+
+    inline const MeshFileHeader& getHeader() { return *header; }
+    inline uint32_t getMeshCount() { return header->meshCount; }
+    inline const MeshFileEntry& getMesh(uint32_t index) { return entries[index]; }
+
+    inline const uint8_t* getVertexData() { return file.getData() + header->vertexOffset; }
+    inline const uint8_t* getIndexData() { return file.getData() + header->indexOffset; }
+
+    inline bool isOpen() { return file.isOpen(); }
+    void close();
+};
+
+// Meshes from a mesh file in shared GPU buffers, drawn like a StaticMeshRegistry. The
+// file stays mapped until the first bind copies it into the staging buffer.
+class MeshAsset
+{
+    MeshFile file;
+
+    vki::Buffer vertexBuffer;
+    TrackedMemory vertexMemory;
+
+    vki::Buffer indexBuffer;
+    TrackedMemory indexMemory;
+    vk::IndexType indexType = vk::IndexType::eUint32;
+
+    vector<string> names;
+    vector<MeshHandle> meshes;
+    vector<vec4> bounds;
+public:
+    Renderer* renderer;
+
+    MeshAsset(Renderer* renderer, const string& path);
+
+    // Records the copies in the pre-pass command buffer, so it has to happen during a frame.
+    // Binding uploads automatically.
+    void upload();
+    void bind(vki::CommandBuffer& cmds);
+    // The asset has to be bound
+    void draw(vki::CommandBuffer& cmds, uint32_t mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+    optional<uint32_t> find(const string& name);
+    inline MeshHandle getMesh(uint32_t mesh) { return meshes[mesh]; }
+    inline size_t size() { return meshes.size(); }
+
+    // For Scene and drawModel. The asset needs to outlive it.
+    shared_ptr<BaseModel> getModel(uint32_t mesh);
+};
+
+class AssetMesh final : public BaseModel
+{
+    MeshAsset* asset;
+public:
+    using VertexType = BasicVertex;
+
+    uint32_t mesh;
+
+    AssetMesh(MeshAsset* asset, uint32_t mesh);
+
+    void bind(vki::CommandBuffer& cmds) override;
+    void draw(vki::CommandBuffer& cmds) override;
+    void drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance) override;
+};
@@ -2,38 +2,83 @@
 
 #include "utils.hpp"
 #include "BaseModel.hpp"
+#include "Mesh.hpp"
 
 template <typename TVertex>
-class Model : public BaseModel
+class Model final : public BaseModel
 {
     vki::Buffer handle;
-    vki::DeviceMemory memory;
+    TrackedMemory memory;
 
     vki::Buffer indicesHandle;
-    vki::DeviceMemory indicesMemory;
+    TrackedMemory indicesMemory;
+    vk::IndexType indexType = vk::IndexType::eUint32;
 public:
+    using VertexType = TVertex;
+
     vector<TVertex> vertices;
     vector<uint32_t> indices;
 
-    Model(Renderer* renderer, vector<TVertex>& vertices, vector<uint32_t>& indices);
+    // Only filled in when the mesh was optimized
+    MeshReport report;
+
+    // Indices are uploaded as 16 bit when there are few enough vertices. Optimizing runs
+    // prepareMesh first, which reorders and merges vertices.
+    Model(Renderer* renderer, vector<TVertex>& vertices, vector<uint32_t>& indices, bool optimize = false);
 
     void bind(vki::CommandBuffer& cmds) override;
     void draw(vki::CommandBuffer& cmds) override;
+    void drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance) override;
+
+    bool getGeometry(vector<vec2>& positions, vector<uint32_t>& indices) override;
 };
 
 template<typename TVertex>
-inline Model<TVertex>::Model(Renderer* renderer, vector<TVertex>& vertices, vector<uint32_t>& indices) : vertices(vertices), handle({}), memory({}), indices(indices), indicesHandle({}), indicesMemory({})
+inline Model<TVertex>::Model(Renderer* renderer, vector<TVertex>& vertices, vector<uint32_t>& indices, bool optimize) : vertices(vertices), handle({}), memory({}), indices(indices), indicesHandle({}), indicesMemory({})
 {
     this->renderer = renderer;
-    renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, handle, memory, vertices);
-    renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indicesHandle, indicesMemory, indices);
+    geometryVersion = nextGeometryVersion++;
+
+    if (optimize)
+    {
+        if constexpr (GenericVertex2D<TVertex> && equality_comparable<TVertex>)
+        {
+            report = prepareMesh(this->vertices, this->indices);
+            renderer->log("Optimized mesh: " + describe(report));
+        }
+        else
+        {
+            throw std::runtime_error("Optimizing a mesh needs 2D vertices with operator==");
+        }
+    }
+
+    if constexpr (GenericVertex2D<TVertex>)
+    {
+        bounds = computeBounds(this->vertices);
+        hasBounds = !this->vertices.empty();
+    }
+
+    indexType = getIndexType(this->vertices.size());
+
+    renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, handle, memory, this->vertices);
+
+    if (indexType == vk::IndexType::eUint16)
+    {
+        vector<uint16_t> packed(this->indices.size());
+        packIndices(this->indices, this->vertices.size(), packed.data());
+        renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indicesHandle, indicesMemory, packed);
+    }
+    else
+    {
+        renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indicesHandle, indicesMemory, this->indices);
+    }
 }
 
 template<typename TVertex>
 inline void Model<TVertex>::bind(vki::CommandBuffer& cmds)
 {
     cmds.bindVertexBuffers(0, { handle }, { 0 });
-    cmds.bindIndexBuffer(indicesHandle, 0, vk::IndexType::eUint32);
+    cmds.bindIndexBuffer(indicesHandle, 0, indexType);
 }
 
 template<typename TVertex>
@@ -41,4 +86,33 @@ inline void Model<TVertex>::draw(vki::CommandBuffer& cmds)
 {
     bind(cmds);
     cmds.drawIndexed(indices.size(), 1, 0, 0, 0);
+    renderer->countDraw();
+}
+
+template<typename TVertex>
+inline void Model<TVertex>::drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance)
+{
+    bind(cmds);
+    cmds.drawIndexed(indices.size(), instanceCount, 0, 0, firstInstance);
+    renderer->countDraw(instanceCount);
+}
+
+template<typename TVertex>
+inline bool Model<TVertex>::getGeometry(vector<vec2>& positions, vector<uint32_t>& indices)
+{
+    if constexpr (GenericVertex2D<TVertex>)
+    {
+        positions.clear();
+        for (const auto& i : vertices)
+        {
+            positions.push_back(i.pos);
+        }
+
+        indices = this->indices;
+        return true;
+    }
+    else
+    {
+        return false;
+    }
 }
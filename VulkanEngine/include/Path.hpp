@@ -0,0 +1,162 @@
+#pragma once
+
+#include "utils.hpp"
+
+enum class LineJoin
+{
+    Miter,
+    Bevel,
+    Round
+};
+
+enum class LineCap
+{
+    Butt,
+    Square,
+    Round
+};
+
+struct StrokeStyle
+{
+    float width = 1;
+    LineJoin join = LineJoin::Miter;
+    LineCap cap = LineCap::Butt;
+    // Miters longer than this times the width turn into bevels
+    float miterLimit = 4;
+    // Furthest flattened curves and round joins may stray from the real shape, in world units
+    float tolerance = 0.25f;
+
+    inline bool operator==(const StrokeStyle&) const = default;
+};
+
+// Lines and Bézier curves in world space. Every edit bumps the version so tessellated
+// strokes can be cached until the path changes.
+class Path
+{
+    enum class Verb : uint8_t
+    {
+        Move,
+        Line,
+        Quad,
+        Cubic,
+        Close
+    };
+
+    vector<Verb> verbs;
+    vector<vec2> points;
+
+    uint64_t id;
+    uint64_t version = 0;
+public:
+    Path();
+    // Copies get a new id, otherwise editing them apart would give different geometry the
+    // same id and version. A moved from path gets a new id for the same reason.
+    Path(const Path& other);
+    Path(Path&& other) noexcept;
+    Path& operator=(const Path& other);
+    Path& operator=(Path&& other) noexcept;
+
+    void moveTo(vec2 p);
+    void lineTo(vec2 p);
+    void quadTo(vec2 control, vec2 p);
+    void cubicTo(vec2 control1, vec2 control2, vec2 p);
+    void close();
+    void clear();
+
+    // Calls func(const vector<vec2>& points, bool closed) for each subpath with curves
+    // split into lines no further than tolerance from the curve
+    template <typename F>
+    void flatten(float tolerance, F func) const;
+
+    inline uint64_t getId() const { return id; }
+    inline uint64_t getVersion() const { return version; }
+    inline bool empty() const { return verbs.empty(); }
+};
+
+// Appends triangles covering the stroke. Indices are relative to the start of positions.
+void strokePolyline(const vec2* points, size_t count, bool closed, const StrokeStyle& style, vector<vec2>& positions, vector<uint32_t>& indices);
+void strokePath(const Path& path, const StrokeStyle& style, vector<vec2>& positions, vector<uint32_t>& indices);
+
+// Line segments needed to keep a curve within tolerance
+int quadSegments(vec2 p0, vec2 p1, vec2 p2, float tolerance);
+int cubicSegments(vec2 p0, vec2 p1, vec2 p2, vec2 p3, float tolerance);
+
+template<typename F>
+inline void Path::flatten(float tolerance, F func) const
+{
+    vector<vec2> contour;
+    bool closed = false;
+    size_t p = 0;
+
+    auto finish = [&]()
+    {
+        if (contour.size() > 1)
+        {
+            func(contour, closed);
+        }
+
+        contour.clear();
+        closed = false;
+    };
+
+    for (auto verb : verbs)
+    {
+        switch (verb)
+        {
+        case Verb::Move:
+            finish();
+            contour.push_back(points[p++]);
+            break;
+        case Verb::Line:
+            contour.push_back(points[p++]);
+            break;
+        case Verb::Quad:
+        {
+            auto p0 = contour.back();
+            auto p1 = points[p];
+            auto p2 = points[p + 1];
+            auto n = quadSegments(p0, p1, p2, tolerance);
+
+            for (int i = 1; i <= n; i++)
+            {
+                float t = static_cast<float>(i) / n;
+                float u = 1 - t;
+                contour.push_back(u * u * p0 + 2 * u * t * p1 + t * t * p2);
+            }
+
+            p += 2;
+            break;
+        }
+        case Verb::Cubic:
+        {
+            auto p0 = contour.back();
+            auto p1 = points[p];
+            auto p2 = points[p + 1];
+            auto p3 = points[p + 2];
+            auto n = cubicSegments(p0, p1, p2, p3, tolerance);
+
+            for (int i = 1; i <= n; i++)
+            {
+                float t = static_cast<float>(i) / n;
+                float u = 1 - t;
+                contour.push_back(u * u * u * p0 + 3 * u * u * t * p1 + 3 * u * t * t * p2 + t * t * t * p3);
+            }
+
+            p += 3;
+            break;
+        }
+        case Verb::Close:
+        {
+            closed = true;
+            auto start = contour.empty() ? vec2(0) : contour.front();
+            finish();
+
+            // Drawing on after a close starts from the same point
+            contour.push_back(start);
+            break;
+        }
+        }
+    }
+
+    finish();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "utils.hpp"
+
+class Renderer; // Forward declaration
+class Font;
+
+// Frame times, draw counts, uploads and memory drawn over the frame. Set Renderer::hud and
+// it's drawn at the end of every frame from the last frame's stats.
+//
+//     renderer->hud = make_shared<PerformanceHud>(renderer, font);
+//
+// The HUD times itself. When it costs more than its budget the text is refreshed less
+// often, so turning it on doesn't change what it's measuring by much.
+class PerformanceHud
+{
+    shared_ptr<Font> font;
+
+    // Ring buffers of the last frames, in ms
+    vector<float> frameTimes;
+    vector<float> gpuTimes;
+    size_t next = 0;
+
+    vector<string> lines;
+    uint64_t lastRefresh = 0;
+    // Frames between label updates, grown and shrunk to stay in budget
+    uint32_t refreshInterval = 1;
+
+    float cost = 0;
+
+    void refreshLines();
+public:
+    Renderer* renderer;
+
+    // From the top left corner of the screen
+    ivec2 position = { 8, 8 };
+    vec4 textColor = { 1, 1, 1, 1 };
+    vec4 backgroundColor = { 0, 0, 0, 0.6f };
+
+    // CPU time the HUD may take per frame, in ms
+    float budget = 0.25f;
+
+    // Height of the graph and the frame time that fills it, in ms
+    int graphHeight = 48;
+    float graphScale = 33.3f;
+    // Frame times above these are drawn yellow and red
+    float warnTime = 16.7f;
+    float badTime = 33.3f;
+
+    // The HUD is queued after everything else in the frame, so this only matters against
+    // shapes queued right before it
+    float layer = 1000;
+
+    PerformanceHud(Renderer* renderer, shared_ptr<Font> font, size_t samples = 120);
+
+    void draw();
+
+    // CPU time the last draw took, in ms
+    inline float getCost() const { return cost; }
+    inline uint32_t getRefreshInterval() const { return refreshInterval; }
+};
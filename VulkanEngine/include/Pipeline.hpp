@@ -6,6 +6,21 @@
 #include "Datatypes.hpp"
 #include "UniformSet.hpp"
 
+struct PipelineSettings
+{
+    bool alphaBlending = false;
+    // With alphaBlending, for sources whose color is already multiplied by alpha
+    bool premultipliedAlpha = false;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+
+    // Only does anything when the renderer has a depth buffer
+    bool depthTest = false;
+    bool depthWrite = false;
+
+    // Bound as sets 1 and up, after the UBO set
+    vector<vk::DescriptorSetLayout> extraSetLayouts;
+};
+
 class Pipeline
 {
     vki::DescriptorSetLayout descriptorLayout;
@@ -20,13 +35,12 @@ public:
     vki::Pipeline handle;
     vki::PipelineLayout layout;
 
-    vk::Viewport viewport;
-    vk::Rect2D scissor;
-
-    Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, VertexDefinition vertexDef, vk::DeviceSize uboSize);
+    Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, VertexDefinition vertexDef, vk::DeviceSize uboSize, PipelineSettings settings = {});
 
     void beginFrame();
     void bind(vki::CommandBuffer& cmds);
 
     shared_ptr<UniformSet> getUniformSet();
+
+    inline vk::DeviceSize getUBOSize() const { return uboSize; }
 };
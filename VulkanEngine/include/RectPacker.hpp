@@ -0,0 +1,32 @@
+#pragma once
+
+#include "utils.hpp"
+
+// Skyline packer for atlases. Rectangles go wherever they leave the lowest top edge,
+// which keeps the wasted space under the skyline small for similar sized items.
+class RectPacker
+{
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    int width;
+    int height;
+
+    vector<Segment> skyline;
+
+    // Height the rectangle would sit at if placed at segment index, -1 if it doesn't fit
+    int fit(size_t index, int rectWidth, int rectHeight);
+public:
+    RectPacker(int width, int height);
+
+    // Bottom left corner of the packed rectangle, or nothing when the atlas is full
+    optional<ivec2> pack(int rectWidth, int rectHeight);
+    void clear();
+
+    inline int getWidth() { return width; }
+    inline int getHeight() { return height; }
+};
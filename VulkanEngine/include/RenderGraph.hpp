@@ -0,0 +1,186 @@
+#pragma once
+
+#include "utils.hpp"
+#include "MemoryTracker.hpp"
+
+#include <functional>
+
+class Renderer; // Forward declaration
+
+// How a pass uses a resource, which decides the barriers and image layouts around it
+enum class ResourceUsage
+{
+    None,
+    TransferRead,
+    TransferWrite,
+    ComputeRead,
+    // Storage buffers and images, read or written
+    ComputeWrite,
+    IndirectRead,
+    VertexRead,
+    FragmentRead,
+    ColorAttachment,
+    DepthAttachment,
+    Present
+};
+
+struct RenderGraphStats
+{
+    uint32_t passes = 0;
+    uint32_t culled = 0;
+    uint32_t levels = 0;
+    uint32_t barriers = 0;
+    // Memory of transient images, and what it would be without aliasing
+    vk::DeviceSize transientBytes = 0;
+    vk::DeviceSize unaliasedBytes = 0;
+    // Times the graph's shape changed and it had to be compiled again
+    uint32_t compiles = 0;
+};
+
+// Work that runs before the frame, declared as passes that read and write resources.
+// Passes and resources are declared again every frame, and at the end of the frame the
+// graph drops passes nothing uses, groups the rest into levels that don't depend on
+// each other, and puts one batched barrier before each level. Transient images that
+// are never in use at the same time share memory. All of that is cached until the
+// passes or resources declared change.
+//
+//     auto counts = graph->importBuffer("counts", buffer, ResourceUsage::None, ResourceUsage::IndirectRead);
+//     graph->addPass("cull", [&](RenderGraph::PassBuilder& pass)
+//     {
+//         pass.write(counts, ResourceUsage::ComputeWrite);
+//     }, [=](vki::CommandBuffer& cmds)
+//     {
+//         // Dispatch
+//     });
+class RenderGraph
+{
+public:
+    using Resource = uint32_t;
+
+    class PassBuilder
+    {
+        RenderGraph& graph;
+        size_t pass;
+
+        PassBuilder(RenderGraph& graph, size_t pass);
+
+        friend class RenderGraph;
+    public:
+        void read(Resource resource, ResourceUsage usage);
+        void write(Resource resource, ResourceUsage usage);
+        // Never culled, for passes with effects the graph can't see
+        void keep();
+    };
+
+private:
+    struct ResourceInfo
+    {
+        string name;
+        bool imported;
+        bool isImage;
+
+        vk::Buffer buffer;
+        vk::Image image;
+        vk::ImageView view;
+        vk::ImageAspectFlags aspect;
+
+        // How an imported resource is used before and after the graph
+        ResourceUsage before = ResourceUsage::None;
+        ResourceUsage after = ResourceUsage::None;
+
+        // Transient images
+        uint32_t width = 0;
+        uint32_t height = 0;
+        vk::Format format = vk::Format::eUndefined;
+    };
+
+    struct Access
+    {
+        Resource resource;
+        ResourceUsage usage;
+        bool write;
+    };
+
+    struct Pass
+    {
+        string name;
+        vector<Access> accesses;
+        bool keep = false;
+        function<void(vki::CommandBuffer&)> execute;
+    };
+
+    struct Barrier
+    {
+        Resource resource;
+        vk::PipelineStageFlags2 srcStage;
+        vk::AccessFlags2 srcAccess;
+        vk::PipelineStageFlags2 dstStage;
+        vk::AccessFlags2 dstAccess;
+        vk::ImageLayout oldLayout;
+        vk::ImageLayout newLayout;
+    };
+
+    struct Transient
+    {
+        vki::Image image = { nullptr };
+        vki::ImageView view = { nullptr };
+    };
+
+    // Everything worked out from the graph's shape, so it doesn't depend on the handles
+    // of imported resources
+    struct Compiled
+    {
+        uint64_t shape;
+
+        // Passes by level, in the order they were added
+        vector<vector<size_t>> levels;
+        // Before each level, then after the last one
+        vector<vector<Barrier>> barriers;
+
+        vector<TrackedMemory> memory;
+        // By resource, empty for imported ones
+        vector<Transient> transients;
+
+        RenderGraphStats stats;
+    };
+
+    Renderer* renderer;
+
+    vector<ResourceInfo> resources;
+    vector<Pass> passes;
+
+    shared_ptr<Compiled> compiled;
+    // Replaced compiles, kept until the frames that used them are done
+    vector<pair<uint64_t, shared_ptr<Compiled>>> retired;
+
+    uint32_t compiles = 0;
+
+    uint64_t hashShape();
+    shared_ptr<Compiled> compile(uint64_t shape);
+    void allocateTransients(Compiled& result, const vector<pair<size_t, size_t>>& lifetimes);
+    void recordBarriers(vki::CommandBuffer& cmds, const vector<Barrier>& barriers);
+public:
+    RenderGraph(Renderer* renderer);
+
+    // Owned by the caller. before and after say how it's used outside of the graph, and
+    // an image used by nothing before it loses its contents.
+    Resource importBuffer(const string& name, vk::Buffer buffer, ResourceUsage before = ResourceUsage::None, ResourceUsage after = ResourceUsage::None);
+    Resource importImage(const string& name, vk::Image image, vk::ImageView view, vk::ImageAspectFlags aspect, ResourceUsage before = ResourceUsage::None, ResourceUsage after = ResourceUsage::None);
+    // Owned by the graph and only valid during its passes, so something has to write it
+    // before anything reads it
+    Resource createImage(const string& name, uint32_t width, uint32_t height, vk::Format format);
+
+    void addPass(const string& name, function<void(PassBuilder&)> setup, function<void(vki::CommandBuffer&)> execute);
+
+    // For use inside passes
+    vk::Buffer getBuffer(Resource resource);
+    vk::Image getImage(Resource resource);
+    vk::ImageView getImageView(Resource resource);
+
+    // Records the passes and clears them for the next frame. The renderer calls this at
+    // the end of every frame.
+    void execute(vki::CommandBuffer& cmds);
+
+    // From the last execute
+    RenderGraphStats getStats();
+};
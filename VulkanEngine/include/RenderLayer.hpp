@@ -0,0 +1,66 @@
+#pragma once
+
+#include "utils.hpp"
+#include "MemoryTracker.hpp"
+
+class Renderer; // Forward declaration
+class Texture;
+struct RenderTarget;
+
+// Offscreen image that draws are recorded into once and then composited every frame as
+// one textured quad, until it's invalidated. Good for backgrounds and other content that
+// rarely changes.
+//
+//     if (!layer->isValid())
+//     {
+//         renderer->beginLayer(layer);
+//         // Draw as usual
+//         renderer->endLayer();
+//     }
+//
+//     renderer->drawLayer(layer);
+class RenderLayer
+{
+    vki::Image depthImage;
+    TrackedMemory depthMemory;
+    vki::ImageView depthView;
+
+    vki::Framebuffer framebuffer;
+
+    uint32_t width;
+    uint32_t height;
+
+    bool valid = false;
+    // Frame it was last drawn or composited in
+    uint64_t lastUsed = 0;
+    size_t evictionCallback;
+
+    // Makes the images, which eviction frees
+    void allocate();
+    vk::DeviceSize evict();
+
+    RenderTarget getTarget();
+
+    friend class Renderer;
+public:
+    Renderer* renderer;
+
+    // In the swap chain's format, so it can be registered as a sprite too. Null after the
+    // layer was evicted, until the next beginLayer.
+    shared_ptr<Texture> texture;
+
+    // World position of the bottom left corner. The layer captures the area from here to
+    // here plus its size, so invalidate it after moving it.
+    vec2 position;
+
+    // Layers count as caches, so when memory runs low ones that haven't been used for a
+    // few frames are freed and invalidated, unless something else holds their texture
+    RenderLayer(Renderer* renderer, uint32_t width, uint32_t height, vec2 position = { 0, 0 });
+    ~RenderLayer();
+
+    inline bool isValid() const { return valid; }
+    // Redrawn from scratch by the next beginLayer
+    inline void invalidate() { valid = false; }
+
+    uvec2 getSize();
+};
@@ -4,13 +4,49 @@
 
 class Renderer; // Forward declaration
 
+enum class RenderPassType
+{
+    // Clears the swap chain image and leaves it ready to present
+    Present,
+    // Like Present, but only clears the render area and keeps the rest of the image from
+    // the last time it was presented. Only for images that have been presented.
+    Incremental,
+    // Clears to transparent and leaves the image ready to sample
+    Offscreen
+};
+
+// What a pass draws into. The framebuffer is only used without dynamic rendering, and the
+// images only with it.
+struct RenderTarget
+{
+    vk::Image image;
+    vk::ImageView view;
+    vk::Image depthImage;
+    vk::ImageView depthView;
+    vk::Framebuffer framebuffer;
+};
+
+// Every type is compatible with the others, so the same pipelines and framebuffers work
+// with all of them. With dynamic rendering there is no render pass object, and begin and
+// end do the layout transitions it would have done.
 class RenderPass
 {
+    array<vk::ClearValue, 2> clearValues;
+
+    vk::ImageLayout getInitialLayout();
+    vk::ImageLayout getFinalLayout();
 public:
+    // Null with dynamic rendering
     vki::RenderPass handle;
     Renderer* renderer;
-    
-    RenderPass(Renderer* renderer);
 
-    vk::RenderPassBeginInfo getBeginInfo(vki::Framebuffer& framebuffer);
+    const RenderPassType type;
+
+    RenderPass(Renderer* renderer, RenderPassType type = RenderPassType::Present);
+
+    // Cover the renderer's current render area
+    void begin(vki::CommandBuffer& cmds, const RenderTarget& target);
+    void end(vki::CommandBuffer& cmds, const RenderTarget& target);
+
+    vk::RenderPassBeginInfo getBeginInfo(vk::Framebuffer framebuffer);
 };
@@ -3,11 +3,22 @@
 #include "utils.hpp"
 #include "SwapChain.hpp"
 #include "Shader.hpp"
+#include "ShaderLibrary.hpp"
+#include "JobSystem.hpp"
 #include "Pipeline.hpp"
+#include "TypedPipeline.hpp"
 #include "RenderPass.hpp"
 #include "Datatypes.hpp"
+#include "ComputePipeline.hpp"
+#include "TransformBatch.hpp"
+#include "Path.hpp"
+#include "Triangulate.hpp"
+#include "DrawContext.hpp"
+#include "RenderLayer.hpp"
+#include "DamageTracker.hpp"
+#include "RenderGraph.hpp"
+#include "MemoryTracker.hpp"
 
-#include "CDT.h"
 
 struct QueueFamilyIndices
 {
@@ -20,11 +31,68 @@ struct QueueFamilyIndices
     }
 };
 
+// Options that have to be known when the renderer is created
+struct RendererSettings
+{
+    // Adds a depth attachment and draws opaque shapes front to back before the rest
+    bool depthBuffer = false;
+    // Counts fragment shader invocations with a pipeline statistics query
+    bool measureOverdraw = false;
+    // Only redraws the parts of the screen that changed since the swap chain image was
+    // last drawn, for mostly idle screens. Only shapes, strokes, sprites and text are
+    // tracked, so frames with anything else, like models or layers, are redrawn in full.
+    bool damageTracking = false;
+    // Draws with vkCmdBeginRendering instead of render pass and framebuffer objects when
+    // the device supports it, so pipelines only depend on attachment formats and
+    // recreating the swap chain doesn't make framebuffers
+    bool dynamicRendering = true;
+};
+
+// Counters for the current frame, reset in beginFrame
+struct RenderStats
+{
+    uint32_t shapesDrawn = 0;
+    uint32_t shapesCulled = 0;
+    uint32_t opaqueShapes = 0;
+    uint32_t spritesDrawn = 0;
+    uint32_t strokeTriangles = 0;
+    uint32_t glyphsDrawn = 0;
+    uint32_t textDraws = 0; // One per font atlas page with glyphs
+    array<uint32_t, 3> polygons = {}; // Triangulated with each TriangulationMethod
+    uint32_t layersDrawn = 0;
+    uint32_t layersRedrawn = 0;
+    float redrawn = 1; // Part of the screen drawn this frame, from 0 to 1
+
+    uint32_t drawCalls = 0;
+    uint32_t instances = 0;
+    uint32_t pipelineBinds = 0;
+    // Written to host visible memory: instances, UBOs, staging and dynamic models
+    uint64_t uploadBytes = 0;
+    uint32_t allocations = 0;
+
+    // From the last frame the GPU finished, only with RendererSettings::measureOverdraw
+    uint64_t fragmentInvocations = 0;
+    float overdraw = 0; // Fragments shaded per pixel
+
+    // In ms. frameTime is between the last two beginFrame calls, cpuTime is how long the
+    // last frame took to record and gpuTime is from the last frame the GPU finished.
+    float frameTime = 0;
+    float cpuTime = 0;
+    float gpuTime = 0;
+};
+
 template <typename TVertex>
 class Model; // Forward declaration
 template <typename TVertex>
 class DynamicModel;
+template <typename TInstance>
+class InstanceBuffer;
 class BaseModel;
+class StagingBuffer;
+class Font;
+class Texture;
+class PerformanceHud;
+class FrameCapture;
 
 class Renderer
 {
@@ -55,50 +123,203 @@ public:
     long currentFlightFrame = 0;
     vki::Device device;
 
+    // Everything allocated through createBuffer and createImage. Declared before anything
+    // that owns memory, so it goes last.
+    shared_ptr<MemoryTracker> memoryTracker;
+
     shared_ptr<RenderPass> renderPass;
+    // For RenderLayers
+    shared_ptr<RenderPass> layerRenderPass;
+    // Only with RendererSettings::damageTracking
+    shared_ptr<RenderPass> incrementalRenderPass;
+
+    // Set layout of every Texture's descriptor set, one combined image sampler at binding 0
+    vki::DescriptorSetLayout textureLayout;
+    shared_ptr<StagingBuffer> staging;
+
+    // Shared by everything that runs in parallel, available to the app too
+    shared_ptr<JobSystem> jobs;
+
+    // Passes declared here run before the layers and the frame, in one submission
+    shared_ptr<RenderGraph> graph;
+
+    // Drawn over everything at the end of every frame when set
+    shared_ptr<PerformanceHud> hud;
+
+    // Records the draws of the next frames into a file when set, and is dropped once
+    // they're written. See FrameCapture.
+    shared_ptr<FrameCapture> capture;
+
+    // Embedded engine shaders. Add more and call build to create them in parallel.
+    shared_ptr<ShaderLibrary> shaders;
+
+    // Optional features that were available and got enabled
+    vk::PhysicalDeviceFeatures enabledFeatures;
+    vk::PhysicalDeviceVulkan12Features enabledFeatures12;
+    vk::PhysicalDeviceVulkan13Features enabledFeatures13;
+
+    // Sprites need descriptor indexing for the bindless texture array
+    bool bindlessSupported = false;
+    uint32_t maxBindlessTextures = 0;
+
+    // Damage tracking tells the presentation engine what changed when it can
+    bool incrementalPresentSupported = false;
+
+    // Real heap budgets and usage through VK_EXT_memory_budget
+    bool memoryBudgetSupported = false;
+
+    // RenderStats::gpuTime needs timestamps on the graphics queue
+    bool timestampsSupported = false;
 
     vk::ClearValue clearColor = { array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f } };
 
     bool enableDebugLogs = true;
 
-    Renderer(string title, GLFWwindow* window);
+    // World position of the bottom left corner of the screen
+    vec2 cameraPosition = { 0, 0 };
+
+    RenderStats stats;
+    // The finished counters of the last frame, since stats is still being filled in
+    RenderStats lastStats;
+
+    // How long each stage of the constructor took, in ms
+    vector<pair<string, double>> startupTimings;
+
+    // Frames finished since the renderer was created
+    uint64_t frameCount = 0;
+
+    RendererSettings settings;
+
+    // eUndefined without a depth buffer
+    vk::Format depthFormat = vk::Format::eUndefined;
+
+    Renderer(string title, GLFWwindow* window, RendererSettings settings = {});
 
     void beginFrame();
     void endFrame();
     void stop();
 
-    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Buffer& buffer, vki::DeviceMemory& bufferMemory);
+    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Buffer& buffer, TrackedMemory& bufferMemory, MemoryCategory category = MemoryCategory::Other);
     template <typename T>
-    void createBufferWithStaging(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Buffer& buffer, vki::DeviceMemory& bufferMemory, const vector<T>& data);
+    void createBufferWithStaging(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Buffer& buffer, TrackedMemory& bufferMemory, const vector<T>& data, MemoryCategory category = MemoryCategory::StaticGeometry);
     void copyBuffer(vki::Buffer& src, vki::Buffer& dest, vk::DeviceSize size);
 
+    // For uploads outside of a frame. Ending submits and waits for the queue.
+    vki::CommandBuffer beginSingleTimeCommands();
+    void endSingleTimeCommands(vki::CommandBuffer& cmds);
+    void createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Image& image, TrackedMemory& imageMemory, MemoryCategory category = MemoryCategory::Other);
+    vki::ImageView createImageView(vki::Image& image, vk::Format format, vk::ImageAspectFlags aspect);
+
     uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 
+    // Commands for the current frame, or the layer being drawn
+    vki::CommandBuffer& getCommandBuffer();
+    // Recorded alongside the frame but submitted before it, outside of the render pass.
+    // Use for compute and transfer work that the frame's draws depend on.
+    vki::CommandBuffer& getPrePassCommandBuffer();
+
     // Rendering
-    void drawRectangle(int x, int y, int width, int height, float rotation = 0, vec4 color = {1, 1, 1, 1});
-    void drawElipse(int x, int y, int width, int height, float rotation = 0, vec4 color = {1, 1, 1, 1});
+    void drawRectangle(int x, int y, int width, int height, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawElipse(int x, int y, int width, int height, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawRoundedRectangle(int x, int y, int width, int height, float radius, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawRing(int x, int y, int width, int height, float thickness, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+    void drawOutline(int x, int y, int width, int height, float thickness, float radius = 0, float rotation = 0, vec4 color = {1, 1, 1, 1}, float layer = 0);
+
+    // Shapes are queued and drawn together, one instanced draw per run of shapes queued
+    // with no other kind of draw between them. Within a run higher layers go on top,
+    // otherwise everything queued is drawn in order.
+    void drawShape(const ShapeInstance& shape);
+
+    // Strokes are tessellated on the CPU into one streamed vertex and index buffer, so
+    // any number of them queued in a row is one draw. Paths keep their tessellation until
+    // they change.
+    void drawPolyline(const vector<vec2>& points, const StrokeStyle& style, vec4 color = {1, 1, 1, 1}, bool closed = false);
+    void drawPath(const Path& path, const StrokeStyle& style, vec4 color = {1, 1, 1, 1});
+
+    // Adds the texture to the bindless array and returns a sprite covering all of it
+    Sprite registerTexture(shared_ptr<Texture> texture);
+    // The slot is reused once frames that might use it are done
+    void unregisterTexture(uint32_t index);
+
+    void drawSprite(const Sprite& sprite, int x, int y, int width, int height, float rotation = 0, vec4 color = {1, 1, 1, 1});
+    // Queued like shapes. Sprites from different textures still go in one draw.
+    void drawSprite(const SpriteInstance& sprite);
+
+    // Queued like shapes, with one draw per font atlas page. x and y are the start of the
+    // first line's baseline.
+    void drawText(shared_ptr<Font> font, const string& text, int x, int y, vec4 color = {1, 1, 1, 1}, float scale = 1);
+
+    // Draws everything queued so far, in the order it was queued. Done before anything
+    // that isn't queued so draws stay in order.
+    void flush();
+
+    // Everything drawn until endLayer goes into the layer instead of the frame, with the
+    // camera at the layer's position. Layers are drawn before the frame, and can't nest.
+    void beginLayer(shared_ptr<RenderLayer> layer);
+    void endLayer();
+    // One textured quad at the layer's position. Throws if it hasn't been drawn.
+    void drawLayer(shared_ptr<RenderLayer> layer, vec4 color = {1, 1, 1, 1});
+
+    // Redraws the area on every swap chain image, for changes damage tracking can't see
+    // like a registered texture being updated. Does nothing without damage tracking.
+    void addDamage(int x, int y, int width, int height);
+
+    // For drawing from another thread, see DrawContext. Can be called from any thread. The
+    // context is dropped once the last reference to it is.
+    shared_ptr<DrawContext> createDrawContext();
 
     inline void drawPolygon(initializer_list<BasicVertex> points, int x = 0, int y = 0, int width = 1, int height = 1, float rotation = 0, vec4 color = {1, 1, 1, 1});
     void drawPolygon(vector<BasicVertex>& points, int x = 0, int y = 0, int width = 1, int height = 1, float rotation = 0, vec4 color = {1, 1, 1, 1});
+    void drawPolygon(const vector<BasicVertex>& points, const vector<vector<BasicVertex>>& holes, int x = 0, int y = 0, int width = 1, int height = 1, float rotation = 0, vec4 color = {1, 1, 1, 1});
+
+    // Builds the batch's instances with SIMD and draws them in one instanced draw.
+    // Pipelines need to take Instance2D at binding 1, null uses the instanced pipeline.
+    void drawInstances(shared_ptr<BaseModel> model, const TransformBatch& batch, shared_ptr<Pipeline> pipeline = nullptr);
+    void drawRectangles(const TransformBatch& batch);
 
+    // Throws if the UBO isn't the pipeline's UBO size
     template <typename T>
     void drawModel(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, T ubo);
+    // Checked at compile time instead. Models of a final class, like Model and
+    // DynamicModel, are drawn without going through BaseModel's vtable.
+    template <derived_from<BaseModel> TModel, typename TUBO, typename TVertex, typename TInstance>
+    void drawModel(const shared_ptr<TModel>& model, const shared_ptr<TypedPipeline<TUBO, TVertex, TInstance>>& pipeline, const TUBO& ubo);
     void drawModelTemplateless(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, void* ubo);
 
     template <typename TVertex>
     shared_ptr<DynamicModel<TVertex>> getDynamicModel(vector<TVertex>& vertices, vector<uint32_t>& indices);
 
+    // Fills the outline, picking a fan, ear clipping or CDT depending on its shape
     template <GenericVertex2D TVertex>
     shared_ptr<DynamicModel<TVertex>> triangulateModel(vector<TVertex>& points);
+    // Always CDT. The model's vertices are the outline's, then the holes', and edges number
+    // them that way.
+    template <GenericVertex2D TVertex>
+    shared_ptr<DynamicModel<TVertex>> triangulateModel(const vector<TVertex>& points, const vector<vector<TVertex>>& holes, const vector<pair<uint32_t, uint32_t>>& edges = {});
+
+    // Visible world area (min x, min y, max x, max y)
+    vec4 getViewBounds();
+    // Size of the swap chain, or the layer being drawn
+    vk::Extent2D getRenderExtent();
+    // Part of it being drawn, which is all of it unless damage tracking says otherwise
+    vk::Rect2D getRenderArea();
 
     BasicUBO getNewUBO();
     BasicUBO getNewUBO(int x, int y, int width, int height, float rotation, vec4 color);
 
+    // For RenderStats, by whatever records a draw
+    inline void countDraw(uint32_t instances = 1) { stats.drawCalls++; stats.instances += instances; }
+
     void log(string txt);
 private:
     // Average C++ destruct order error
     vki::CommandPool commandPool;
     vector<vki::CommandBuffer> commandBuffers;
+    vector<vki::CommandBuffer> prePassCommandBuffers;
+    // Render graph passes, submitted right after the pre-pass
+    vector<vki::CommandBuffer> graphCommandBuffers;
+    // Layer passes, submitted between the render graph and the frame
+    vector<vki::CommandBuffer> layerCommandBuffers;
 
     vector<vki::Semaphore> imageAvailableSemaphores;
     vector<vki::Semaphore> renderFinishedSemaphores;
@@ -106,24 +327,185 @@ private:
 
     shared_ptr<Shader> basicVertShader;
     shared_ptr<Shader> basicFragShader;
-    shared_ptr<Pipeline> basicPipeline;
+    shared_ptr<TypedPipeline<BasicUBO, BasicVertex>> basicPipeline;
+
+    shared_ptr<Shader> shapeVertShader;
+    shared_ptr<Shader> shapeFragShader;
+    shared_ptr<TypedPipeline<BasicUBO, BasicVertex, ShapeInstance>> shapePipeline;
+
+    shared_ptr<Shader> shapeCoreVertShader;
+    shared_ptr<TypedPipeline<BasicUBO, BasicVertex, ShapeInstance>> shapeCorePipeline;
+
+    // Each kind of queued draw has its own queue, and runs keep the order the kinds were
+    // drawn in, so flush can draw them in that order while everything stays queued for
+    // damage tracking
+    enum class QueuedKind : uint8_t
+    {
+        Shapes,
+        Strokes,
+        Sprites,
+        Text
+    };
+
+    struct QueuedRun
+    {
+        QueuedKind kind;
+        // End of the run in its kind's queue, the index queue for strokes. Text marks its
+        // runs on the font pages.
+        size_t end;
+    };
+
+    vector<QueuedRun> queuedRuns;
+
+    // Extends the last run when it's the same kind, returns the run's index
+    uint32_t queueRun(QueuedKind kind, size_t end);
+
+    shared_ptr<InstanceBuffer<ShapeInstance>> shapeInstances;
+    vector<ShapeInstance> queuedShapes;
+    vector<ShapeInstance> opaqueShapes;
+    uint32_t shapeDepthCounter = 0;
+
+    void flushShapes(size_t from, size_t to);
+
+    vki::QueryPool overdrawQueries;
+    vector<bool> overdrawQueried;
+
+    // Start and end of each flight frame
+    vki::QueryPool timestampQueries;
+    vector<bool> timestampsQueried;
+    float timestampPeriod = 0;
+
+    chrono::steady_clock::time_point frameStart;
+    chrono::steady_clock::time_point recordStart;
+    float lastCpuTime = 0;
+    uint64_t lastAllocations = 0;
+
+    struct CachedStroke
+    {
+        uint64_t version;
+        StrokeStyle style;
+        vector<vec2> positions;
+        vector<uint32_t> indices;
+        vec4 bounds;
+        uint64_t lastUsed;
+    };
+
+    shared_ptr<Shader> strokeVertShader;
+    shared_ptr<TypedPipeline<BasicUBO, ColorVertex>> strokePipeline;
+    shared_ptr<InstanceBuffer<ColorVertex>> strokeVertices;
+    shared_ptr<InstanceBuffer<uint32_t>> strokeIndices;
+    vector<ColorVertex> queuedStrokeVertices;
+    vector<uint32_t> queuedStrokeIndices;
+    vector<vec2> strokeScratch;
+    vector<uint32_t> strokeScratchIndices;
+    // By path id, dropped after going unused for a while
+    unordered_map<uint64_t, CachedStroke> strokeCache;
+
+    void queueStroke(const vector<vec2>& positions, const vector<uint32_t>& indices, vec4 color);
+    // Every queued stroke is uploaded once per flush, at these offsets, and each run draws
+    // its part of the indices
+    void flushStrokes(size_t from, size_t to, uint32_t firstVertex, uint32_t firstIndex);
+
+    shared_ptr<Shader> spriteVertShader;
+    shared_ptr<Shader> spriteFragShader;
+    shared_ptr<TypedPipeline<BasicUBO, BasicVertex, SpriteInstance>> spritePipeline;
+    shared_ptr<InstanceBuffer<SpriteInstance>> spriteInstances;
+    vector<SpriteInstance> queuedSprites;
+
+    void flushSprites(size_t from, size_t to);
+
+    vki::DescriptorSetLayout bindlessLayout;
+    vki::DescriptorPool bindlessPool;
+    vki::DescriptorSet bindlessSet;
+
+    vector<shared_ptr<Texture>> bindlessTextures;
+    vector<uint32_t> freeBindlessSlots;
+    // Released slots per flight frame, free again after that frame's next fence wait
+    vector<vector<uint32_t>> releasedBindlessSlots;
+
+    shared_ptr<Shader> textVertShader;
+    shared_ptr<Shader> textFragShader;
+    shared_ptr<TypedPipeline<BasicUBO, BasicVertex, GlyphInstance>> textPipeline;
+    shared_ptr<InstanceBuffer<GlyphInstance>> glyphInstances;
+    vector<shared_ptr<Font>> queuedFonts;
+
+    void flushText(uint32_t run);
+
+    shared_ptr<Shader> layerFragShader;
+    shared_ptr<TypedPipeline<BasicUBO, BasicVertex, GlyphInstance>> layerPipeline;
+
+    shared_ptr<RenderLayer> currentLayer;
+    // What beginLayer replaced, put back by endLayer
+    vec2 layerSavedCamera;
+    uint32_t layerSavedDepthCounter = 0;
+    // Composited per flight frame, kept alive until that frame is done
+    vector<vector<shared_ptr<RenderLayer>>> drawnLayers;
+
+    shared_ptr<Shader> instancedVertShader;
+    shared_ptr<TypedPipeline<BasicUBO, BasicVertex, Instance2D>> instancedPipeline;
+    shared_ptr<InstanceBuffer<Instance2D>> transformInstances;
+
+    shared_ptr<Shader> gpuSceneVertShader;
+    shared_ptr<Shader> cullShader;
+    shared_ptr<TypedPipeline<BasicUBO, BasicVertex, GPUObject>> gpuScenePipeline;
+    shared_ptr<ComputePipeline> cullPipeline;
 
-    shared_ptr<Shader> elipseVertShader;
-    shared_ptr<Shader> elipseFragShader;
-    shared_ptr<Pipeline> elipsePipeline;
-    
     shared_ptr<Model<BasicVertex>> rectangle;
-    shared_ptr<Model<BasicVertex>> triangle;
 
-    int dynamicModelsThisFrame = 0;
-    vector<vector<shared_ptr<BaseModel>>> dynamicModels;
+    // One pool per vertex type, so a reused model always has the right type
+    struct DynamicModelPool
+    {
+        // Per flight frame
+        vector<vector<shared_ptr<BaseModel>>> models;
+        size_t usedThisFrame = 0;
+    };
+
+    vector<DynamicModelPool> dynamicModels;
+
+    unique_ptr<DamageTracker> damage;
+    // With damage tracking the frame's pass waits until the first draw, or the end of
+    // the frame when everything was queued
+    bool framePassBegun = false;
+    vk::Rect2D frameArea;
+    // The full or incremental pass, whichever beginFramePass began
+    shared_ptr<RenderPass> framePass;
+
+    void beginFramePass(vk::Rect2D area);
+    // Hashes everything queued into the damage tracker
+    void trackQueuedDraws();
+    // After flushing, or for frames where nothing changed
+    void discardQueued();
+
+    // Flushes, binds the pipeline and gets a uniform set for a drawModel call
+    shared_ptr<UniformSet> beginModelDraw(Pipeline& pipeline);
+    void captureModelDraw(BaseModel& model, Pipeline& pipeline, const void* ubo);
+
+    // Vertices for the points CDT adds where edges cross, with the rest of their attributes
+    // taken from the closest vertex
+    template <GenericVertex2D TVertex>
+    void addCrossings(vector<TVertex>& vertices, const vector<vec2>& added);
+
+    vector<weak_ptr<DrawContext>> drawContexts;
+    // Contexts can be created by the threads that use them, so new ones get the view from
+    // the last beginFrame instead of reading the camera
+    mutex drawContextsLock;
+    vec4 drawContextView = vec4(numeric_limits<float>::lowest(), numeric_limits<float>::lowest(), numeric_limits<float>::max(), numeric_limits<float>::max());
+
+    // Merges the contexts' draws into the queues, drawing their models as it goes
+    void flushDrawContexts();
+    void queueFromContext(DrawContext& context, const DrawContext::Mark& from, const DrawContext::Mark& to);
 
     QueueFamilyIndices findQueueFamilies(vki::PhysicalDevice device);
+    vk::Format findDepthFormat();
     void recreateSwapChain();
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 
     friend class SwapChain;
+    friend class GPUScene;
+    friend class SceneNode;
+    friend class FrameCapture;
+    friend class FrameReplay;
 
 public:
     // Thanks C++
@@ -131,48 +513,142 @@ public:
 };
 
 template<typename T>
-inline void Renderer::createBufferWithStaging(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Buffer& buffer, vki::DeviceMemory& bufferMemory, const vector<T>& data)
+inline void Renderer::createBufferWithStaging(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Buffer& buffer, TrackedMemory& bufferMemory, const vector<T>& data, MemoryCategory category)
 {
     auto size = sizeof(T) * data.size();
 
     vki::Buffer stagingBuffer = { 0 };
-    vki::DeviceMemory stagingMemory = { 0 };
-    createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingMemory);
+    TrackedMemory stagingMemory = { 0 };
+    createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingMemory, MemoryCategory::Staging);
 
     void* ptr = stagingMemory.mapMemory(0, size);
     memcpy(ptr, data.data(), size);
     stagingMemory.unmapMemory();
 
-    createBuffer(size, usage, properties, buffer, bufferMemory);
+    createBuffer(size, usage, properties, buffer, bufferMemory, category);
     copyBuffer(stagingBuffer, buffer, size);
 }
 
 template <typename T>
 inline void Renderer::drawModel(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, T ubo)
 {
-    drawModelTemplateless(model, pipeline, &ubo);
+    auto uniforms = beginModelDraw(*pipeline);
+    uniforms->setUBO(ubo);
+    uniforms->bind(getCommandBuffer());
+
+    // After setUBO checked the size, since the capture copies the pipeline's UBO size
+    if (capture)
+    {
+        captureModelDraw(*model, *pipeline, &ubo);
+    }
+
+    model->draw(getCommandBuffer());
+}
+
+template <derived_from<BaseModel> TModel, typename TUBO, typename TVertex, typename TInstance>
+inline void Renderer::drawModel(const shared_ptr<TModel>& model, const shared_ptr<TypedPipeline<TUBO, TVertex, TInstance>>& pipeline, const TUBO& ubo)
+{
+    if constexpr (requires { typename TModel::VertexType; })
+    {
+        static_assert(is_same_v<typename TModel::VertexType, TVertex>, "The model's vertices don't match the pipeline");
+    }
+
+    if (capture)
+    {
+        captureModelDraw(*model, *pipeline, &ubo);
+    }
+
+    auto uniforms = beginModelDraw(*pipeline);
+    uniforms->copyUBO(ubo);
+    uniforms->bind(getCommandBuffer());
+
+    model->draw(getCommandBuffer());
 }
 
 template <GenericVertex2D TVertex>
 inline shared_ptr<DynamicModel<TVertex>> Renderer::triangulateModel(vector<TVertex>& points)
 {
-    CDT::Triangulation<float> cdt;
-    cdt.insertVertices(points.begin(), points.end(), [](const BasicVertex& p)
-                       { return p.pos.x; }, [](const BasicVertex& p)
-                       { return p.pos.y; });
+    vector<vec2> outline;
+    outline.reserve(points.size());
 
-    cdt.eraseSuperTriangle();
+    for (const auto& i : points)
+    {
+        outline.push_back(i.pos);
+    }
 
     vector<uint32_t> indices;
+    vector<vec2> added;
+    stats.polygons[static_cast<size_t>(triangulatePolygon(outline.data(), outline.size(), indices, added))]++;
+
+    if (added.empty())
+    {
+        return getDynamicModel(points, indices);
+    }
+
+    vector<TVertex> vertices = points;
+    addCrossings(vertices, added);
+
+    return getDynamicModel(vertices, indices);
+}
+
+template <GenericVertex2D TVertex>
+inline shared_ptr<DynamicModel<TVertex>> Renderer::triangulateModel(const vector<TVertex>& points, const vector<vector<TVertex>>& holes, const vector<pair<uint32_t, uint32_t>>& edges)
+{
+    vector<vec2> outline;
+    vector<vector<vec2>> holeOutlines;
+    vector<TVertex> vertices = points;
+
+    for (const auto& i : points)
+    {
+        outline.push_back(i.pos);
+    }
 
-    for (const auto& i : cdt.triangles)
+    for (const auto& i : holes)
     {
-        indices.push_back(i.vertices[0]);
-        indices.push_back(i.vertices[1]);
-        indices.push_back(i.vertices[2]);
+        auto& hole = holeOutlines.emplace_back();
+        for (const auto& j : i)
+        {
+            hole.push_back(j.pos);
+        }
+
+        vertices.insert(vertices.end(), i.begin(), i.end());
     }
 
-    return getDynamicModel(points, indices);
+    vector<uint32_t> indices;
+    vector<vec2> added;
+    triangulatePolygon(outline, holeOutlines, edges, indices, added);
+    stats.polygons[static_cast<size_t>(TriangulationMethod::CDT)]++;
+
+    addCrossings(vertices, added);
+
+    return getDynamicModel(vertices, indices);
+}
+
+template <GenericVertex2D TVertex>
+inline void Renderer::addCrossings(vector<TVertex>& vertices, const vector<vec2>& added)
+{
+    auto count = vertices.size();
+
+    for (auto i : added)
+    {
+        size_t closest = 0;
+        float closestDistance = numeric_limits<float>::max();
+
+        for (size_t j = 0; j < count; j++)
+        {
+            auto distance = glm::distance(vec2(vertices[j].pos.x, vertices[j].pos.y), i);
+            if (distance < closestDistance)
+            {
+                closest = j;
+                closestDistance = distance;
+            }
+        }
+
+        TVertex vertex = vertices[closest];
+        vertex.pos.x = i.x;
+        vertex.pos.y = i.y;
+        vertices.push_back(vertex);
+    }
 }
 
 inline void Renderer::drawPolygon(initializer_list<BasicVertex> points, int x, int y, int width, int height, float rotation, vec4 color)
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "utils.hpp"
+#include "MemoryTracker.hpp"
+#include "Datatypes.hpp"
+#include "SpatialGrid.hpp"
+
+class Renderer; // Forward declaration
+class BaseModel;
+class Pipeline;
+class Scene;
+struct SceneBatch;
+
+// Retained node. Position, rotation and scale are inherited by children, size only
+// applies to the node's own model.
+class SceneNode
+{
+    Scene* scene;
+    SceneNode* parent;
+    vector<SceneNode*> children;
+
+    vec2 position = { 0, 0 };
+    float rotation = 0;
+    vec2 scale = { 1, 1 };
+    vec2 size = { 1, 1 };
+    vec4 color = { 1, 1, 1, 1 };
+
+    shared_ptr<BaseModel> model;
+    shared_ptr<Pipeline> pipeline;
+
+    mat3 world = mat3(1);
+
+    bool transformDirty = true;
+    bool instanceDirty = true;
+    bool queued = false;
+
+    SceneBatch* batch = nullptr;
+    uint32_t slot = 0;
+    uint32_t gridId = SpatialGrid<SceneNode*>::INVALID;
+
+    void markDirty(bool transform);
+
+    friend class Scene;
+public:
+    SceneNode(Scene* scene, SceneNode* parent);
+
+    void setPosition(vec2 position);
+    void setRotation(float rotation);
+    void setScale(vec2 scale);
+    void setSize(vec2 size);
+    void setColor(vec4 color);
+    // Pipelines need to take Instance2D at binding 1. Null uses the renderer's instanced pipeline.
+    void setModel(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline = nullptr);
+
+    inline vec2 getPosition() { return position; }
+    inline float getRotation() { return rotation; }
+    inline vec2 getScale() { return scale; }
+    inline vec2 getSize() { return size; }
+    inline vec4 getColor() { return color; }
+    inline SceneNode* getParent() { return parent; }
+    inline const vector<SceneNode*>& getChildren() { return children; }
+
+    // Only valid after Scene::update
+    inline const mat3& getWorldTransform() { return world; }
+};
+
+// Instances of every node sharing a model and pipeline, drawn with one instanced draw
+struct SceneBatch
+{
+    struct FrameData
+    {
+        vki::Buffer handle = { nullptr };
+        TrackedMemory memory = { nullptr };
+        Instance2D* mapped = nullptr;
+        size_t capacity = 0;
+
+        // Slots that changed since this frame's buffer was last written
+        uint32_t dirtyBegin = 0;
+        uint32_t dirtyEnd = 0;
+    };
+
+    shared_ptr<BaseModel> model;
+    shared_ptr<Pipeline> pipeline;
+
+    vector<Instance2D> instances;
+    vector<SceneNode*> nodes;
+
+    vector<FrameData> frames;
+
+    // Slots that passed culling this frame
+    vector<uint32_t> visible;
+
+    void markDirty(uint32_t slot);
+};
+
+class Scene
+{
+    vector<unique_ptr<SceneNode>> nodes;
+    vector<unique_ptr<SceneBatch>> batches;
+
+    vector<SceneNode*> dirtyNodes;
+
+    SpatialGrid<SceneNode*> grid;
+
+    uint32_t visibleCount = 0;
+    uint32_t culledCount = 0;
+
+    void updateTransform(SceneNode* node);
+    void writeInstance(SceneNode* node);
+    void updateBounds(SceneNode* node);
+
+    void addToBatch(SceneNode* node);
+    void removeFromBatch(SceneNode* node);
+
+    void sync(SceneBatch& batch);
+
+    friend class SceneNode;
+public:
+    Renderer* renderer;
+
+    // Skip nodes outside of Renderer::getViewBounds. Needs models with bounds.
+    bool enableCulling = true;
+
+    Scene(Renderer* renderer, float cellSize = 256);
+
+    SceneNode* createNode(SceneNode* parent = nullptr);
+    SceneNode* createNode(shared_ptr<BaseModel> model, SceneNode* parent = nullptr);
+    // Also destroys the node's children
+    void destroyNode(SceneNode* node);
+
+    // Propagates changed transforms. Costs nothing when nothing changed.
+    void update();
+    // Uploads changed instances for this frame and records the visible instances of
+    // every batch, one draw per contiguous run of slots
+    void draw();
+
+    // Instances that were drawn or culled by the last draw
+    inline uint32_t getVisibleCount() { return visibleCount; }
+    inline uint32_t getCulledCount() { return culledCount; }
+};
@@ -2,6 +2,8 @@
 
 #include "utils.hpp"
 
+#include <span>
+
 class Renderer; // Forward declaration
 
 class Shader
@@ -11,8 +13,9 @@ class Shader
     vki::ShaderModule handle;
 public:
     vk::ShaderStageFlagBits type;
-    
+
     Shader(Renderer* renderer, string filename, vk::ShaderStageFlagBits type);
+    Shader(Renderer* renderer, span<const uint32_t> code, vk::ShaderStageFlagBits type);
 
     vk::PipelineShaderStageCreateInfo getStageInfo();
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Shader.hpp"
+
+// Named shaders whose modules are all created at once on the renderer's job system.
+// The engine's own shaders are embedded at build time, so nothing is read from disk.
+class ShaderLibrary
+{
+    struct Entry
+    {
+        string name;
+        span<const uint32_t> code;
+        vk::ShaderStageFlagBits stage;
+        shared_ptr<Shader> shader;
+    };
+
+    vector<Entry> entries;
+public:
+    Renderer* renderer;
+
+    // Starts out with the embedded engine shaders, named after their source files
+    ShaderLibrary(Renderer* renderer);
+
+    // The code has to stay alive until build
+    void add(string name, span<const uint32_t> code, vk::ShaderStageFlagBits stage);
+    // Creates the modules of every shader added since the last build
+    void build();
+
+    // Throws if the shader doesn't exist or hasn't been built
+    shared_ptr<Shader> get(const string& name);
+};
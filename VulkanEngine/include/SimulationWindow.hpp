@@ -0,0 +1,167 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Window.hpp"
+#include "TripleBuffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+
+// A window that ticks its simulation at a fixed rate on a separate thread. Slow frames
+// don't slow the simulation down, and slow ticks don't drop frames. Every tick publishes
+// a copy of the state, and each frame renders the latest two with how far between them
+// it is. That puts the picture one tick behind the simulation, but keeps motion smooth
+// at any frame rate.
+//
+// tick runs on the simulation thread, so it can't use the renderer or GLFW. Read input
+// in update, which still runs on the main thread every frame.
+template <copyable TState>
+class SimulationWindow : public Window
+{
+    struct Snapshot
+    {
+        TState previous;
+        TState current;
+        // When the tick that made current was due
+        chrono::steady_clock::time_point time;
+    };
+
+    TripleBuffer<Snapshot> snapshots;
+
+    thread simulation;
+    atomic<bool> running = false;
+
+    // Set if tick threw, which gets rethrown on the main thread
+    atomic<bool> failed = false;
+    exception_ptr error;
+
+    TState initial;
+
+    void simulate();
+    void stopSimulation();
+public:
+    const double tickRate;
+    // If the simulation falls further behind than this many ticks, the rest are skipped
+    // instead of caught up. Set before run.
+    int maxCatchUp = 5;
+
+    SimulationWindow(string title, int width, int height, double tickRate = 60, TState initial = {}, RendererSettings settings = {});
+    ~SimulationWindow();
+
+    void run() override;
+
+protected:
+    // On the simulation thread. dt is always 1 / tickRate.
+    virtual void tick(TState& state, float dt) = 0;
+    // alpha goes from 0 at previous to 1 at current
+    virtual void renderSnapshot(const TState& previous, const TState& current, float alpha) = 0;
+
+    virtual void update() override {}
+    void render() override;
+};
+
+template <copyable TState>
+inline SimulationWindow<TState>::SimulationWindow(string title, int width, int height, double tickRate, TState initial, RendererSettings settings) : Window(title, width, height, settings), snapshots(Snapshot{ initial, initial, chrono::steady_clock::now() }), initial(initial), tickRate(tickRate)
+{
+    if (tickRate <= 0)
+    {
+        throw std::runtime_error("Tick rate must be positive");
+    }
+}
+
+template <copyable TState>
+inline SimulationWindow<TState>::~SimulationWindow()
+{
+    stopSimulation();
+}
+
+template <copyable TState>
+inline void SimulationWindow<TState>::run()
+{
+    running = true;
+    simulation = thread(&SimulationWindow::simulate, this);
+
+    // tick is virtual, so the thread has to be gone before the subclass is destroyed
+    try
+    {
+        Window::run();
+    }
+    catch (...)
+    {
+        stopSimulation();
+        throw;
+    }
+
+    stopSimulation();
+}
+
+template <copyable TState>
+inline void SimulationWindow<TState>::stopSimulation()
+{
+    running = false;
+
+    if (simulation.joinable())
+    {
+        simulation.join();
+    }
+}
+
+template <copyable TState>
+inline void SimulationWindow<TState>::simulate()
+{
+    auto step = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / tickRate));
+    auto dt = static_cast<float>(1.0 / tickRate);
+
+    TState previous = initial;
+    TState current = initial;
+
+    auto next = chrono::steady_clock::now() + step;
+
+    try
+    {
+        while (running)
+        {
+            // Returns right away while catching up
+            this_thread::sleep_until(next);
+
+            if (chrono::steady_clock::now() - next > step * maxCatchUp)
+            {
+                next = chrono::steady_clock::now();
+            }
+
+            previous = current;
+            tick(current, dt);
+
+            auto& snapshot = snapshots.getWriteBuffer();
+            snapshot.previous = previous;
+            snapshot.current = current;
+            snapshot.time = next;
+            snapshots.publish();
+
+            next += step;
+        }
+    }
+    catch (...)
+    {
+        error = current_exception();
+        failed.store(true, memory_order_release);
+    }
+}
+
+template <copyable TState>
+inline void SimulationWindow<TState>::render()
+{
+    if (failed.load(memory_order_acquire))
+    {
+        rethrow_exception(error);
+    }
+
+    snapshots.update();
+    const auto& snapshot = snapshots.getReadBuffer();
+
+    auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - snapshot.time).count();
+    renderSnapshot(snapshot.previous, snapshot.current, std::clamp(static_cast<float>(elapsed * tickRate), 0.0f, 1.0f));
+}
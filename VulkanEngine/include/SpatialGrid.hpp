@@ -0,0 +1,227 @@
+#pragma once
+
+#include "utils.hpp"
+
+// Uniform grid over world space bounds (min x, min y, max x, max y). Cells are hashed,
+// so the world doesn't need to be bounded. Items covering lots of cells go in a
+// separate list instead so that moving them stays cheap.
+template <typename T>
+class SpatialGrid
+{
+    struct Item
+    {
+        vec4 bounds;
+        ivec4 cells;
+        T value;
+        uint32_t stamp = 0;
+        bool oversized = false;
+        bool alive = false;
+    };
+
+    float cellSize;
+    int maxCells;
+
+    vector<Item> items;
+    vector<uint32_t> freeItems;
+    vector<uint32_t> oversizedItems;
+    unordered_map<uint64_t, vector<uint32_t>> cells;
+
+    uint32_t queryStamp = 0;
+    size_t count = 0;
+
+    static inline uint64_t key(int x, int y)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+
+    inline ivec4 cellRange(vec4 bounds)
+    {
+        return ivec4(glm::floor(bounds / cellSize));
+    }
+
+    void link(uint32_t id);
+    void unlink(uint32_t id);
+public:
+    static constexpr uint32_t INVALID = numeric_limits<uint32_t>::max();
+
+    SpatialGrid(float cellSize = 256, int maxCells = 64);
+
+    uint32_t insert(vec4 bounds, T value);
+    void move(uint32_t id, vec4 bounds);
+    void remove(uint32_t id);
+
+    // Calls func(T&) once for every item overlapping rect
+    template <typename F>
+    void query(vec4 rect, F func);
+
+    inline size_t size() { return count; }
+};
+
+template<typename T>
+inline SpatialGrid<T>::SpatialGrid(float cellSize, int maxCells) : cellSize(cellSize), maxCells(maxCells)
+{
+}
+
+template<typename T>
+inline void SpatialGrid<T>::link(uint32_t id)
+{
+    auto& item = items[id];
+    item.cells = cellRange(item.bounds);
+    item.oversized = static_cast<int64_t>(item.cells.z - item.cells.x + 1) * (item.cells.w - item.cells.y + 1) > maxCells;
+
+    if (item.oversized)
+    {
+        oversizedItems.push_back(id);
+        return;
+    }
+
+    for (int x = item.cells.x; x <= item.cells.z; x++)
+    {
+        for (int y = item.cells.y; y <= item.cells.w; y++)
+        {
+            cells[key(x, y)].push_back(id);
+        }
+    }
+}
+
+template<typename T>
+inline void SpatialGrid<T>::unlink(uint32_t id)
+{
+    auto& item = items[id];
+
+    if (item.oversized)
+    {
+        erase(oversizedItems, id);
+        return;
+    }
+
+    for (int x = item.cells.x; x <= item.cells.z; x++)
+    {
+        for (int y = item.cells.y; y <= item.cells.w; y++)
+        {
+            auto cell = cells.find(key(x, y));
+            auto& ids = cell->second;
+
+            auto i = find(ids.begin(), ids.end(), id);
+            *i = ids.back();
+            ids.pop_back();
+
+            if (ids.empty())
+            {
+                cells.erase(cell);
+            }
+        }
+    }
+}
+
+template<typename T>
+inline uint32_t SpatialGrid<T>::insert(vec4 bounds, T value)
+{
+    uint32_t id;
+
+    if (!freeItems.empty())
+    {
+        id = freeItems.back();
+        freeItems.pop_back();
+    }
+    else
+    {
+        id = static_cast<uint32_t>(items.size());
+        items.push_back({});
+    }
+
+    items[id].bounds = bounds;
+    items[id].value = value;
+    items[id].alive = true;
+    link(id);
+
+    count++;
+    return id;
+}
+
+template<typename T>
+inline void SpatialGrid<T>::move(uint32_t id, vec4 bounds)
+{
+    auto& item = items[id];
+
+    // Most moves stay within the same cells
+    if (!item.oversized && cellRange(bounds) == item.cells)
+    {
+        item.bounds = bounds;
+        return;
+    }
+
+    unlink(id);
+    item.bounds = bounds;
+    link(id);
+}
+
+template<typename T>
+inline void SpatialGrid<T>::remove(uint32_t id)
+{
+    unlink(id);
+    items[id].alive = false;
+    freeItems.push_back(id);
+    count--;
+}
+
+template<typename T>
+template<typename F>
+inline void SpatialGrid<T>::query(vec4 rect, F func)
+{
+    queryStamp++;
+
+    auto visit = [&](uint32_t id)
+    {
+        auto& item = items[id];
+
+        // Items in multiple cells only get reported once
+        if (item.stamp == queryStamp)
+        {
+            return;
+        }
+
+        item.stamp = queryStamp;
+
+        if (item.bounds.z >= rect.x && item.bounds.w >= rect.y && item.bounds.x <= rect.z && item.bounds.y <= rect.w)
+        {
+            func(item.value);
+        }
+    };
+
+    auto range = cellRange(rect);
+
+    // Iterate whichever is smaller, the cells in view or the occupied cells
+    if (static_cast<size_t>(range.z - range.x + 1) * (range.w - range.y + 1) <= cells.size())
+    {
+        for (int x = range.x; x <= range.z; x++)
+        {
+            for (int y = range.y; y <= range.w; y++)
+            {
+                auto cell = cells.find(key(x, y));
+                if (cell != cells.end())
+                {
+                    for (auto id : cell->second)
+                    {
+                        visit(id);
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        for (auto& [cellKey, ids] : cells)
+        {
+            for (auto id : ids)
+            {
+                visit(id);
+            }
+        }
+    }
+
+    for (auto id : oversizedItems)
+    {
+        visit(id);
+    }
+}
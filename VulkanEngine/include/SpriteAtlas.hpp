@@ -0,0 +1,35 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Datatypes.hpp"
+#include "RectPacker.hpp"
+
+class Renderer; // Forward declaration
+class Texture;
+
+// Packs lots of small RGBA images into one texture so sprites using any of them can be
+// drawn together. Sprites are only visible after upload.
+class SpriteAtlas
+{
+    RectPacker packer;
+    vector<uint8_t> pixels;
+
+    shared_ptr<Texture> texture;
+    uint32_t textureIndex;
+    uint32_t size;
+public:
+    Renderer* renderer;
+
+    // Registers the atlas texture with the renderer's bindless array
+    SpriteAtlas(Renderer* renderer, uint32_t size = 2048);
+    ~SpriteAtlas();
+
+    // Nothing when the atlas is full. Throws for empty images.
+    optional<Sprite> add(const uint8_t* rgba, int width, int height);
+    optional<Sprite> load(const string& path);
+
+    // Copies the whole atlas to the GPU and waits, meant for load time
+    void upload();
+
+    inline shared_ptr<Texture> getTexture() { return texture; }
+};
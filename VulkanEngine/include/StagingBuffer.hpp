@@ -0,0 +1,38 @@
+#pragma once
+
+#include "utils.hpp"
+#include "MemoryTracker.hpp"
+
+class Renderer; // Forward declaration
+
+// Per frame upload memory for copies recorded in the pre-pass command buffer. Everything
+// allocated during a frame is appended and freed once that frame's fence is waited on.
+class StagingBuffer
+{
+    struct FrameData
+    {
+        vki::Buffer handle = { nullptr };
+        TrackedMemory memory = { nullptr };
+        uint8_t* mapped = nullptr;
+
+        vk::DeviceSize capacity = 0;
+        vk::DeviceSize used = 0;
+
+        // Buffers outgrown mid frame may still be referenced by the command buffer
+        vector<pair<vki::Buffer, TrackedMemory>> retired;
+    };
+
+    vector<FrameData> frames;
+
+    void grow(FrameData& frame, vk::DeviceSize minCapacity);
+public:
+    Renderer* renderer;
+
+    StagingBuffer(Renderer* renderer, vk::DeviceSize initialCapacity = 1 << 20);
+
+    void beginFrame();
+
+    // Reserves size bytes in this frame's buffer. Copy from buffer at offset after
+    // writing through the returned pointer.
+    void* allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::Buffer& buffer, vk::DeviceSize& offset);
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "utils.hpp"
+#include "BaseModel.hpp"
+#include "InstanceBuffer.hpp"
+#include "Mesh.hpp"
+
+// Packs static meshes that share a vertex type into one vertex and one index buffer, so any
+// number of them can be drawn after a single bind. Indices stay relative to their mesh, so
+// the buffer uses 16 bit indices as long as no single mesh is too big for them.
+template <typename TVertex>
+class StaticMeshRegistry
+{
+    vki::Buffer vertexBuffer;
+    TrackedMemory vertexMemory;
+
+    vki::Buffer indexBuffer;
+    TrackedMemory indexMemory;
+    vk::IndexType indexType = vk::IndexType::eUint32;
+
+    // Replaced during this frame, the command buffer being recorded may still use them
+    vector<pair<vki::Buffer, TrackedMemory>> retired;
+    uint64_t retiredFrame = 0;
+
+    vector<TVertex> vertices;
+    vector<uint32_t> indices;
+    size_t largestMesh = 0;
+    bool dirty = false;
+
+    shared_ptr<InstanceBuffer<vk::DrawIndexedIndirectCommand>> commands;
+    vector<vk::DrawIndexedIndirectCommand> queued;
+    // Indirect draws only take a firstInstance with drawIndirectFirstInstance
+    bool queuedFirstInstance = false;
+    uint64_t commandFrame = numeric_limits<uint64_t>::max();
+public:
+    Renderer* renderer;
+
+    StaticMeshRegistry(Renderer* renderer);
+
+    // Optimizing runs prepareMesh on the mesh first
+    MeshHandle add(vector<TVertex> vertices, vector<uint32_t> indices, bool optimize = false);
+
+    // Uploads everything if meshes were added since the last upload. Waits for the device
+    // to go idle, so add meshes up front. Binding uploads automatically.
+    void upload();
+    void bind(vki::CommandBuffer& cmds);
+    // The registry has to be bound
+    void draw(vki::CommandBuffer& cmds, MeshHandle mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+    // Queued draws are recorded by drawQueued as one multi draw indirect call, or a draw
+    // each when multiDrawIndirect isn't supported, or a draw has a firstInstance and
+    // drawIndirectFirstInstance isn't. drawQueued also binds.
+    void queueDraw(MeshHandle mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+    void drawQueued(vki::CommandBuffer& cmds);
+
+    // For Scene and drawModel. The registry needs to outlive it.
+    shared_ptr<BaseModel> getModel(MeshHandle mesh);
+
+    inline size_t getVertexCount() { return vertices.size(); }
+    inline size_t getIndexCount() { return indices.size(); }
+};
+
+// A mesh in a StaticMeshRegistry usable anywhere a model is
+template <typename TVertex>
+class StaticMesh final : public BaseModel
+{
+    StaticMeshRegistry<TVertex>* registry;
+public:
+    using VertexType = TVertex;
+
+    MeshHandle mesh;
+
+    StaticMesh(StaticMeshRegistry<TVertex>* registry, MeshHandle mesh);
+
+    void bind(vki::CommandBuffer& cmds) override;
+    void draw(vki::CommandBuffer& cmds) override;
+    void drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance) override;
+};
+
+template<typename TVertex>
+inline StaticMeshRegistry<TVertex>::StaticMeshRegistry(Renderer* renderer) : vertexBuffer({}), vertexMemory({}), indexBuffer({}), indexMemory({}), renderer(renderer)
+{
+    commands = make_shared<InstanceBuffer<vk::DrawIndexedIndirectCommand>>(renderer, 64, vk::BufferUsageFlagBits::eIndirectBuffer);
+}
+
+template<typename TVertex>
+inline MeshHandle StaticMeshRegistry<TVertex>::add(vector<TVertex> vertices, vector<uint32_t> indices, bool optimize)
+{
+    if (optimize)
+    {
+        if constexpr (GenericVertex2D<TVertex> && equality_comparable<TVertex>)
+        {
+            renderer->log("Optimized mesh: " + describe(prepareMesh(vertices, indices)));
+        }
+        else
+        {
+            throw std::runtime_error("Optimizing a mesh needs 2D vertices with operator==");
+        }
+    }
+
+    MeshHandle mesh = {};
+    mesh.firstIndex = static_cast<uint32_t>(this->indices.size());
+    mesh.vertexOffset = static_cast<int32_t>(this->vertices.size());
+    mesh.indexCount = static_cast<uint32_t>(indices.size());
+
+    this->vertices.insert(this->vertices.end(), vertices.begin(), vertices.end());
+    this->indices.insert(this->indices.end(), indices.begin(), indices.end());
+    largestMesh = std::max(largestMesh, vertices.size());
+
+    dirty = true;
+    return mesh;
+}
+
+template<typename TVertex>
+inline void StaticMeshRegistry<TVertex>::upload()
+{
+    if (!dirty || vertices.empty())
+    {
+        return;
+    }
+
+    // Old buffers may still be in use by frames in flight
+    renderer->device.waitIdle();
+
+    if (retiredFrame != renderer->frameCount)
+    {
+        retired.clear();
+    }
+
+    if (*vertexBuffer)
+    {
+        retired.emplace_back(std::move(vertexBuffer), std::move(vertexMemory));
+        retired.emplace_back(std::move(indexBuffer), std::move(indexMemory));
+        vertexBuffer = { nullptr };
+        vertexMemory = { nullptr };
+        indexBuffer = { nullptr };
+        indexMemory = { nullptr };
+        retiredFrame = renderer->frameCount;
+    }
+
+    renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexMemory, vertices);
+
+    indexType = getIndexType(largestMesh);
+
+    if (indexType == vk::IndexType::eUint16)
+    {
+        vector<uint16_t> packed(indices.size());
+        packIndices(indices, largestMesh, packed.data());
+        renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexMemory, packed);
+    }
+    else
+    {
+        renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexMemory, indices);
+    }
+
+    dirty = false;
+}
+
+template<typename TVertex>
+inline void StaticMeshRegistry<TVertex>::bind(vki::CommandBuffer& cmds)
+{
+    upload();
+
+    cmds.bindVertexBuffers(0, { vertexBuffer }, { 0 });
+    cmds.bindIndexBuffer(indexBuffer, 0, indexType);
+}
+
+template<typename TVertex>
+inline void StaticMeshRegistry<TVertex>::draw(vki::CommandBuffer& cmds, MeshHandle mesh, uint32_t instanceCount, uint32_t firstInstance)
+{
+    cmds.drawIndexed(mesh.indexCount, instanceCount, mesh.firstIndex, mesh.vertexOffset, firstInstance);
+    renderer->countDraw(instanceCount);
+}
+
+template<typename TVertex>
+inline void StaticMeshRegistry<TVertex>::queueDraw(MeshHandle mesh, uint32_t instanceCount, uint32_t firstInstance)
+{
+    queued.push_back(vk::DrawIndexedIndirectCommand(mesh.indexCount, instanceCount, mesh.firstIndex, mesh.vertexOffset, firstInstance));
+    queuedFirstInstance |= firstInstance != 0;
+}
+
+template<typename TVertex>
+inline void StaticMeshRegistry<TVertex>::drawQueued(vki::CommandBuffer& cmds)
+{
+    if (queued.empty())
+    {
+        return;
+    }
+
+    bind(cmds);
+
+    if (!renderer->enabledFeatures.multiDrawIndirect || (queuedFirstInstance && !renderer->enabledFeatures.drawIndirectFirstInstance))
+    {
+        for (const auto& i : queued)
+        {
+            cmds.drawIndexed(i.indexCount, i.instanceCount, i.firstIndex, i.vertexOffset, i.firstInstance);
+            renderer->countDraw(i.instanceCount);
+        }
+
+        queued.clear();
+        queuedFirstInstance = false;
+        return;
+    }
+
+    // The indirect buffer is reset on the first queued draw of each frame
+    if (commandFrame != renderer->frameCount)
+    {
+        commands->beginFrame();
+        commandFrame = renderer->frameCount;
+    }
+
+    auto first = commands->write(queued.data(), queued.size());
+    cmds.drawIndexedIndirect(commands->getBuffer(), first * sizeof(vk::DrawIndexedIndirectCommand), static_cast<uint32_t>(queued.size()), sizeof(vk::DrawIndexedIndirectCommand));
+
+    // One call, but counted per command like the fallback
+    for (const auto& i : queued)
+    {
+        renderer->countDraw(i.instanceCount);
+    }
+
+    queued.clear();
+    queuedFirstInstance = false;
+}
+
+template<typename TVertex>
+inline shared_ptr<BaseModel> StaticMeshRegistry<TVertex>::getModel(MeshHandle mesh)
+{
+    auto model = make_shared<StaticMesh<TVertex>>(this, mesh);
+
+    if constexpr (GenericVertex2D<TVertex>)
+    {
+        vec2 lo = vec2(numeric_limits<float>::max());
+        vec2 hi = vec2(numeric_limits<float>::lowest());
+
+        for (uint32_t i = mesh.firstIndex; i < mesh.firstIndex + mesh.indexCount; i++)
+        {
+            auto pos = vec2(vertices[mesh.vertexOffset + indices[i]].pos);
+            lo = glm::min(lo, pos);
+            hi = glm::max(hi, pos);
+        }
+
+        model->bounds = vec4(lo, hi);
+        model->hasBounds = mesh.indexCount > 0;
+    }
+
+    return model;
+}
+
+template<typename TVertex>
+inline StaticMesh<TVertex>::StaticMesh(StaticMeshRegistry<TVertex>* registry, MeshHandle mesh) : registry(registry), mesh(mesh)
+{
+    this->renderer = registry->renderer;
+}
+
+template<typename TVertex>
+inline void StaticMesh<TVertex>::bind(vki::CommandBuffer& cmds)
+{
+    registry->bind(cmds);
+}
+
+template<typename TVertex>
+inline void StaticMesh<TVertex>::draw(vki::CommandBuffer& cmds)
+{
+    bind(cmds);
+    registry->draw(cmds, mesh);
+}
+
+template<typename TVertex>
+inline void StaticMesh<TVertex>::drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance)
+{
+    bind(cmds);
+    registry->draw(cmds, mesh, instanceCount, firstInstance);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "utils.hpp"
+#include "MemoryTracker.hpp"
 
 struct SwapChainSupportDetails
 {
@@ -11,15 +12,22 @@ struct SwapChainSupportDetails
 
 class Renderer; // Forward declaration
 class RenderPass;
+struct RenderTarget;
 
 class SwapChain
 {
     vector<vk::Image> images;
     vector<vki::ImageView> imageViews;
+
+    // One depth image is enough since frames use it one after another
+    vki::Image depthImage;
+    TrackedMemory depthMemory;
+    vki::ImageView depthView;
 public:
     vk::Format imageFormat;
     vk::Extent2D extent;
 
+    // Empty with dynamic rendering
     vector<vki::Framebuffer> framebuffers;
 
     vki::SwapchainKHR handle;
@@ -29,6 +37,9 @@ public:
     SwapChain(Renderer* renderer);
 
     void populateFramebuffers(shared_ptr<RenderPass> renderPass);
+
+    RenderTarget getTarget(uint32_t index);
+    inline size_t getImageCount() const { return images.size(); }
 private:
     SwapChainSupportDetails querySwapChainSupport(vki::PhysicalDevice device);
 
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "utils.hpp"
+#include "MemoryTracker.hpp"
+
+class Renderer; // Forward declaration
+class Pipeline;
+
+// Sampled 2D image with its own descriptor set, laid out for Renderer::textureLayout
+class Texture
+{
+    vki::DescriptorPool descriptorPool;
+    vki::DescriptorSet descriptorSet;
+
+    vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+public:
+    Renderer* renderer;
+
+    uint32_t width;
+    uint32_t height;
+    vk::Format format;
+
+    vki::Image image;
+    TrackedMemory memory;
+    vki::ImageView view;
+    vki::Sampler sampler;
+
+    // usage is added to sampling and uploads, like eColorAttachment to draw into it
+    Texture(Renderer* renderer, uint32_t width, uint32_t height, vk::Format format = vk::Format::eR8G8B8A8Unorm, vk::ImageUsageFlags usage = {}, MemoryCategory category = MemoryCategory::Textures);
+    // Uploads the pixels straight away, so this works outside of a frame
+    Texture(Renderer* renderer, uint32_t width, uint32_t height, const void* pixels, vk::Format format = vk::Format::eR8G8B8A8Unorm);
+
+    // PNG, JPEG, BMP, TGA and the rest of what stb_image reads, as RGBA
+    static shared_ptr<Texture> load(Renderer* renderer, const string& path);
+
+    // Replaces every pixel and waits for the copy to finish
+    void upload(const void* pixels);
+
+    // Copies a region of pixels in through the pre-pass command buffer, so only call this
+    // during a frame. rowPitch is the number of bytes between rows of data.
+    void update(uvec2 offset, uvec2 size, const void* data, size_t rowPitch);
+
+    inline uvec2 getSize() { return { width, height }; }
+
+    void bind(vki::CommandBuffer& cmds, Pipeline& pipeline, uint32_t set = 1);
+
+    static uint32_t bytesPerPixel(vk::Format format);
+};
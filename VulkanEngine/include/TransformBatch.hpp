@@ -0,0 +1,31 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Datatypes.hpp"
+
+// Structure of arrays input for building many Instance2Ds at once. Each instance is
+// translate * rotate * scale, the same as Renderer::getNewUBO.
+struct TransformBatch
+{
+    vector<float> x;
+    vector<float> y;
+    vector<float> width;
+    vector<float> height;
+    vector<float> rotation;
+    vector<vec4> color;
+
+    void reserve(size_t count);
+    void clear();
+    void push(float x, float y, float width, float height, float rotation = 0, vec4 color = {1, 1, 1, 1});
+
+    inline size_t size() const { return x.size(); }
+};
+
+// Uses AVX2 or SSE2 when the build allows, otherwise the scalar version
+void buildInstances(const float* x, const float* y, const float* width, const float* height, const float* rotation, const vec4* color, size_t count, Instance2D* out);
+void buildInstancesScalar(const float* x, const float* y, const float* width, const float* height, const float* rotation, const vec4* color, size_t count, Instance2D* out);
+
+inline void buildInstances(const TransformBatch& batch, Instance2D* out)
+{
+    buildInstances(batch.x.data(), batch.y.data(), batch.width.data(), batch.height.data(), batch.rotation.data(), batch.color.data(), batch.size(), out);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "utils.hpp"
+
+enum class TriangulationMethod
+{
+    Fan,
+    EarClip,
+    CDT
+};
+
+// Polygon outlines are in order, either winding. Output indices point into the input, or
+// past it into added for the points CDT makes where edges cross, in which case added is
+// replaced.
+
+// Single pass, also rejects outlines that wind around more than once
+bool isConvex(const vec2* points, size_t count);
+
+void triangulateFan(size_t count, vector<uint32_t>& indices);
+// False if the outline isn't simple, in which case indices are left as they were
+bool triangulateEarClip(const vec2* points, size_t count, vector<uint32_t>& indices);
+// Edges are closed rings (outlines and holes) and any extra constraint edges. Triangles
+// outside the outline or inside holes are dropped. Repeated points are merged and crossing
+// edges split.
+void triangulateCDT(const vec2* points, size_t count, const vector<pair<uint32_t, uint32_t>>& edges, vector<uint32_t>& indices, vector<vec2>& added);
+
+// Fan for convex outlines, ear clipping for small simple ones and CDT for the rest
+TriangulationMethod triangulatePolygon(const vec2* points, size_t count, vector<uint32_t>& indices, vector<vec2>& added);
+// Always CDT. Hole points are numbered after the outline's, in order, and edges use
+// that numbering.
+void triangulatePolygon(const vector<vec2>& outline, const vector<vector<vec2>>& holes, const vector<pair<uint32_t, uint32_t>>& edges, vector<uint32_t>& indices, vector<vec2>& added);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <atomic>
+
+// Hands values from one writer thread to one reader thread without locking. The writer
+// fills the write buffer and publishes it. The reader picks up the newest published
+// value with update, skipping any it missed, and neither side ever waits on the other.
+template <typename T>
+class TripleBuffer
+{
+    // Set on the middle index when it holds a value the reader hasn't taken yet
+    static constexpr uint8_t NEW_BIT = 4;
+    static constexpr uint8_t INDEX_MASK = 3;
+
+    array<T, 3> buffers;
+
+    // Only touched by the writer and the reader respectively
+    uint8_t back = 0;
+    uint8_t front = 1;
+
+    atomic<uint8_t> middle = 2;
+public:
+    inline TripleBuffer() {}
+    inline TripleBuffer(const T& initial) : buffers{ initial, initial, initial } {}
+
+    // Writer side
+    inline T& getWriteBuffer() { return buffers[back]; }
+
+    inline void publish()
+    {
+        back = middle.exchange(back | NEW_BIT, memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader side. Returns false if nothing new was published since the last update.
+    inline bool update()
+    {
+        if (!(middle.load(memory_order_relaxed) & NEW_BIT))
+        {
+            return false;
+        }
+
+        front = middle.exchange(front, memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    inline const T& getReadBuffer() const { return buffers[front]; }
+};
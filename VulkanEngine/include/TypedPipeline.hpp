@@ -0,0 +1,62 @@
+#pragma once
+
+#include "utils.hpp"
+#include "Pipeline.hpp"
+
+#include <type_traits>
+
+// Copied into the uniform buffer with memcpy
+template <typename T>
+concept UniformData = is_trivially_copyable_v<T> && is_standard_layout_v<T>;
+
+// Vertex or instance data with a static getVertexDefinition, like the ones in Datatypes.hpp
+template <typename T>
+concept VertexData = is_trivially_copyable_v<T> && requires {
+    { T::getVertexDefinition() } -> same_as<VertexDefinition>;
+};
+
+// A pipeline that knows its UBO, vertex and optional per instance type. The vertex
+// definition comes from the types, and drawModel checks the UBO and model against them
+// at compile time instead of trusting the UBO size. Instances are bound at binding 1.
+template <UniformData TUBO, VertexData TVertex, typename TInstance = void>
+class TypedPipeline : public Pipeline
+{
+    static_assert(sizeof(TUBO) % 16 == 0, "std140 rounds uniform blocks up to 16 bytes, pad the UBO to match");
+    static_assert(alignof(TUBO) <= 16, "UBOs can't need more than vec4 alignment");
+    // The smallest maxVertexInputBindingStride allowed by the spec
+    static_assert(sizeof(TVertex) <= 2048, "Vertex too large");
+public:
+    using UBOType = TUBO;
+    using VertexType = TVertex;
+    using InstanceType = TInstance;
+
+    static VertexDefinition getVertexDefinition()
+    {
+        if constexpr (is_void_v<TInstance>)
+        {
+            return TVertex::getVertexDefinition();
+        }
+        else
+        {
+            static_assert(VertexData<TInstance>, "Instances need a vertex definition");
+            static_assert(sizeof(TInstance) <= 2048, "Instance too large");
+
+            return TVertex::getVertexDefinition() + TInstance::getVertexDefinition();
+        }
+    }
+
+    inline TypedPipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, PipelineSettings settings = {}) : Pipeline(renderer, shaders, getVertexDefinition(), sizeof(TUBO), settings)
+    {
+
+    }
+
+    using Pipeline::getUniformSet;
+
+    // Gets a uniform set for this draw with the UBO already written
+    inline shared_ptr<UniformSet> getUniformSet(const TUBO& ubo)
+    {
+        auto uniforms = Pipeline::getUniformSet();
+        uniforms->copyUBO(ubo);
+        return uniforms;
+    }
+};
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "utils.hpp"
+#include "MemoryTracker.hpp"
+
+#include <cstring>
+#include <type_traits>
 
 class Pipeline; // Forward declaration
 
@@ -9,19 +13,29 @@ class UniformSet
     vki::DescriptorPool descriptorPool;
     
     vector<vki::Buffer> uniformBuffers;
-    vector<vki::DeviceMemory> uniformBuffersMemory;
+    vector<TrackedMemory> uniformBuffersMemory;
     vector<void*> uniformBuffersMapped;
     vector<vki::DescriptorSet> descriptorSets;
 
     vk::DeviceSize uboSize;
+
+    // The current frame's buffer
+    void* getMappedUBO();
 public:
     Pipeline* pipeline;
 
     UniformSet(Pipeline* pipeline, vki::DescriptorSetLayout& descriptorLayout, vk::DeviceSize uboSize);
 
-    template <typename T>
-    void setUBO(T& ubo);
+    // Throws if T isn't the size of the pipeline's UBO
+    template <typename T> requires (!is_pointer_v<T>)
+    void setUBO(const T& ubo);
+    // Copies the pipeline's UBO size from the pointer, so make sure it's big enough
     void setUBO(void* ubo);
+    // No size check, for when the type is already known to match, ex. TypedPipeline
+    template <typename T>
+    void copyUBO(const T& ubo);
+
+    inline vk::DeviceSize getUBOSize() const { return uboSize; }
 
     void bind(vki::CommandBuffer& cmds);
 
@@ -29,10 +43,24 @@ public:
     void bindAndSetUBO(T& ubo, vki::CommandBuffer& cmds);
 };
 
+template <typename T> requires (!is_pointer_v<T>)
+inline void UniformSet::setUBO(const T& ubo)
+{
+    if (sizeof(T) != uboSize)
+    {
+        throw std::runtime_error("UBO is " + to_string(sizeof(T)) + " bytes but the pipeline expects " + to_string(uboSize));
+    }
+
+    copyUBO(ubo);
+}
+
 template <typename T>
-inline void UniformSet::setUBO(T& ubo)
+inline void UniformSet::copyUBO(const T& ubo)
 {
-    setUBO(&ubo);
+    static_assert(is_trivially_copyable_v<T>, "UBOs are copied with memcpy");
+
+    // Fixed size, so the copy gets inlined
+    memcpy(getMappedUBO(), &ubo, sizeof(T));
 }
 
 template <typename T>
@@ -10,10 +10,10 @@ class Window
 public:
     unique_ptr<Renderer> renderer;
 
-    Window(string title, int width, int height);
-    ~Window();
+    Window(string title, int width, int height, RendererSettings settings = {});
+    virtual ~Window();
 
-    void run();
+    virtual void run();
 
 protected:
     virtual void update() = 0;
@@ -12,6 +12,7 @@
 #include <unordered_map>
 
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 #include <vulkan/vulkan_raii.hpp>
 #include <vulkan/vulkan_enums.hpp>
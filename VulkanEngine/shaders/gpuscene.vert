@@ -0,0 +1,28 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 color;
+} ubo;
+
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 1) in vec2 inPos;
+layout(location = 2) in vec2 inSize;
+layout(location = 3) in float inRotation;
+layout(location = 4) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    // Same as translate * rotate * scale in Renderer::getNewUBO
+    float c = cos(inRotation);
+    float s = sin(inRotation);
+    vec2 scaled = inPosition * inSize;
+    vec2 world = inPos + vec2(c * scaled.x - s * scaled.y, s * scaled.x + c * scaled.y);
+
+    gl_Position = ubo.proj * ubo.view * vec4(world, 0.0, 1.0);
+    fragColor = inColor;
+}
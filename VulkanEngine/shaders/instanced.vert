@@ -0,0 +1,23 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 color;
+} ubo;
+
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 1) in vec4 inBasis;
+layout(location = 2) in vec2 inTranslation;
+layout(location = 3) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    vec2 world = inTranslation + inPosition.x * inBasis.xy + inPosition.y * inBasis.zw;
+
+    gl_Position = ubo.proj * ubo.view * vec4(world, 0.0, 1.0);
+    fragColor = inColor;
+}
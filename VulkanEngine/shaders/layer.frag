@@ -0,0 +1,14 @@
+#version 450
+
+layout(set = 1, binding = 0) uniform sampler2D layer;
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // Layers are drawn onto transparent black with blending, so their color is already
+    // multiplied by alpha
+    outColor = texture(layer, fragUV) * vec4(fragColor.rgb * fragColor.a, fragColor.a);
+}
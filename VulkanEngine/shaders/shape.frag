@@ -0,0 +1,59 @@
+#version 450
+
+// Must match ShapeType in Datatypes.hpp
+const uint RECTANGLE = 0;
+const uint ROUNDED_RECTANGLE = 1;
+const uint ELIPSE = 2;
+const uint RING = 3;
+const uint OUTLINE = 4;
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragLocal;
+layout(location = 2) flat in vec2 fragHalfSize;
+layout(location = 3) flat in uint fragType;
+layout(location = 4) flat in vec2 fragParams;
+
+layout(location = 0) out vec4 outColor;
+
+float sdRoundedBox(vec2 p, vec2 halfSize, float radius) {
+    radius = clamp(radius, 0.0, min(halfSize.x, halfSize.y));
+    vec2 q = abs(p) - halfSize + radius;
+    return min(max(q.x, q.y), 0.0) + length(max(q, 0.0)) - radius;
+}
+
+// Approximate distance, exact on the edge which is all the antialiasing needs
+float sdElipse(vec2 p, vec2 radii) {
+    radii = max(radii, vec2(0.0001));
+    float k0 = length(p / radii);
+    float k1 = length(p / (radii * radii));
+    return k0 * (k0 - 1.0) / max(k1, 0.0001);
+}
+
+void main() {
+    float radius = fragParams.x;
+    float halfThickness = fragParams.y * 0.5;
+
+    float dist;
+    switch (fragType) {
+        case ROUNDED_RECTANGLE:
+            dist = sdRoundedBox(fragLocal, fragHalfSize, radius);
+            break;
+        case ELIPSE:
+            dist = sdElipse(fragLocal, fragHalfSize);
+            break;
+        case RING:
+            dist = abs(sdElipse(fragLocal, fragHalfSize - halfThickness)) - halfThickness;
+            break;
+        case OUTLINE:
+            dist = abs(sdRoundedBox(fragLocal, fragHalfSize - halfThickness, radius - halfThickness)) - halfThickness;
+            break;
+        default:
+            dist = sdRoundedBox(fragLocal, fragHalfSize, 0.0);
+            break;
+    }
+
+    // One pixel wide ramp across the edge, in screen space
+    float coverage = clamp(0.5 - dist / max(fwidth(dist), 0.0001), 0.0, 1.0);
+
+    outColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
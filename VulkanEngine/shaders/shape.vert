@@ -0,0 +1,47 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 color;
+} ubo;
+
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 1) in vec2 inPos;
+layout(location = 2) in vec2 inSize;
+layout(location = 3) in vec2 inOrigin;
+layout(location = 4) in float inRotation;
+layout(location = 5) in uint inType;
+layout(location = 6) in vec4 inColor;
+layout(location = 7) in vec2 inParams;
+layout(location = 8) in float inDepth;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragLocal;
+layout(location = 2) flat out vec2 fragHalfSize;
+layout(location = 3) flat out uint fragType;
+layout(location = 4) flat out vec2 fragParams;
+
+// Extra pixels around the shape so the antialiased edge isn't cut off
+const float MARGIN = 1.0;
+
+void main() {
+    // Position relative to the center of the shape
+    vec2 local = (inPosition - 0.5) * (inSize + 2.0 * MARGIN);
+    vec2 offset = local - (inOrigin - 0.5) * inSize;
+
+    float c = cos(inRotation);
+    float s = sin(inRotation);
+    vec2 world = inPos + vec2(c * offset.x - s * offset.y, s * offset.x + c * offset.y);
+
+    gl_Position = ubo.proj * ubo.view * vec4(world, 0.0, 1.0);
+    gl_Position.z = inDepth * gl_Position.w;
+
+    fragColor = inColor;
+    fragLocal = local;
+    fragHalfSize = inSize * 0.5;
+    fragType = inType;
+    fragParams = inParams;
+}
@@ -0,0 +1,53 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 color;
+} ubo;
+
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 1) in vec2 inPos;
+layout(location = 2) in vec2 inSize;
+layout(location = 3) in vec2 inOrigin;
+layout(location = 4) in float inRotation;
+layout(location = 5) in uint inType;
+layout(location = 6) in vec4 inColor;
+layout(location = 7) in vec2 inParams;
+layout(location = 8) in float inDepth;
+
+layout(location = 0) out vec4 fragColor;
+
+// Only covers the part of an opaque shape that is fully inside its edge, so the
+// fragment shader can be the flat one and nothing needs discarding. The shape
+// pipeline draws the antialiased edge afterwards.
+void main() {
+    vec2 halfSize = inSize * 0.5;
+    vec2 inner;
+
+    if (inType == 1u) {
+        // Rounded rectangle, the corner arcs stay outside the inset box
+        inner = halfSize - min(inParams.x, min(halfSize.x, halfSize.y)) * 0.2929 - 1.0;
+    } else if (inType == 2u) {
+        // Elipse, the largest box that fits inside it
+        inner = halfSize * 0.7071 - 1.0;
+    } else {
+        inner = halfSize - 1.0;
+    }
+
+    inner = max(inner, vec2(0.0));
+
+    vec2 local = (inPosition * 2.0 - 1.0) * inner;
+    vec2 offset = local - (inOrigin - 0.5) * inSize;
+
+    float c = cos(inRotation);
+    float s = sin(inRotation);
+    vec2 world = inPos + vec2(c * offset.x - s * offset.y, s * offset.x + c * offset.y);
+
+    gl_Position = ubo.proj * ubo.view * vec4(world, 0.0, 1.0);
+    gl_Position.z = inDepth * gl_Position.w;
+
+    fragColor = inColor;
+}
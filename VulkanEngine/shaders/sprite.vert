@@ -0,0 +1,36 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 color;
+} ubo;
+
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 1) in vec2 inPos;
+layout(location = 2) in vec2 inSize;
+layout(location = 3) in vec2 inOrigin;
+layout(location = 4) in float inRotation;
+layout(location = 5) in uint inTexture;
+layout(location = 6) in vec4 inUV;
+layout(location = 7) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragUV;
+layout(location = 2) flat out uint fragTexture;
+
+void main() {
+    vec2 offset = (inPosition - inOrigin) * inSize;
+
+    float c = cos(inRotation);
+    float s = sin(inRotation);
+    vec2 world = inPos + vec2(c * offset.x - s * offset.y, s * offset.x + c * offset.y);
+
+    gl_Position = ubo.proj * ubo.view * vec4(world, 0.0, 1.0);
+
+    fragColor = inColor;
+    fragUV = mix(inUV.xy, inUV.zw, inPosition);
+    fragTexture = inTexture;
+}
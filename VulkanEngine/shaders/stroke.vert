@@ -8,12 +8,11 @@ layout(binding = 0) uniform UniformBufferObject {
 } ubo;
 
 layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec4 inColor;
 
 layout(location = 0) out vec4 fragColor;
-layout(location = 1) out vec2 fragPos;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
-    fragColor = ubo.color;
-    fragPos = inPosition;
-}
\ No newline at end of file
+    gl_Position = ubo.proj * ubo.view * vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor;
+}
@@ -0,0 +1,25 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec4 color;
+} ubo;
+
+layout(location = 0) in vec2 inPosition;
+
+layout(location = 1) in vec2 inPos;
+layout(location = 2) in vec2 inSize;
+layout(location = 3) in vec4 inUV;
+layout(location = 4) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragUV;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * vec4(inPos + inPosition * inSize, 0.0, 1.0);
+
+    fragColor = inColor;
+    fragUV = mix(inUV.xy, inUV.zw, inPosition);
+}
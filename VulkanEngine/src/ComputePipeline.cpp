@@ -0,0 +1,51 @@
+#include "ComputePipeline.hpp"
+
+#include "Renderer.hpp"
+
+ComputePipeline::ComputePipeline(Renderer* renderer, shared_ptr<Shader> shader, vector<vk::DescriptorType> bindings, uint32_t pushConstantSize) : renderer(renderer), descriptorLayout({}), layout({}), handle({})
+{
+    vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        layoutBindings.push_back(vk::DescriptorSetLayoutBinding(i, bindings[i], 1, vk::ShaderStageFlagBits::eCompute));
+    }
+
+    auto layoutInfo = vk::DescriptorSetLayoutCreateInfo({}, layoutBindings);
+    descriptorLayout = renderer->device.createDescriptorSetLayout(layoutInfo);
+
+    auto pushConstantRange = vk::PushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, pushConstantSize);
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &*descriptorLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    try
+    {
+        layout = renderer->device.createPipelineLayout(pipelineLayoutInfo);
+    }
+    catch (vk::SystemError err)
+    {
+        throw std::runtime_error("Error creating compute layout");
+    }
+
+    vk::ComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.stage = shader->getStageInfo();
+    pipelineInfo.layout = layout;
+
+    try
+    {
+        handle = renderer->device.createComputePipeline(nullptr, pipelineInfo);
+    }
+    catch (vk::SystemError err)
+    {
+        throw std::runtime_error("Error creating compute pipeline");
+    }
+}
+
+void ComputePipeline::bind(vki::CommandBuffer& cmds)
+{
+    cmds.bindPipeline(vk::PipelineBindPoint::eCompute, handle);
+}
@@ -0,0 +1,124 @@
+#include "DamageTracker.hpp"
+
+DamageTracker::DamageTracker(vk::Extent2D extent, size_t imageCount) : extent(extent)
+{
+    columns = (extent.width + TILE_SIZE - 1) / TILE_SIZE;
+    rows = (extent.height + TILE_SIZE - 1) / TILE_SIZE;
+
+    tiles.resize(columns * rows, 0);
+    images.resize(imageCount, vector<uint64_t>(columns * rows, 0));
+    presented.resize(columns * rows, 0);
+}
+
+void DamageTracker::beginFrame(uint64_t seed)
+{
+    tiles.assign(columns * rows, seed ? seed : 1);
+}
+
+void DamageTracker::add(vec4 bounds, uint64_t hash)
+{
+    uvec2 min, max;
+    if (!getTiles(bounds, min, max))
+    {
+        return;
+    }
+
+    for (uint32_t y = min.y; y <= max.y; y++)
+    {
+        for (uint32_t x = min.x; x <= max.x; x++)
+        {
+            // Order matters, since draws on top of each other blend
+            auto& tile = tiles[y * columns + x];
+            tile = (tile ^ hash) * FNV_PRIME;
+            tile ^= tile >> 32;
+
+            if (tile == 0)
+            {
+                tile = 1;
+            }
+        }
+    }
+}
+
+vk::Rect2D DamageTracker::getDamage(uint32_t image)
+{
+    return getDifference(images[image]);
+}
+
+vk::Rect2D DamageTracker::getChanged()
+{
+    return getDifference(presented);
+}
+
+void DamageTracker::finishFrame(uint32_t image)
+{
+    images[image] = tiles;
+    presented = tiles;
+}
+
+void DamageTracker::invalidate(uint32_t image)
+{
+    fill(images[image].begin(), images[image].end(), 0);
+    fill(presented.begin(), presented.end(), 0);
+}
+
+void DamageTracker::invalidate(vec4 bounds)
+{
+    uvec2 min, max;
+    if (!getTiles(bounds, min, max))
+    {
+        return;
+    }
+
+    for (uint32_t y = min.y; y <= max.y; y++)
+    {
+        for (uint32_t x = min.x; x <= max.x; x++)
+        {
+            for (auto& i : images)
+            {
+                i[y * columns + x] = 0;
+            }
+
+            presented[y * columns + x] = 0;
+        }
+    }
+}
+
+bool DamageTracker::getTiles(vec4 bounds, uvec2& min, uvec2& max)
+{
+    if (bounds.z < 0 || bounds.w < 0 || bounds.x >= extent.width || bounds.y >= extent.height || bounds.x > bounds.z || bounds.y > bounds.w)
+    {
+        return false;
+    }
+
+    min = uvec2(glm::max(vec2(bounds.x, bounds.y), vec2(0))) / TILE_SIZE;
+    max = glm::min(uvec2(vec2(bounds.z, bounds.w)) / TILE_SIZE, uvec2(columns - 1, rows - 1));
+    return true;
+}
+
+vk::Rect2D DamageTracker::getDifference(const vector<uint64_t>& other)
+{
+    uvec2 min = uvec2(columns, rows);
+    uvec2 max = uvec2(0, 0);
+
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        for (uint32_t x = 0; x < columns; x++)
+        {
+            if (tiles[y * columns + x] != other[y * columns + x])
+            {
+                min = glm::min(min, uvec2(x, y));
+                max = glm::max(max, uvec2(x, y));
+            }
+        }
+    }
+
+    if (min.x > max.x)
+    {
+        return { { 0, 0 }, { 0, 0 } };
+    }
+
+    auto offset = min * TILE_SIZE;
+    auto end = glm::min((max + 1u) * TILE_SIZE, uvec2(extent.width, extent.height));
+    return { { static_cast<int32_t>(offset.x), static_cast<int32_t>(offset.y) }, { end.x - offset.x, end.y - offset.y } };
+}
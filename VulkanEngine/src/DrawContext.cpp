@@ -0,0 +1,109 @@
+#include "DrawContext.hpp"
+
+#include "Renderer.hpp"
+#include "BaseModel.hpp"
+
+#include <cstring>
+
+DrawContext::DrawContext(Renderer* renderer) : renderer(renderer)
+{
+
+}
+
+void DrawContext::drawRectangle(int x, int y, int width, int height, float rotation, vec4 color, float layer)
+{
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0, 0), rotation, ShapeType::Rectangle, color, vec2(0, 0), layer });
+}
+
+void DrawContext::drawElipse(int x, int y, int width, int height, float rotation, vec4 color, float layer)
+{
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0.5f, 0.5f), rotation, ShapeType::Elipse, color, vec2(0, 0), layer });
+}
+
+void DrawContext::drawRoundedRectangle(int x, int y, int width, int height, float radius, float rotation, vec4 color, float layer)
+{
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0, 0), rotation, ShapeType::RoundedRectangle, color, vec2(radius, 0), layer });
+}
+
+void DrawContext::drawRing(int x, int y, int width, int height, float thickness, float rotation, vec4 color, float layer)
+{
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0.5f, 0.5f), rotation, ShapeType::Ring, color, vec2(0, thickness), layer });
+}
+
+void DrawContext::drawOutline(int x, int y, int width, int height, float thickness, float radius, float rotation, vec4 color, float layer)
+{
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0, 0), rotation, ShapeType::Outline, color, vec2(radius, thickness), layer });
+}
+
+void DrawContext::drawShape(const ShapeInstance& shape)
+{
+    if (!shape.isVisible(view))
+    {
+        shapesCulled++;
+        return;
+    }
+
+    shapes.push_back(shape);
+}
+
+void DrawContext::drawPolyline(const vector<vec2>& points, const StrokeStyle& style, vec4 color, bool closed)
+{
+    strokeScratch.clear();
+    strokeScratchIndices.clear();
+    strokePolyline(points.data(), points.size(), closed, style, strokeScratch, strokeScratchIndices);
+
+    auto base = static_cast<uint32_t>(strokeVertices.size());
+
+    for (auto& i : strokeScratch)
+    {
+        strokeVertices.push_back({ i, color });
+    }
+
+    for (auto i : strokeScratchIndices)
+    {
+        strokeIndices.push_back(base + i);
+    }
+}
+
+void DrawContext::drawSprite(const Sprite& sprite, int x, int y, int width, int height, float rotation, vec4 color)
+{
+    drawSprite({ vec2(x, y), vec2(width, height), vec2(0, 0), rotation, sprite.texture, sprite.uv, color });
+}
+
+void DrawContext::drawSprite(const SpriteInstance& sprite)
+{
+    if (!renderer->bindlessSupported)
+    {
+        throw std::runtime_error("Sprites need descriptor indexing support");
+    }
+
+    if (sprite.isVisible(view))
+    {
+        sprites.push_back(sprite);
+    }
+}
+
+DrawContext::Mark DrawContext::getMark()
+{
+    return { shapes.size(), sprites.size(), strokeVertices.size(), strokeIndices.size() };
+}
+
+void DrawContext::queueModel(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, const void* ubo, size_t size)
+{
+    auto offset = ubos.size();
+    ubos.resize(offset + size);
+    memcpy(ubos.data() + offset, ubo, size);
+
+    models.push_back({ model, pipeline, offset, getMark() });
+}
+
+void DrawContext::clear()
+{
+    shapes.clear();
+    sprites.clear();
+    strokeVertices.clear();
+    strokeIndices.clear();
+    models.clear();
+    ubos.clear();
+    shapesCulled = 0;
+}
@@ -0,0 +1,190 @@
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "Font.hpp"
+
+#include "Renderer.hpp"
+
+// Empty space around each glyph so linear filtering doesn't pick up the neighbours
+constexpr int GLYPH_PADDING = 1;
+
+// Decodes one UTF-8 code point and advances i past it. Bad bytes come out as U+FFFD.
+static uint32_t nextCodepoint(const string& text, size_t& i)
+{
+    auto c = static_cast<uint8_t>(text[i++]);
+
+    if (c < 0x80)
+    {
+        return c;
+    }
+
+    int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : -1;
+    if (extra < 0 || i + extra > text.size())
+    {
+        return 0xFFFD;
+    }
+
+    uint32_t codepoint = c & (0x3F >> extra);
+    for (int j = 0; j < extra; j++)
+    {
+        codepoint = (codepoint << 6) | (static_cast<uint8_t>(text[i++]) & 0x3F);
+    }
+
+    return codepoint;
+}
+
+Font::Font(Renderer* renderer, const string& path, float pixelHeight, uint32_t pageSize) : path(path), pixelHeight(pixelHeight), renderer(renderer), pageSize(pageSize)
+{
+    auto file = readFile(path);
+    data.assign(file.begin(), file.end());
+
+    if (!stbtt_InitFont(&info, data.data(), stbtt_GetFontOffsetForIndex(data.data(), 0)))
+    {
+        throw std::runtime_error("Could not load font: " + path);
+    }
+
+    scale = stbtt_ScaleForPixelHeight(&info, pixelHeight);
+
+    int ascent, descent, lineGap;
+    stbtt_GetFontVMetrics(&info, &ascent, &descent, &lineGap);
+
+    this->ascent = ascent * scale;
+    this->descent = descent * scale;
+    lineHeight = (ascent - descent + lineGap) * scale;
+}
+
+Font::Page& Font::addPage()
+{
+    pages.push_back({ make_unique<Texture>(renderer, pageSize, pageSize, vk::Format::eR8Unorm), RectPacker(pageSize, pageSize), vector<uint8_t>(pageSize * pageSize), ivec4(pageSize, pageSize, 0, 0), {} });
+    return pages.back();
+}
+
+const Font::Glyph& Font::getGlyph(uint32_t codepoint)
+{
+    auto cached = glyphs.find(codepoint);
+    if (cached != glyphs.end())
+    {
+        return cached->second;
+    }
+
+    int advance, leftBearing;
+    stbtt_GetCodepointHMetrics(&info, codepoint, &advance, &leftBearing);
+
+    // Box is relative to the pen with y going down
+    int x0, y0, x1, y1;
+    stbtt_GetCodepointBitmapBox(&info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+
+    Glyph glyph = {};
+    glyph.advance = advance * scale;
+    glyph.offset = vec2(x0, -y1);
+    glyph.size = vec2(x1 - x0, y1 - y0);
+
+    if (glyph.size.x > 0 && glyph.size.y > 0)
+    {
+        int width = x1 - x0;
+        int height = y1 - y0;
+
+        optional<ivec2> pos;
+        if (!pages.empty())
+        {
+            pos = pages.back().packer.pack(width + GLYPH_PADDING * 2, height + GLYPH_PADDING * 2);
+        }
+
+        if (!pos)
+        {
+            pos = addPage().packer.pack(width + GLYPH_PADDING * 2, height + GLYPH_PADDING * 2);
+            if (!pos)
+            {
+                throw std::runtime_error("Glyph doesn't fit in a font atlas page");
+            }
+        }
+
+        auto& page = pages.back();
+        auto origin = *pos + GLYPH_PADDING;
+
+        stbtt_MakeCodepointBitmap(&info, page.pixels.data() + origin.y * pageSize + origin.x, width, height, pageSize, scale, scale, codepoint);
+
+        // The padding too, so the border that keeps neighbours from bleeding in is uploaded
+        page.dirty = ivec4(glm::min(ivec2(page.dirty), *pos), glm::max(ivec2(page.dirty.z, page.dirty.w), *pos + ivec2(width, height) + GLYPH_PADDING * 2));
+
+        // Rows are stored top down, so the bottom of the quad samples the last row
+        auto size = vec2(pageSize);
+        glyph.uv = vec4(vec2(origin.x, origin.y + height) / size, vec2(origin.x + width, origin.y) / size);
+        glyph.page = static_cast<uint32_t>(pages.size() - 1);
+    }
+
+    return glyphs.emplace(codepoint, glyph).first->second;
+}
+
+const Font::TextRun& Font::getRun(const string& text)
+{
+    auto cached = runs.find(text);
+    if (cached != runs.end())
+    {
+        return cached->second;
+    }
+
+    if (runs.size() >= maxCachedRuns)
+    {
+        runs.clear();
+    }
+
+    TextRun run = {};
+    run.bounds = vec4(0, 0, 0, 0);
+
+    vec2 pen = { 0, 0 };
+    uint32_t prev = 0;
+
+    for (size_t i = 0; i < text.size();)
+    {
+        auto codepoint = nextCodepoint(text, i);
+
+        if (codepoint == '\n')
+        {
+            pen = vec2(0, pen.y - lineHeight);
+            prev = 0;
+            continue;
+        }
+
+        if (prev != 0)
+        {
+            pen.x += stbtt_GetCodepointKernAdvance(&info, prev, codepoint) * scale;
+        }
+
+        auto& glyph = getGlyph(codepoint);
+
+        if (glyph.size.x > 0 && glyph.size.y > 0)
+        {
+            auto offset = pen + glyph.offset;
+            run.glyphs.push_back({ offset, glyph.size, glyph.uv, glyph.page });
+
+            run.bounds = vec4(glm::min(vec2(run.bounds), offset), glm::max(vec2(run.bounds.z, run.bounds.w), offset + glyph.size));
+        }
+
+        pen.x += glyph.advance;
+        prev = codepoint;
+    }
+
+    return runs.emplace(text, std::move(run)).first->second;
+}
+
+vec4 Font::measure(const string& text)
+{
+    return getRun(text).bounds;
+}
+
+void Font::upload()
+{
+    for (auto& page : pages)
+    {
+        if (page.dirty.x >= page.dirty.z || page.dirty.y >= page.dirty.w)
+        {
+            continue;
+        }
+
+        // Only the rectangle covering this frame's new glyphs
+        auto offset = uvec2(page.dirty.x, page.dirty.y);
+        auto size = uvec2(page.dirty.z - page.dirty.x, page.dirty.w - page.dirty.y);
+        page.texture->update(offset, size, page.pixels.data() + offset.y * pageSize + offset.x, pageSize);
+
+        page.dirty = ivec4(pageSize, pageSize, 0, 0);
+    }
+}
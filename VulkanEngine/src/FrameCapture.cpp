@@ -0,0 +1,1046 @@
+#include "FrameCapture.hpp"
+
+#include "Renderer.hpp"
+#include "Model.hpp"
+#include "DynamicModel.hpp"
+#include "Font.hpp"
+#include "Texture.hpp"
+#include "RenderLayer.hpp"
+#include "TransformBatch.hpp"
+#include "GPUScene.hpp"
+#include "SwapChain.hpp"
+
+// Type byte and payload size
+constexpr size_t RECORD_HEADER_SIZE = 1 + sizeof(uint32_t);
+
+static vector<vec2> toPositions(const vector<BasicVertex>& vertices)
+{
+    vector<vec2> positions;
+    positions.reserve(vertices.size());
+
+    for (auto& i : vertices)
+    {
+        positions.push_back(i.pos);
+    }
+
+    return positions;
+}
+
+FrameCapture::FrameCapture(Renderer* renderer, const string& path, uint32_t frames) : path(path), framesLeft(frames), renderer(renderer)
+{
+
+}
+
+template <typename T>
+void FrameCapture::put(const T& value)
+{
+    static_assert(is_trivially_copyable_v<T>, "Captures only hold plain data");
+
+    auto bytes = reinterpret_cast<const uint8_t*>(&value);
+    payload.insert(payload.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+void FrameCapture::putArray(const T* values, size_t count)
+{
+    static_assert(is_trivially_copyable_v<T>, "Captures only hold plain data");
+
+    put(static_cast<uint32_t>(count));
+    auto bytes = reinterpret_cast<const uint8_t*>(values);
+    payload.insert(payload.end(), bytes, bytes + count * sizeof(T));
+}
+
+template <typename T>
+void FrameCapture::putVector(const vector<T>& values)
+{
+    putArray(values.data(), values.size());
+}
+
+void FrameCapture::putString(const string& value)
+{
+    putArray(value.data(), value.size());
+}
+
+void FrameCapture::begin(CaptureRecord type)
+{
+    if (type != CaptureRecord::BeginFrame && type != CaptureRecord::EndFrame && renderer->cameraPosition != camera)
+    {
+        camera = renderer->cameraPosition;
+
+        current = CaptureRecord::Camera;
+        payload.clear();
+        put(camera);
+        end();
+    }
+
+    current = type;
+    payload.clear();
+}
+
+void FrameCapture::end()
+{
+    auto size = static_cast<uint32_t>(payload.size());
+
+    file.put(static_cast<char>(current));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+}
+
+void FrameCapture::beginFrame()
+{
+    if (framesLeft == 0)
+    {
+        return;
+    }
+
+    if (!file.is_open())
+    {
+        file.open(path, ios::binary | ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not write file: " + path);
+        }
+
+        CaptureFileHeader header = {};
+        memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic));
+        header.version = CAPTURE_FILE_VERSION;
+        header.depthBuffer = renderer->settings.depthBuffer;
+        header.damageTracking = renderer->settings.damageTracking;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    recording = true;
+
+    begin(CaptureRecord::BeginFrame);
+    put(renderer->swapChain->extent.width);
+    put(renderer->swapChain->extent.height);
+    end();
+
+    // Every frame starts with the camera, so frames can be replayed on their own
+    camera = vec2(numeric_limits<float>::quiet_NaN());
+
+    // Sprites can use textures registered before the capture started, or between frames
+    for (uint32_t i = 0; i < renderer->bindlessTextures.size(); i++)
+    {
+        auto& current = renderer->bindlessTextures[i];
+        if (!current)
+        {
+            continue;
+        }
+
+        // An expired texture can't share an address with the one in the slot now
+        auto found = textures.find(i);
+        if (found == textures.end() || found->second.first.lock() != current)
+        {
+            texture(i, current);
+        }
+    }
+}
+
+void FrameCapture::endFrame()
+{
+    if (!recording)
+    {
+        return;
+    }
+
+    begin(CaptureRecord::EndFrame);
+    put(renderer->clearColor.color.float32);
+    end();
+
+    recording = false;
+    framesLeft--;
+
+    if (framesLeft == 0)
+    {
+        file.close();
+        renderer->log("Captured frames to " + path);
+    }
+}
+
+uint32_t FrameCapture::getModel(BaseModel& model)
+{
+    if (model.geometryVersion == 0)
+    {
+        return UINT32_MAX;
+    }
+
+    auto found = models.find(model.geometryVersion);
+    if (found != models.end())
+    {
+        return found->second;
+    }
+
+    vector<vec2> positions;
+    vector<uint32_t> indices;
+    uint32_t id = UINT32_MAX;
+
+    if (model.getGeometry(positions, indices))
+    {
+        id = nextId++;
+
+        begin(CaptureRecord::ModelGeometry);
+        put(id);
+        put(static_cast<uint8_t>(model.dynamic));
+        putVector(positions);
+        putVector(indices);
+        end();
+    }
+
+    models[model.geometryVersion] = id;
+    return id;
+}
+
+uint32_t FrameCapture::getFont(shared_ptr<Font> font)
+{
+    auto found = fonts.find(font.get());
+    if (found != fonts.end() && found->second.first.lock() == font)
+    {
+        return found->second.second;
+    }
+
+    auto id = nextId++;
+    fonts[font.get()] = { font, id };
+
+    begin(CaptureRecord::Font);
+    put(id);
+    put(font->getPixelHeight());
+    put(font->getPageSize());
+    putString(font->getPath());
+    end();
+
+    return id;
+}
+
+void FrameCapture::putLayer(shared_ptr<RenderLayer> layer)
+{
+    auto& entry = layers[layer.get()];
+    if (entry.first.lock() != layer)
+    {
+        entry = { layer, nextId++ };
+    }
+
+    put(entry.second);
+    put(layer->getSize());
+    put(layer->position);
+}
+
+void FrameCapture::shape(const ShapeInstance& shape)
+{
+    begin(CaptureRecord::Shape);
+    put(shape);
+    end();
+}
+
+void FrameCapture::sprite(const SpriteInstance& sprite)
+{
+    auto copy = sprite;
+    auto found = textures.find(sprite.texture);
+    copy.texture = found != textures.end() ? found->second.second : UINT32_MAX;
+
+    begin(CaptureRecord::Sprite);
+    put(copy);
+    end();
+}
+
+void FrameCapture::texture(uint32_t slot, shared_ptr<Texture> texture)
+{
+    auto id = nextId++;
+    textures[slot] = { texture, id };
+
+    begin(CaptureRecord::Texture);
+    put(id);
+    put(texture->width);
+    put(texture->height);
+    put(texture->format);
+    end();
+}
+
+void FrameCapture::stroke(const vector<vec2>& points, const StrokeStyle& style, vec4 color, bool closed)
+{
+    begin(CaptureRecord::Stroke);
+    put(style);
+    put(color);
+    put(static_cast<uint8_t>(closed));
+    putVector(points);
+    end();
+}
+
+void FrameCapture::path(const Path& path, const StrokeStyle& style, vec4 color)
+{
+    auto found = paths.find(path.getId());
+    bool written = found != paths.end() && found->second == path.getVersion();
+
+    begin(CaptureRecord::Path);
+    put(path.getId());
+    put(path.getVersion());
+    put(style);
+    put(color);
+    put(static_cast<uint8_t>(!written));
+
+    if (!written)
+    {
+        // Subpath count, filled in once they're all written
+        auto countOffset = payload.size();
+        uint32_t count = 0;
+        put(count);
+
+        path.flatten(style.tolerance, [&](const vector<vec2>& points, bool closed)
+        {
+            put(static_cast<uint8_t>(closed));
+            putVector(points);
+            count++;
+        });
+
+        memcpy(payload.data() + countOffset, &count, sizeof(count));
+        paths[path.getId()] = path.getVersion();
+    }
+
+    end();
+}
+
+void FrameCapture::strokeMesh(const ColorVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+    begin(CaptureRecord::StrokeMesh);
+    putArray(vertices, vertexCount);
+    putArray(indices, indexCount);
+    end();
+}
+
+void FrameCapture::text(shared_ptr<Font> font, const string& text, int x, int y, vec4 color, float scale)
+{
+    auto id = getFont(font);
+
+    begin(CaptureRecord::Text);
+    put(id);
+    put(x);
+    put(y);
+    put(color);
+    put(scale);
+    putString(text);
+    end();
+}
+
+void FrameCapture::polygon(const vector<BasicVertex>& points, const vector<vector<BasicVertex>>* holes, int x, int y, int width, int height, float rotation, vec4 color)
+{
+    begin(CaptureRecord::Polygon);
+    put(x);
+    put(y);
+    put(width);
+    put(height);
+    put(rotation);
+    put(color);
+
+    // Polygons with holes always go through CDT, so which overload was used matters
+    put(static_cast<uint8_t>(holes != nullptr));
+    putVector(toPositions(points));
+
+    if (holes)
+    {
+        put(static_cast<uint32_t>(holes->size()));
+        for (auto& i : *holes)
+        {
+            putVector(toPositions(i));
+        }
+    }
+
+    end();
+}
+
+void FrameCapture::modelDraw(BaseModel& model, const void* ubo, size_t uboSize)
+{
+    auto id = getModel(model);
+
+    begin(CaptureRecord::ModelDraw);
+    put(id);
+    putArray(static_cast<const uint8_t*>(ubo), uboSize);
+    end();
+}
+
+void FrameCapture::instances(BaseModel& model, const TransformBatch& batch)
+{
+    auto id = getModel(model);
+
+    begin(CaptureRecord::Instances);
+    put(id);
+    putVector(batch.x);
+    putVector(batch.y);
+    putVector(batch.width);
+    putVector(batch.height);
+    putVector(batch.rotation);
+    putVector(batch.color);
+    end();
+}
+
+void FrameCapture::sceneInstances(BaseModel& model, const vector<Instance2D>& instances)
+{
+    auto id = getModel(model);
+
+    begin(CaptureRecord::SceneInstances);
+    put(id);
+    putVector(instances);
+    end();
+}
+
+void FrameCapture::gpuScene(GPUScene& scene)
+{
+    auto written = gpuScenes.find(scene.id);
+    bool changed = written == gpuScenes.end() || written->second != scene.version;
+
+    begin(CaptureRecord::GPUScene);
+    put(scene.id);
+    put(scene.version);
+    put(static_cast<uint8_t>(changed));
+
+    if (changed)
+    {
+        putVector(toPositions(scene.vertices));
+        putVector(scene.indices);
+        putVector(scene.meshes);
+        putVector(scene.objects);
+        gpuScenes[scene.id] = scene.version;
+    }
+
+    end();
+}
+
+void FrameCapture::beginLayer(shared_ptr<RenderLayer> layer)
+{
+    begin(CaptureRecord::BeginLayer);
+    putLayer(layer);
+    end();
+}
+
+void FrameCapture::endLayer()
+{
+    begin(CaptureRecord::EndLayer);
+    end();
+}
+
+void FrameCapture::drawLayer(shared_ptr<RenderLayer> layer, vec4 color)
+{
+    begin(CaptureRecord::DrawLayer);
+    putLayer(layer);
+    put(color);
+    end();
+}
+
+// Bounds checked reads from one record's payload
+struct CaptureReader
+{
+    const uint8_t* data;
+    size_t pos;
+    size_t end;
+
+    inline void check(size_t size)
+    {
+        if (size > end - pos)
+        {
+            throw std::runtime_error("Corrupt capture file");
+        }
+    }
+
+    template <typename T>
+    inline T get()
+    {
+        check(sizeof(T));
+
+        T value;
+        memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    inline vector<T> getVector()
+    {
+        auto count = get<uint32_t>();
+        check(static_cast<size_t>(count) * sizeof(T));
+
+        vector<T> values(count);
+        memcpy(values.data(), data + pos, count * sizeof(T));
+        pos += count * sizeof(T);
+        return values;
+    }
+
+    inline string getString()
+    {
+        auto chars = getVector<char>();
+        return string(chars.begin(), chars.end());
+    }
+};
+
+template <typename F>
+static void forEachRecord(const vector<uint8_t>& data, size_t start, size_t end, F func)
+{
+    auto pos = start;
+
+    while (pos < end)
+    {
+        uint32_t size;
+        memcpy(&size, data.data() + pos + 1, sizeof(size));
+
+        CaptureReader reader = { data.data(), pos + RECORD_HEADER_SIZE, pos + RECORD_HEADER_SIZE + size };
+        func(static_cast<CaptureRecord>(data[pos]), reader);
+
+        pos = reader.end;
+    }
+}
+
+static vector<BasicVertex> toVertices(const vector<vec2>& positions)
+{
+    vector<BasicVertex> vertices;
+    vertices.reserve(positions.size());
+
+    for (auto& i : positions)
+    {
+        vertices.emplace_back(i.x, i.y);
+    }
+
+    return vertices;
+}
+
+// Indices are drawn from without checks, so a bad file can't be allowed past here
+static void checkIndices(const vector<uint32_t>& indices, size_t vertexCount)
+{
+    for (auto i : indices)
+    {
+        if (i >= vertexCount)
+        {
+            throw std::runtime_error("Corrupt capture file");
+        }
+    }
+}
+
+FrameReplay::FrameReplay(const string& path)
+{
+    auto file = readFile(path);
+    data.assign(file.begin(), file.end());
+
+    if (data.size() < sizeof(CaptureFileHeader))
+    {
+        throw std::runtime_error("Not a capture file: " + path);
+    }
+
+    memcpy(&header, data.data(), sizeof(header));
+
+    if (memcmp(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic)) != 0)
+    {
+        throw std::runtime_error("Not a capture file: " + path);
+    }
+
+    if (header.version == 0 || header.version > CAPTURE_FILE_VERSION)
+    {
+        throw std::runtime_error("Unsupported capture file version " + to_string(header.version) + ": " + path);
+    }
+
+    // Every record has to fit before anything trusts the sizes
+    auto pos = sizeof(CaptureFileHeader);
+
+    while (pos < data.size())
+    {
+        if (data.size() - pos < RECORD_HEADER_SIZE)
+        {
+            throw std::runtime_error("Corrupt capture file: " + path);
+        }
+
+        auto type = static_cast<CaptureRecord>(data[pos]);
+        uint32_t size;
+        memcpy(&size, data.data() + pos + 1, sizeof(size));
+
+        auto payload = pos + RECORD_HEADER_SIZE;
+        if (size > data.size() - payload)
+        {
+            throw std::runtime_error("Corrupt capture file: " + path);
+        }
+
+        if (type == CaptureRecord::BeginFrame)
+        {
+            CaptureReader reader = { data.data(), payload, payload + size };
+            auto width = reader.get<uint32_t>();
+            auto height = reader.get<uint32_t>();
+
+            frames.push_back({ pos, 0, vk::Extent2D(width, height) });
+        }
+        else if (type == CaptureRecord::EndFrame && !frames.empty())
+        {
+            frames.back().end = payload + size;
+        }
+
+        pos = payload + size;
+    }
+
+    // The app might have stopped in the middle of the last frame
+    erase_if(frames, [](const Frame& i) { return i.end == 0; });
+
+    if (frames.empty())
+    {
+        throw std::runtime_error("No frames in capture file: " + path);
+    }
+}
+
+RendererSettings FrameReplay::getSettings()
+{
+    RendererSettings settings;
+    settings.depthBuffer = header.depthBuffer;
+    settings.damageTracking = header.damageTracking;
+    return settings;
+}
+
+void FrameReplay::prepare(Renderer* renderer)
+{
+    this->renderer = renderer;
+
+    // Whatever the frames define is made up front, so frames don't depend on each other
+    forEachRecord(data, sizeof(CaptureFileHeader), data.size(), [&](CaptureRecord type, CaptureReader& reader)
+    {
+        switch (type)
+        {
+        case CaptureRecord::Texture:
+        {
+            auto id = reader.get<uint32_t>();
+            auto width = reader.get<uint32_t>();
+            auto height = reader.get<uint32_t>();
+            auto format = reader.get<vk::Format>();
+
+            if (width == 0 || height == 0)
+            {
+                break;
+            }
+
+            // The pixels aren't captured, sampling costs the same with any content
+            vector<uint8_t> pixels(static_cast<size_t>(width) * height * Texture::bytesPerPixel(format), 0xff);
+            auto texture = make_shared<Texture>(renderer, width, height, pixels.data(), format);
+            textures[id] = { texture, renderer->registerTexture(texture) };
+            break;
+        }
+        case CaptureRecord::Font:
+        {
+            auto id = reader.get<uint32_t>();
+            auto pixelHeight = reader.get<float>();
+            auto pageSize = reader.get<uint32_t>();
+            auto path = reader.getString();
+
+            try
+            {
+                fonts[id] = make_shared<Font>(renderer, path, pixelHeight, pageSize);
+            }
+            catch (std::runtime_error& err)
+            {
+                renderer->log("Replaying without font " + path + ": " + err.what());
+                fonts[id] = nullptr;
+            }
+            break;
+        }
+        case CaptureRecord::ModelGeometry:
+        {
+            auto id = reader.get<uint32_t>();
+
+            auto& geometry = models[id];
+            geometry.dynamic = reader.get<uint8_t>();
+            geometry.vertices = toVertices(reader.getVector<vec2>());
+            geometry.indices = reader.getVector<uint32_t>();
+            checkIndices(geometry.indices, geometry.vertices.size());
+
+            if (!geometry.dynamic && !geometry.vertices.empty())
+            {
+                geometry.model = make_shared<Model<BasicVertex>>(renderer, geometry.vertices, geometry.indices);
+            }
+            break;
+        }
+        case CaptureRecord::Path:
+        {
+            auto id = reader.get<uint64_t>();
+            auto version = reader.get<uint64_t>();
+            reader.get<StrokeStyle>();
+            reader.get<vec4>();
+
+            if (!reader.get<uint8_t>())
+            {
+                break;
+            }
+
+            auto& subpaths = pathVersions[{ id, version }];
+            auto count = reader.get<uint32_t>();
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                bool closed = reader.get<uint8_t>();
+                subpaths.push_back({ closed, reader.getVector<vec2>() });
+            }
+            break;
+        }
+        case CaptureRecord::GPUScene:
+        {
+            reader.get<uint64_t>();
+            auto version = reader.get<uint64_t>();
+
+            if (!reader.get<uint8_t>())
+            {
+                break;
+            }
+
+            auto& scene = gpuSceneVersions[version];
+            scene.vertices = toVertices(reader.getVector<vec2>());
+            scene.indices = reader.getVector<uint32_t>();
+            scene.meshes = reader.getVector<GPUMesh>();
+            scene.objects = reader.getVector<GPUObject>();
+
+            // The cull shader reads these without checks too
+            for (auto& i : scene.meshes)
+            {
+                if (i.firstIndex > scene.indices.size() || i.indexCount > scene.indices.size() - i.firstIndex || i.vertexOffset < 0)
+                {
+                    throw std::runtime_error("Corrupt capture file");
+                }
+
+                for (uint32_t j = i.firstIndex; j < i.firstIndex + i.indexCount; j++)
+                {
+                    if (static_cast<size_t>(i.vertexOffset) + scene.indices[j] >= scene.vertices.size())
+                    {
+                        throw std::runtime_error("Corrupt capture file");
+                    }
+                }
+            }
+
+            for (auto& i : scene.objects)
+            {
+                if (i.mesh >= scene.meshes.size())
+                {
+                    throw std::runtime_error("Corrupt capture file");
+                }
+            }
+            break;
+        }
+        case CaptureRecord::BeginLayer:
+        case CaptureRecord::DrawLayer:
+        {
+            auto id = reader.get<uint32_t>();
+            auto size = reader.get<uvec2>();
+            auto position = reader.get<vec2>();
+
+            if (!layers.contains(id))
+            {
+                layers[id] = make_shared<RenderLayer>(renderer, size.x, size.y, position);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    });
+}
+
+shared_ptr<BaseModel> FrameReplay::getModel(uint32_t id)
+{
+    auto found = models.find(id);
+    if (found == models.end() || found->second.vertices.empty())
+    {
+        return nullptr;
+    }
+
+    auto& geometry = found->second;
+    if (geometry.model)
+    {
+        return geometry.model;
+    }
+
+    return renderer->getDynamicModel(geometry.vertices, geometry.indices);
+}
+
+void FrameReplay::drawFrame(size_t frame)
+{
+    if (!renderer)
+    {
+        throw std::runtime_error("Replay has to be prepared before drawing");
+    }
+
+    forEachRecord(data, frames[frame].start, frames[frame].end, [&](CaptureRecord type, CaptureReader& reader)
+    {
+        switch (type)
+        {
+        case CaptureRecord::Camera:
+            renderer->cameraPosition = reader.get<vec2>();
+            break;
+        case CaptureRecord::EndFrame:
+            renderer->clearColor = vk::ClearColorValue(reader.get<array<float, 4>>());
+            break;
+        case CaptureRecord::Shape:
+            renderer->drawShape(reader.get<ShapeInstance>());
+            break;
+        case CaptureRecord::Sprite:
+        {
+            auto sprite = reader.get<SpriteInstance>();
+            auto found = textures.find(sprite.texture);
+
+            if (found == textures.end())
+            {
+                skipped++;
+                break;
+            }
+
+            sprite.texture = found->second.second.texture;
+            renderer->drawSprite(sprite);
+            break;
+        }
+        case CaptureRecord::Stroke:
+        {
+            auto style = reader.get<StrokeStyle>();
+            auto color = reader.get<vec4>();
+            bool closed = reader.get<uint8_t>();
+            auto points = reader.getVector<vec2>();
+
+            renderer->drawPolyline(points, style, color, closed);
+            break;
+        }
+        case CaptureRecord::Path:
+        {
+            auto id = reader.get<uint64_t>();
+            auto version = reader.get<uint64_t>();
+            auto style = reader.get<StrokeStyle>();
+            auto color = reader.get<vec4>();
+
+            auto subpaths = pathVersions.find({ id, version });
+            if (subpaths == pathVersions.end())
+            {
+                skipped++;
+                break;
+            }
+
+            // Rebuilt only when the app changed it, so it's cached the same way
+            auto [found, added] = paths.try_emplace(id);
+            auto& [builtVersion, path] = found->second;
+
+            if (added || builtVersion != version)
+            {
+                path.clear();
+
+                for (auto& [closed, points] : subpaths->second)
+                {
+                    if (points.empty())
+                    {
+                        continue;
+                    }
+
+                    path.moveTo(points[0]);
+                    for (size_t i = 1; i < points.size(); i++)
+                    {
+                        path.lineTo(points[i]);
+                    }
+
+                    if (closed)
+                    {
+                        path.close();
+                    }
+                }
+
+                builtVersion = version;
+            }
+
+            renderer->drawPath(path, style, color);
+            break;
+        }
+        case CaptureRecord::StrokeMesh:
+        {
+            auto vertices = reader.getVector<ColorVertex>();
+            auto indices = reader.getVector<uint32_t>();
+            checkIndices(indices, vertices.size());
+
+            // Queued the way DrawContext strokes are merged
+            auto base = static_cast<uint32_t>(renderer->queuedStrokeVertices.size());
+            renderer->queuedStrokeVertices.insert(renderer->queuedStrokeVertices.end(), vertices.begin(), vertices.end());
+
+            for (auto i : indices)
+            {
+                renderer->queuedStrokeIndices.push_back(base + i);
+            }
+
+            if (!indices.empty())
+            {
+                renderer->queueRun(Renderer::QueuedKind::Strokes, renderer->queuedStrokeIndices.size());
+            }
+            break;
+        }
+        case CaptureRecord::Text:
+        {
+            auto id = reader.get<uint32_t>();
+            auto x = reader.get<int>();
+            auto y = reader.get<int>();
+            auto color = reader.get<vec4>();
+            auto scale = reader.get<float>();
+            auto text = reader.getString();
+
+            auto found = fonts.find(id);
+            if (found == fonts.end() || !found->second)
+            {
+                skipped++;
+                break;
+            }
+
+            renderer->drawText(found->second, text, x, y, color, scale);
+            break;
+        }
+        case CaptureRecord::Polygon:
+        {
+            auto x = reader.get<int>();
+            auto y = reader.get<int>();
+            auto width = reader.get<int>();
+            auto height = reader.get<int>();
+            auto rotation = reader.get<float>();
+            auto color = reader.get<vec4>();
+            bool hasHoles = reader.get<uint8_t>();
+            auto points = toVertices(reader.getVector<vec2>());
+
+            if (!hasHoles)
+            {
+                renderer->drawPolygon(points, x, y, width, height, rotation, color);
+                break;
+            }
+
+            vector<vector<BasicVertex>> holes(reader.get<uint32_t>());
+            for (auto& i : holes)
+            {
+                i = toVertices(reader.getVector<vec2>());
+            }
+
+            renderer->drawPolygon(points, holes, x, y, width, height, rotation, color);
+            break;
+        }
+        case CaptureRecord::ModelDraw:
+        {
+            auto model = getModel(reader.get<uint32_t>());
+            auto ubo = reader.getVector<uint8_t>();
+
+            if (!model)
+            {
+                skipped++;
+                break;
+            }
+
+            // App shaders aren't captured, so models are drawn flat. UBOs laid out like
+            // BasicUBO keep their transform.
+            auto basic = renderer->getNewUBO();
+            if (ubo.size() == sizeof(BasicUBO))
+            {
+                memcpy(&basic, ubo.data(), sizeof(BasicUBO));
+            }
+
+            renderer->drawModel(model, renderer->basicPipeline, basic);
+            break;
+        }
+        case CaptureRecord::Instances:
+        {
+            auto model = getModel(reader.get<uint32_t>());
+
+            TransformBatch batch;
+            batch.x = reader.getVector<float>();
+            batch.y = reader.getVector<float>();
+            batch.width = reader.getVector<float>();
+            batch.height = reader.getVector<float>();
+            batch.rotation = reader.getVector<float>();
+            batch.color = reader.getVector<vec4>();
+
+            auto count = batch.size();
+            if (batch.y.size() != count || batch.width.size() != count || batch.height.size() != count || batch.rotation.size() != count || batch.color.size() != count)
+            {
+                throw std::runtime_error("Corrupt capture file");
+            }
+
+            if (!model)
+            {
+                skipped++;
+                break;
+            }
+
+            renderer->drawInstances(model, batch);
+            break;
+        }
+        case CaptureRecord::SceneInstances:
+        {
+            auto model = getModel(reader.get<uint32_t>());
+            auto instances = reader.getVector<Instance2D>();
+
+            if (!model || instances.empty())
+            {
+                skipped++;
+                break;
+            }
+
+            // Drawn like the scene's default pipeline, scene pipelines aren't captured
+            renderer->flush();
+
+            auto& cmds = renderer->getCommandBuffer();
+            renderer->instancedPipeline->bind(cmds);
+
+            auto uniforms = renderer->instancedPipeline->getUniformSet();
+            uniforms->setUBO(renderer->getNewUBO());
+            uniforms->bind(cmds);
+
+            auto first = renderer->transformInstances->push(cmds, 1, instances.data(), instances.size());
+            model->drawInstanced(cmds, static_cast<uint32_t>(instances.size()), first);
+            break;
+        }
+        case CaptureRecord::GPUScene:
+        {
+            auto id = reader.get<uint64_t>();
+            auto version = reader.get<uint64_t>();
+
+            auto data = gpuSceneVersions.find(version);
+            if (data == gpuSceneVersions.end() || !GPUScene::isSupported(renderer))
+            {
+                skipped++;
+                break;
+            }
+
+            auto& [built, scene] = gpuScenes[id];
+            if (!scene)
+            {
+                scene = make_shared<GPUScene>(renderer);
+            }
+
+            if (built != version)
+            {
+                // Meshes are only ever added, so the geometry changed if there are more
+                bool geometryChanged = scene->meshes.size() != data->second.meshes.size();
+
+                scene->vertices = data->second.vertices;
+                scene->indices = data->second.indices;
+                scene->meshes = data->second.meshes;
+                scene->objects = data->second.objects;
+                scene->geometryDirty = geometryChanged;
+                scene->objectsDirty = true;
+                built = version;
+            }
+
+            scene->draw();
+            break;
+        }
+        case CaptureRecord::BeginLayer:
+            renderer->beginLayer(layers.at(reader.get<uint32_t>()));
+            break;
+        case CaptureRecord::EndLayer:
+            renderer->endLayer();
+            break;
+        case CaptureRecord::DrawLayer:
+        {
+            auto& layer = layers.at(reader.get<uint32_t>());
+            reader.get<uvec2>();
+            reader.get<vec2>();
+            auto color = reader.get<vec4>();
+
+            // Drawn before the capture started, so only its size is known
+            if (!layer->isValid())
+            {
+                renderer->beginLayer(layer);
+                renderer->endLayer();
+            }
+
+            renderer->drawLayer(layer, color);
+            break;
+        }
+        default:
+            break;
+        }
+    });
+}
@@ -0,0 +1,194 @@
+#include "GPUScene.hpp"
+
+#include "Renderer.hpp"
+#include "BaseModel.hpp"
+#include "FrameCapture.hpp"
+
+GPUScene::GPUScene(Renderer* renderer) : renderer(renderer), vertexBuffer({}), vertexMemory({}), indexBuffer({}), indexMemory({}), meshBuffer({}), meshMemory({}), objectBuffer({}), objectMemory({}), descriptorPool({})
+{
+    if (!isSupported(renderer))
+    {
+        throw std::runtime_error("GPU scenes need drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance support");
+    }
+
+    for (int i = 0; i < renderer->MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        commandBuffers.push_back({0});
+        commandMemories.push_back({0});
+        countBuffers.push_back({0});
+        countMemories.push_back({0});
+    }
+
+    auto poolSize = vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 4 * renderer->MAX_FRAMES_IN_FLIGHT);
+    auto poolInfo = vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, renderer->MAX_FRAMES_IN_FLIGHT, 1, &poolSize);
+    descriptorPool = renderer->device.createDescriptorPool(poolInfo);
+
+    vector<vk::DescriptorSetLayout> layouts(renderer->MAX_FRAMES_IN_FLIGHT, renderer->cullPipeline->descriptorLayout);
+    auto allocInfo = vk::DescriptorSetAllocateInfo(descriptorPool, renderer->MAX_FRAMES_IN_FLIGHT, layouts.data());
+    descriptorSets = vki::DescriptorSets(renderer->device, allocInfo);
+}
+
+bool GPUScene::isSupported(Renderer* renderer)
+{
+    return renderer->enabledFeatures12.drawIndirectCount && renderer->enabledFeatures.multiDrawIndirect && renderer->enabledFeatures.drawIndirectFirstInstance;
+}
+
+uint32_t GPUScene::addMesh(const vector<BasicVertex>& vertices, const vector<uint32_t>& indices)
+{
+    GPUMesh mesh = {};
+    mesh.indexCount = static_cast<uint32_t>(indices.size());
+    mesh.firstIndex = static_cast<uint32_t>(this->indices.size());
+    mesh.vertexOffset = static_cast<int32_t>(this->vertices.size());
+
+    mesh.bounds = computeBounds(vertices);
+
+    this->vertices.insert(this->vertices.end(), vertices.begin(), vertices.end());
+    this->indices.insert(this->indices.end(), indices.begin(), indices.end());
+    meshes.push_back(mesh);
+
+    geometryDirty = true;
+    return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+uint32_t GPUScene::addObject(uint32_t mesh, vec2 pos, vec2 size, float rotation, vec4 color)
+{
+    objects.push_back({ pos, size, rotation, mesh, color });
+    objectsDirty = true;
+    return static_cast<uint32_t>(objects.size() - 1);
+}
+
+void GPUScene::setObject(uint32_t id, vec2 pos, vec2 size, float rotation, vec4 color)
+{
+    objects[id] = { pos, size, rotation, objects[id].mesh, color };
+    objectsDirty = true;
+}
+
+size_t GPUScene::getObjectCount()
+{
+    return objects.size();
+}
+
+void GPUScene::upload()
+{
+    // Old buffers may still be in use by frames in flight
+    renderer->device.waitIdle();
+
+    if (geometryDirty)
+    {
+        renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexMemory, vertices);
+        renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexMemory, indices);
+        renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, meshBuffer, meshMemory, meshes);
+    }
+
+    if (objectsDirty)
+    {
+        renderer->createBufferWithStaging(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, objectBuffer, objectMemory, objects);
+
+        if (objects.size() > commandCapacity)
+        {
+            commandCapacity = objects.size();
+
+            for (int i = 0; i < renderer->MAX_FRAMES_IN_FLIGHT; i++)
+            {
+                renderer->createBuffer(commandCapacity * sizeof(vk::DrawIndexedIndirectCommand), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, commandBuffers[i], commandMemories[i], MemoryCategory::Other);
+                renderer->createBuffer(sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal, countBuffers[i], countMemories[i], MemoryCategory::Other);
+            }
+        }
+    }
+
+    geometryDirty = false;
+    objectsDirty = false;
+
+    updateDescriptors();
+}
+
+void GPUScene::updateDescriptors()
+{
+    for (int i = 0; i < renderer->MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        array<vk::DescriptorBufferInfo, 4> infos = {
+            vk::DescriptorBufferInfo(objectBuffer, 0, VK_WHOLE_SIZE),
+            vk::DescriptorBufferInfo(meshBuffer, 0, VK_WHOLE_SIZE),
+            vk::DescriptorBufferInfo(commandBuffers[i], 0, VK_WHOLE_SIZE),
+            vk::DescriptorBufferInfo(countBuffers[i], 0, VK_WHOLE_SIZE)
+        };
+
+        vector<vk::WriteDescriptorSet> writes;
+        for (uint32_t j = 0; j < infos.size(); j++)
+        {
+            writes.push_back(vk::WriteDescriptorSet(descriptorSets[i], j, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &infos[j]));
+        }
+
+        renderer->device.updateDescriptorSets(writes, {});
+    }
+}
+
+void GPUScene::draw()
+{
+    if (objects.empty() || meshes.empty())
+    {
+        return;
+    }
+
+    if (geometryDirty || objectsDirty)
+    {
+        version = nextGPUSceneVersion++;
+        upload();
+    }
+
+    if (renderer->capture && renderer->capture->isRecording())
+    {
+        renderer->capture->gpuScene(*this);
+    }
+
+    auto frame = renderer->currentFlightFrame;
+
+    auto ubo = renderer->getNewUBO();
+
+    CullParams params = {};
+    params.view = renderer->getViewBounds();
+    params.objectCount = static_cast<uint32_t>(objects.size());
+
+    // Cull. The graph puts the barriers in, and hands both buffers to the indirect draw.
+    auto graph = renderer->graph.get();
+    auto counts = graph->importBuffer("gpu scene counts", countBuffers[frame], ResourceUsage::None, ResourceUsage::IndirectRead);
+    auto draws = graph->importBuffer("gpu scene commands", commandBuffers[frame], ResourceUsage::None, ResourceUsage::IndirectRead);
+    auto descriptorSet = *descriptorSets[frame];
+    auto cullPipeline = renderer->cullPipeline;
+
+    graph->addPass("gpu scene clear", [&](RenderGraph::PassBuilder& pass)
+    {
+        pass.write(counts, ResourceUsage::TransferWrite);
+    }, [=](vki::CommandBuffer& cmds)
+    {
+        cmds.fillBuffer(graph->getBuffer(counts), 0, sizeof(uint32_t), 0);
+    });
+
+    graph->addPass("gpu scene cull", [&](RenderGraph::PassBuilder& pass)
+    {
+        pass.write(counts, ResourceUsage::ComputeWrite);
+        pass.write(draws, ResourceUsage::ComputeWrite);
+    }, [=](vki::CommandBuffer& cmds)
+    {
+        cullPipeline->bind(cmds);
+        cmds.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipeline->layout, 0, { descriptorSet }, {});
+        cmds.pushConstants<CullParams>(cullPipeline->layout, vk::ShaderStageFlagBits::eCompute, 0, params);
+        cmds.dispatch((params.objectCount + 63) / 64, 1, 1);
+    });
+
+    // Draw
+    renderer->flush();
+
+    auto& cmds = renderer->getCommandBuffer();
+    renderer->gpuScenePipeline->bind(cmds);
+
+    auto uniforms = renderer->gpuScenePipeline->getUniformSet(ubo);
+    uniforms->bind(cmds);
+
+    cmds.bindVertexBuffers(0, { vertexBuffer, objectBuffer }, { 0, 0 });
+    cmds.bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint32);
+    cmds.drawIndexedIndirectCount(commandBuffers[frame], 0, countBuffers[frame], 0, params.objectCount, sizeof(vk::DrawIndexedIndirectCommand));
+
+    // The GPU decides how many objects survive culling
+    renderer->countDraw(0);
+}
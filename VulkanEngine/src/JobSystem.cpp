@@ -0,0 +1,220 @@
+#include "JobSystem.hpp"
+
+// Which system and queue the current thread works for
+static thread_local JobSystem* currentSystem = nullptr;
+static thread_local size_t currentWorker = 0;
+
+JobSystem::JobSystem(size_t threadCount) : statsStart(chrono::steady_clock::now())
+{
+    for (size_t i = 0; i <= threadCount; i++)
+    {
+        workers.push_back(make_unique<Worker>());
+    }
+
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    running = false;
+
+    {
+        lock_guard guard(sleepLock);
+    }
+    wake.notify_all();
+
+    for (auto& i : threads)
+    {
+        i.join();
+    }
+}
+
+shared_ptr<Job> JobSystem::schedule(function<void()> func, const vector<shared_ptr<Job>>& dependencies)
+{
+    auto job = make_shared<Job>();
+    job->func = std::move(func);
+
+    for (auto& i : dependencies)
+    {
+        lock_guard guard(i->lock);
+
+        if (!i->finished)
+        {
+            job->pending++;
+            i->dependents.push_back(job);
+        }
+    }
+
+    // Drop the scheduling reference. If every dependency already finished, it's ready.
+    if (--job->pending == 0)
+    {
+        push(job);
+    }
+
+    return job;
+}
+
+void JobSystem::wait(const shared_ptr<Job>& job)
+{
+    auto index = getWorkerIndex();
+
+    while (!job->isFinished())
+    {
+        if (auto next = take(index))
+        {
+            run(*next, index);
+        }
+        else
+        {
+            this_thread::yield();
+        }
+    }
+
+    if (job->error)
+    {
+        rethrow_exception(job->error);
+    }
+}
+
+vector<WorkerStats> JobSystem::getStats()
+{
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - statsStart).count();
+
+    vector<WorkerStats> stats;
+    for (auto& i : workers)
+    {
+        stats.push_back({ i->jobsRun, i->steals, elapsed > 0 ? i->busyNanoseconds / elapsed : 0 });
+    }
+
+    return stats;
+}
+
+void JobSystem::resetStats()
+{
+    for (auto& i : workers)
+    {
+        i->jobsRun = 0;
+        i->steals = 0;
+        i->busyNanoseconds = 0;
+    }
+
+    statsStart = chrono::steady_clock::now();
+}
+
+size_t JobSystem::getWorkerIndex()
+{
+    return currentSystem == this ? currentWorker : threads.size();
+}
+
+void JobSystem::push(shared_ptr<Job> job)
+{
+    auto& worker = *workers[getWorkerIndex()];
+
+    // Counted first so take never sees the job before it's counted
+    queued++;
+
+    {
+        lock_guard guard(worker.lock);
+        worker.jobs.push_back(std::move(job));
+    }
+
+    // Taking the lock means a worker can't check queued and then miss this notify
+    {
+        lock_guard guard(sleepLock);
+    }
+    wake.notify_one();
+}
+
+shared_ptr<Job> JobSystem::take(size_t index)
+{
+    auto& own = *workers[index];
+
+    // Own jobs newest first, since their data is the most likely to still be in cache
+    {
+        lock_guard guard(own.lock);
+
+        if (!own.jobs.empty())
+        {
+            auto job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            queued--;
+            return job;
+        }
+    }
+
+    for (size_t i = 1; i < workers.size(); i++)
+    {
+        auto& victim = *workers[(index + i) % workers.size()];
+        lock_guard guard(victim.lock);
+
+        if (!victim.jobs.empty())
+        {
+            auto job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            queued--;
+            own.steals++;
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::run(Job& job, size_t index)
+{
+    auto start = chrono::steady_clock::now();
+
+    try
+    {
+        job.func();
+    }
+    catch (...)
+    {
+        job.error = current_exception();
+    }
+
+    // Let go of anything the job captured
+    job.func = nullptr;
+
+    auto& worker = *workers[index];
+    worker.busyNanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    worker.jobsRun++;
+
+    vector<shared_ptr<Job>> ready;
+
+    {
+        lock_guard guard(job.lock);
+        job.finished.store(true, memory_order_release);
+        ready.swap(job.dependents);
+    }
+
+    // Dependents still run if this one threw
+    for (auto& i : ready)
+    {
+        if (--i->pending == 0)
+        {
+            push(i);
+        }
+    }
+}
+
+void JobSystem::workerLoop(size_t index)
+{
+    currentSystem = this;
+    currentWorker = index;
+
+    while (running)
+    {
+        if (auto job = take(index))
+        {
+            run(*job, index);
+            continue;
+        }
+
+        unique_lock guard(sleepLock);
+        wake.wait(guard, [this]() { return !running || queued > 0; });
+    }
+}
@@ -0,0 +1,138 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const string& path)
+{
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    if (size == 0)
+    {
+        close();
+        throw std::runtime_error("File is empty: " + path);
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping != nullptr)
+    {
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    struct stat info;
+    fstat(fd, &info);
+    size = static_cast<size_t>(info.st_size);
+
+    if (size == 0)
+    {
+        close();
+        throw std::runtime_error("File is empty: " + path);
+    }
+
+    auto ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED)
+    {
+        data = static_cast<const uint8_t*>(ptr);
+
+        // Loaders read the whole file straight away
+        madvise(ptr, size, MADV_WILLNEED);
+    }
+#endif
+
+    if (data == nullptr)
+    {
+        close();
+        throw std::runtime_error("Could not map file: " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+
+        data = exchange(other.data, nullptr);
+        size = exchange(other.size, 0);
+#ifdef _WIN32
+        file = exchange(other.file, nullptr);
+        mapping = exchange(other.mapping, nullptr);
+#else
+        fd = exchange(other.fd, -1);
+#endif
+    }
+
+    return *this;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (data != nullptr)
+    {
+        UnmapViewOfFile(data);
+    }
+
+    if (mapping != nullptr)
+    {
+        CloseHandle(mapping);
+    }
+
+    if (file != nullptr)
+    {
+        CloseHandle(file);
+    }
+
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (data != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+
+    fd = -1;
+#endif
+
+    data = nullptr;
+    size = 0;
+}
@@ -0,0 +1,208 @@
+#include "MemoryTracker.hpp"
+
+#include "Renderer.hpp"
+
+TrackedMemory::TrackedMemory(std::nullptr_t) : vki::DeviceMemory(nullptr)
+{
+
+}
+
+TrackedMemory::TrackedMemory(vki::DeviceMemory&& memory, MemoryTracker* tracker, MemoryCategory category, uint32_t heap, vk::DeviceSize size) : vki::DeviceMemory(std::move(memory)), tracker(tracker), category(category), heap(heap), size(size)
+{
+
+}
+
+TrackedMemory::TrackedMemory(TrackedMemory&& other) noexcept : vki::DeviceMemory(std::move(other)), tracker(exchange(other.tracker, nullptr)), category(other.category), heap(other.heap), size(exchange(other.size, 0))
+{
+
+}
+
+TrackedMemory::~TrackedMemory()
+{
+    release();
+}
+
+TrackedMemory& TrackedMemory::operator=(TrackedMemory&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        vki::DeviceMemory::operator=(std::move(other));
+
+        tracker = exchange(other.tracker, nullptr);
+        category = other.category;
+        heap = other.heap;
+        size = exchange(other.size, 0);
+    }
+
+    return *this;
+}
+
+void TrackedMemory::release()
+{
+    if (tracker)
+    {
+        tracker->untrack(category, heap, size);
+    }
+
+    tracker = nullptr;
+    size = 0;
+}
+
+MemoryTracker::MemoryTracker(Renderer* renderer) : renderer(renderer)
+{
+    properties = renderer->physicalDevice.getMemoryProperties();
+
+    heaps.resize(properties.memoryHeapCount);
+    for (uint32_t i = 0; i < properties.memoryHeapCount; i++)
+    {
+        heaps[i].budget = properties.memoryHeaps[i].size;
+        heaps[i].deviceLocal = static_cast<bool>(properties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+    }
+}
+
+TrackedMemory MemoryTracker::allocate(vk::MemoryRequirements requirements, vk::MemoryPropertyFlags properties, MemoryCategory category)
+{
+    auto type = renderer->findMemoryType(requirements.memoryTypeBits, properties);
+    auto heap = this->properties.memoryTypes[type].heapIndex;
+
+    auto memory = renderer->device.allocateMemory(vk::MemoryAllocateInfo(requirements.size, type));
+
+    lock_guard guard(lock);
+    categories[static_cast<size_t>(category)] += requirements.size;
+    heaps[heap].tracked += requirements.size;
+    allocations++;
+    liveAllocations++;
+
+    return TrackedMemory(std::move(memory), this, category, heap, requirements.size);
+}
+
+void MemoryTracker::untrack(MemoryCategory category, uint32_t heap, vk::DeviceSize size)
+{
+    lock_guard guard(lock);
+    categories[static_cast<size_t>(category)] -= size;
+    heaps[heap].tracked -= size;
+    liveAllocations--;
+}
+
+uint64_t MemoryTracker::getAllocationCount()
+{
+    lock_guard guard(lock);
+    return allocations;
+}
+
+uint64_t MemoryTracker::getLiveAllocations()
+{
+    lock_guard guard(lock);
+    return liveAllocations;
+}
+
+size_t MemoryTracker::addEvictionCallback(function<vk::DeviceSize()> callback)
+{
+    lock_guard guard(lock);
+    evictionCallbacks.push_back({ nextCallback, std::move(callback) });
+    return nextCallback++;
+}
+
+void MemoryTracker::removeEvictionCallback(size_t id)
+{
+    lock_guard guard(lock);
+    erase_if(evictionCallbacks, [id](const auto& i) { return i.first == id; });
+}
+
+void MemoryTracker::update()
+{
+    vk::DeviceSize over = 0;
+    vector<pair<size_t, function<vk::DeviceSize()>>> callbacks;
+
+    {
+        lock_guard guard(lock);
+
+        if (renderer->memoryBudgetSupported)
+        {
+            auto props = renderer->physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+            auto& budget = props.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+
+            for (size_t i = 0; i < heaps.size(); i++)
+            {
+                heaps[i].budget = budget.heapBudget[i];
+                heaps[i].usage = budget.heapUsage[i];
+            }
+        }
+        else
+        {
+            for (auto& i : heaps)
+            {
+                i.usage = i.tracked;
+            }
+        }
+
+        for (auto& i : heaps)
+        {
+            auto limit = static_cast<vk::DeviceSize>(i.budget * pressureThreshold);
+            if (i.usage > limit)
+            {
+                over = std::max(over, i.usage - limit);
+            }
+        }
+
+        if (over > 0)
+        {
+            callbacks = evictionCallbacks;
+        }
+    }
+
+    if (over == 0)
+    {
+        return;
+    }
+
+    // Callbacks free memory, which takes the lock, so they run without it
+    evictions++;
+
+    vk::DeviceSize freed = 0;
+    for (auto& [id, callback] : callbacks)
+    {
+        freed += callback();
+
+        if (freed >= over)
+        {
+            break;
+        }
+    }
+}
+
+vector<MemoryHeapUsage> MemoryTracker::getHeaps()
+{
+    lock_guard guard(lock);
+    return heaps;
+}
+
+vk::DeviceSize MemoryTracker::getUsage(MemoryCategory category)
+{
+    lock_guard guard(lock);
+    return categories[static_cast<size_t>(category)];
+}
+
+const char* MemoryTracker::getCategoryName(MemoryCategory category)
+{
+    switch (category)
+    {
+        case MemoryCategory::Uniforms:
+            return "Uniforms";
+        case MemoryCategory::DynamicGeometry:
+            return "Dynamic geometry";
+        case MemoryCategory::StaticGeometry:
+            return "Static geometry";
+        case MemoryCategory::Textures:
+            return "Textures";
+        case MemoryCategory::Attachments:
+            return "Attachments";
+        case MemoryCategory::Staging:
+            return "Staging";
+        case MemoryCategory::Caches:
+            return "Caches";
+        default:
+            return "Other";
+    }
+}
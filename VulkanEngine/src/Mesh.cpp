@@ -0,0 +1,225 @@
+#include "Mesh.hpp"
+
+#include <sstream>
+#include <iomanip>
+
+// Forsyth uses a bigger cache than the hardware's so that scores look a little ahead
+constexpr int SCORE_CACHE_SIZE = 32;
+
+string describe(const MeshReport& report)
+{
+    auto& a = report.before;
+    auto& b = report.after;
+
+    stringstream out;
+    out << fixed << setprecision(3);
+    out << a.vertexCount << " -> " << b.vertexCount << " vertices, ";
+    out << a.vertexBytes + a.indexBytes << " -> " << b.vertexBytes + b.indexBytes << " bytes (" << a.indexBytes << " -> " << b.indexBytes << " of indices), ";
+    out << "ACMR " << a.acmr << " -> " << b.acmr;
+    return out.str();
+}
+
+void packIndices(const vector<uint32_t>& indices, size_t vertexCount, void* dest)
+{
+    if (!useShortIndices(vertexCount))
+    {
+        memcpy(dest, indices.data(), indices.size() * sizeof(uint32_t));
+        return;
+    }
+
+    auto out = static_cast<uint16_t*>(dest);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        out[i] = static_cast<uint16_t>(indices[i]);
+    }
+}
+
+float computeACMR(const vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    if (indices.size() < 3)
+    {
+        return 0;
+    }
+
+    // Time each vertex entered the cache. It's still cached if fewer than cacheSize misses
+    // happened since.
+    vector<uint32_t> entered(vertexCount, 0);
+    uint32_t misses = 0;
+
+    for (auto i : indices)
+    {
+        if (entered[i] == 0 || misses - entered[i] >= cacheSize)
+        {
+            misses++;
+            entered[i] = misses;
+        }
+    }
+
+    return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+static float vertexScore(int cachePosition, uint32_t remaining)
+{
+    if (remaining == 0)
+    {
+        return -1;
+    }
+
+    float score = 0;
+
+    if (cachePosition >= 0)
+    {
+        // The last triangle's vertices score the same so there's no preference between them
+        score = cachePosition < 3 ? 0.75f : pow(1 - static_cast<float>(cachePosition - 3) / (SCORE_CACHE_SIZE - 3), 1.5f);
+    }
+
+    // Finish off vertices with few triangles left so they don't get stranded
+    return score + 2 / sqrt(static_cast<float>(remaining));
+}
+
+void optimizeVertexCache(vector<uint32_t>& indices, size_t vertexCount)
+{
+    auto triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles using each vertex
+    vector<uint32_t> remaining(vertexCount, 0);
+    for (auto i : indices)
+    {
+        remaining[i]++;
+    }
+
+    vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        offsets[i + 1] = offsets[i] + remaining[i];
+    }
+
+    vector<uint32_t> adjacency(indices.size());
+    vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t i = 0; i < indices.size(); i++)
+    {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> score(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        score[i] = vertexScore(-1, remaining[i]);
+    }
+
+    vector<float> triangleScore(triangleCount);
+    vector<bool> emitted(triangleCount, false);
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        triangleScore[i] = score[indices[i * 3]] + score[indices[i * 3 + 1]] + score[indices[i * 3 + 2]];
+    }
+
+    vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    vector<uint32_t> cache;
+    vector<uint32_t> newCache;
+    cache.reserve(SCORE_CACHE_SIZE + 3);
+    newCache.reserve(SCORE_CACHE_SIZE + 3);
+
+    auto best = numeric_limits<uint32_t>::max();
+    size_t cursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        // Nothing in the cache has triangles left, so start somewhere new
+        if (best == numeric_limits<uint32_t>::max())
+        {
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+
+            best = static_cast<uint32_t>(cursor);
+        }
+
+        emitted[best] = true;
+        newCache.clear();
+
+        for (int i = 0; i < 3; i++)
+        {
+            auto v = indices[best * 3 + i];
+            output.push_back(v);
+            newCache.push_back(v);
+
+            // Take the triangle out of the vertex's list
+            auto begin = adjacency.begin() + offsets[v];
+            auto end = begin + remaining[v];
+            *find(begin, end, best) = *(end - 1);
+            remaining[v]--;
+        }
+
+        for (auto v : cache)
+        {
+            if (v != newCache[0] && v != newCache[1] && v != newCache[2])
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        // Vertices that fell out of the cache
+        for (size_t i = SCORE_CACHE_SIZE; i < newCache.size(); i++)
+        {
+            cachePosition[newCache[i]] = -1;
+            score[newCache[i]] = vertexScore(-1, remaining[newCache[i]]);
+        }
+
+        newCache.resize(std::min<size_t>(newCache.size(), SCORE_CACHE_SIZE));
+        swap(cache, newCache);
+
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            cachePosition[cache[i]] = static_cast<int>(i);
+            score[cache[i]] = vertexScore(static_cast<int>(i), remaining[cache[i]]);
+        }
+
+        // Only triangles touching the cache changed score
+        best = numeric_limits<uint32_t>::max();
+        float bestScore = -1;
+
+        for (auto v : cache)
+        {
+            for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; i++)
+            {
+                auto t = adjacency[i];
+                triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices = std::move(output);
+}
+
+vector<uint32_t> optimizeVertexFetch(vector<uint32_t>& indices, size_t vertexCount)
+{
+    vector<uint32_t> remap(vertexCount, numeric_limits<uint32_t>::max());
+    uint32_t next = 0;
+
+    for (auto& i : indices)
+    {
+        if (remap[i] == numeric_limits<uint32_t>::max())
+        {
+            remap[i] = next++;
+        }
+
+        i = remap[i];
+    }
+
+    return remap;
+}
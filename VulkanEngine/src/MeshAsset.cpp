@@ -0,0 +1,309 @@
+#include "MeshAsset.hpp"
+
+#include "Renderer.hpp"
+#include "StagingBuffer.hpp"
+#include "Triangulate.hpp"
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+MeshData buildPolygonMesh(const string& name, const vector<vec2>& outline, const vector<vector<vec2>>& holes, const vector<pair<uint32_t, uint32_t>>& edges)
+{
+    MeshData mesh = { name };
+    vector<vec2> added;
+
+    if (holes.empty() && edges.empty())
+    {
+        triangulatePolygon(outline.data(), outline.size(), mesh.indices, added);
+    }
+    else
+    {
+        triangulatePolygon(outline, holes, edges, mesh.indices, added);
+    }
+
+    for (auto i : outline)
+    {
+        mesh.vertices.push_back(BasicVertex(i.x, i.y));
+    }
+
+    for (const auto& i : holes)
+    {
+        for (auto j : i)
+        {
+            mesh.vertices.push_back(BasicVertex(j.x, j.y));
+        }
+    }
+
+    for (auto i : added)
+    {
+        mesh.vertices.push_back(BasicVertex(i.x, i.y));
+    }
+
+    return mesh;
+}
+
+void writeMeshFile(const string& path, const vector<MeshData>& meshes)
+{
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    size_t largestMesh = 0;
+
+    for (const auto& i : meshes)
+    {
+        vertexCount += i.vertices.size();
+        indexCount += i.indices.size();
+        largestMesh = std::max(largestMesh, i.vertices.size());
+    }
+
+    auto indexSize = getIndexSize(largestMesh);
+
+    MeshFileHeader header = {};
+    memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+    header.version = MESH_FILE_VERSION;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.vertexStride = sizeof(BasicVertex);
+    header.indexSize = static_cast<uint32_t>(indexSize);
+    header.vertexOffset = alignUp(sizeof(MeshFileHeader) + meshes.size() * sizeof(MeshFileEntry), 16);
+    header.vertexBytes = vertexCount * sizeof(BasicVertex);
+    header.indexOffset = alignUp(header.vertexOffset + header.vertexBytes, 16);
+    header.indexBytes = indexCount * indexSize;
+
+    vector<uint8_t> data(header.indexOffset + header.indexBytes, 0);
+    memcpy(data.data(), &header, sizeof(header));
+
+    auto entries = reinterpret_cast<MeshFileEntry*>(data.data() + sizeof(MeshFileHeader));
+    auto vertices = data.data() + header.vertexOffset;
+    auto indices = data.data() + header.indexOffset;
+
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const auto& mesh = meshes[i];
+
+        if (mesh.name.size() >= sizeof(MeshFileEntry::name))
+        {
+            throw std::runtime_error("Mesh name is too long: " + mesh.name);
+        }
+
+        MeshFileEntry entry = {};
+        memcpy(entry.name, mesh.name.data(), mesh.name.size());
+        entry.firstIndex = firstIndex;
+        entry.vertexOffset = vertexOffset;
+        entry.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        entry.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+
+        auto b = mesh.vertices.empty() ? vec4(0) : computeBounds(mesh.vertices);
+        memcpy(entry.bounds, &b, sizeof(entry.bounds));
+        memcpy(entries + i, &entry, sizeof(entry));
+
+        memcpy(vertices + vertexOffset * sizeof(BasicVertex), mesh.vertices.data(), mesh.vertices.size() * sizeof(BasicVertex));
+        packIndices(mesh.indices, largestMesh, indices + firstIndex * indexSize);
+
+        firstIndex += entry.indexCount;
+        vertexOffset += static_cast<int32_t>(entry.vertexCount);
+    }
+
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not write file: " + path);
+    }
+
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+template <typename T>
+static bool indicesInRange(const uint8_t* data, uint32_t count, uint32_t vertexCount)
+{
+    auto indices = reinterpret_cast<const T*>(data);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (indices[i] >= vertexCount)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+MeshFile::MeshFile(const string& path) : file(path)
+{
+    auto size = file.getSize();
+
+    if (size < sizeof(MeshFileHeader))
+    {
+        throw std::runtime_error("Not a mesh file: " + path);
+    }
+
+    header = reinterpret_cast<const MeshFileHeader*>(file.getData());
+
+    if (memcmp(header->magic, MESH_FILE_MAGIC, sizeof(header->magic)) != 0)
+    {
+        throw std::runtime_error("Not a mesh file: " + path);
+    }
+
+    if (header->version != MESH_FILE_VERSION)
+    {
+        throw std::runtime_error("Unsupported mesh file version " + to_string(header->version) + ": " + path);
+    }
+
+    bool valid = (header->indexSize == 2 || header->indexSize == 4) && header->vertexStride > 0
+        && sizeof(MeshFileHeader) + static_cast<uint64_t>(header->meshCount) * sizeof(MeshFileEntry) <= size
+        && header->vertexOffset <= size && header->vertexBytes <= size - header->vertexOffset
+        && header->indexOffset <= size && header->indexBytes <= size - header->indexOffset;
+
+    entries = reinterpret_cast<const MeshFileEntry*>(file.getData() + sizeof(MeshFileHeader));
+
+    // Every mesh has to stay inside the data, otherwise a bad file could draw out of bounds
+    auto vertexCount = header->vertexBytes / std::max(header->vertexStride, 1u);
+    auto indexCount = header->indexBytes / header->indexSize;
+
+    for (uint32_t i = 0; valid && i < header->meshCount; i++)
+    {
+        auto& entry = entries[i];
+        valid = entry.vertexOffset >= 0 && static_cast<uint64_t>(entry.vertexOffset) + entry.vertexCount <= vertexCount && static_cast<uint64_t>(entry.firstIndex) + entry.indexCount <= indexCount;
+
+        // And so do the indices, which are relative to the mesh's first vertex
+        if (valid)
+        {
+            auto indices = file.getData() + header->indexOffset + static_cast<uint64_t>(entry.firstIndex) * header->indexSize;
+            valid = header->indexSize == 2 ? indicesInRange<uint16_t>(indices, entry.indexCount, entry.vertexCount) : indicesInRange<uint32_t>(indices, entry.indexCount, entry.vertexCount);
+        }
+    }
+
+    if (!valid)
+    {
+        throw std::runtime_error("Corrupt mesh file: " + path);
+    }
+}
+
+void MeshFile::close()
+{
+    file.close();
+    header = nullptr;
+    entries = nullptr;
+}
+
+MeshAsset::MeshAsset(Renderer* renderer, const string& path) : file(path), vertexBuffer({}), vertexMemory({}), indexBuffer({}), indexMemory({}), renderer(renderer)
+{
+    auto& header = file.getHeader();
+
+    if (header.vertexStride != sizeof(BasicVertex))
+    {
+        throw std::runtime_error("Mesh file has the wrong vertex size: " + path);
+    }
+
+    indexType = header.indexSize == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+
+    for (uint32_t i = 0; i < file.getMeshCount(); i++)
+    {
+        auto& entry = file.getMesh(i);
+
+        names.push_back(string(entry.name, strnlen(entry.name, sizeof(entry.name))));
+        meshes.push_back({ entry.firstIndex, entry.vertexOffset, entry.indexCount });
+        bounds.push_back(vec4(entry.bounds[0], entry.bounds[1], entry.bounds[2], entry.bounds[3]));
+    }
+}
+
+void MeshAsset::upload()
+{
+    if (!file.isOpen())
+    {
+        return;
+    }
+
+    auto& header = file.getHeader();
+
+    // Zero sized buffers aren't allowed
+    auto vertexBytes = std::max<vk::DeviceSize>(header.vertexBytes, 4);
+    auto indexBytes = std::max<vk::DeviceSize>(header.indexBytes, 4);
+
+    renderer->createBuffer(vertexBytes, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexMemory, MemoryCategory::StaticGeometry);
+    renderer->createBuffer(indexBytes, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, indexBuffer, indexMemory, MemoryCategory::StaticGeometry);
+
+    auto& cmds = renderer->getPrePassCommandBuffer();
+
+    vk::Buffer staging;
+    vk::DeviceSize offset;
+
+    if (header.vertexBytes > 0)
+    {
+        memcpy(renderer->staging->allocate(header.vertexBytes, 16, staging, offset), file.getVertexData(), header.vertexBytes);
+        cmds.copyBuffer(staging, *vertexBuffer, vk::BufferCopy(offset, 0, header.vertexBytes));
+    }
+
+    if (header.indexBytes > 0)
+    {
+        memcpy(renderer->staging->allocate(header.indexBytes, 16, staging, offset), file.getIndexData(), header.indexBytes);
+        cmds.copyBuffer(staging, *indexBuffer, vk::BufferCopy(offset, 0, header.indexBytes));
+    }
+
+    cmds.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput, {}, vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead), nullptr, nullptr);
+
+    // Everything needed is in the staging buffer now
+    file.close();
+}
+
+void MeshAsset::bind(vki::CommandBuffer& cmds)
+{
+    upload();
+
+    cmds.bindVertexBuffers(0, { *vertexBuffer }, { 0 });
+    cmds.bindIndexBuffer(*indexBuffer, 0, indexType);
+}
+
+void MeshAsset::draw(vki::CommandBuffer& cmds, uint32_t mesh, uint32_t instanceCount, uint32_t firstInstance)
+{
+    auto& i = meshes[mesh];
+    cmds.drawIndexed(i.indexCount, instanceCount, i.firstIndex, i.vertexOffset, firstInstance);
+    renderer->countDraw(instanceCount);
+}
+
+optional<uint32_t> MeshAsset::find(const string& name)
+{
+    for (uint32_t i = 0; i < names.size(); i++)
+    {
+        if (names[i] == name)
+        {
+            return i;
+        }
+    }
+
+    return nullopt;
+}
+
+shared_ptr<BaseModel> MeshAsset::getModel(uint32_t mesh)
+{
+    auto model = make_shared<AssetMesh>(this, mesh);
+    model->bounds = bounds[mesh];
+    model->hasBounds = meshes[mesh].indexCount > 0;
+    return model;
+}
+
+AssetMesh::AssetMesh(MeshAsset* asset, uint32_t mesh) : asset(asset), mesh(mesh)
+{
+    this->renderer = asset->renderer;
+}
+
+void AssetMesh::bind(vki::CommandBuffer& cmds)
+{
+    asset->bind(cmds);
+}
+
+void AssetMesh::draw(vki::CommandBuffer& cmds)
+{
+    bind(cmds);
+    asset->draw(cmds, mesh);
+}
+
+void AssetMesh::drawInstanced(vki::CommandBuffer& cmds, uint32_t instanceCount, uint32_t firstInstance)
+{
+    bind(cmds);
+    asset->draw(cmds, mesh, instanceCount, firstInstance);
+}
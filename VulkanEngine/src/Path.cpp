@@ -0,0 +1,286 @@
+#include "Path.hpp"
+
+#include <atomic>
+
+// Points closer than this are merged so segments always have a direction
+constexpr float MIN_SEGMENT = 1e-4f;
+
+// Most segments a single curve gets split into
+constexpr int MAX_CURVE_SEGMENTS = 256;
+
+static atomic<uint64_t> nextPathId = 1;
+
+Path::Path() : id(nextPathId++)
+{
+}
+
+Path::Path(const Path& other) : verbs(other.verbs), points(other.points), id(nextPathId++), version(other.version)
+{
+}
+
+Path::Path(Path&& other) noexcept : verbs(std::move(other.verbs)), points(std::move(other.points)), id(other.id), version(other.version)
+{
+    other.id = nextPathId++;
+}
+
+Path& Path::operator=(const Path& other)
+{
+    if (this != &other)
+    {
+        verbs = other.verbs;
+        points = other.points;
+        id = nextPathId++;
+        version = other.version;
+    }
+
+    return *this;
+}
+
+Path& Path::operator=(Path&& other) noexcept
+{
+    if (this != &other)
+    {
+        verbs = std::move(other.verbs);
+        points = std::move(other.points);
+        id = other.id;
+        version = other.version;
+        other.id = nextPathId++;
+    }
+
+    return *this;
+}
+
+void Path::moveTo(vec2 p)
+{
+    verbs.push_back(Verb::Move);
+    points.push_back(p);
+    version++;
+}
+
+void Path::lineTo(vec2 p)
+{
+    if (verbs.empty())
+    {
+        moveTo(p);
+        return;
+    }
+
+    verbs.push_back(Verb::Line);
+    points.push_back(p);
+    version++;
+}
+
+void Path::quadTo(vec2 control, vec2 p)
+{
+    if (verbs.empty())
+    {
+        moveTo(control);
+    }
+
+    verbs.push_back(Verb::Quad);
+    points.push_back(control);
+    points.push_back(p);
+    version++;
+}
+
+void Path::cubicTo(vec2 control1, vec2 control2, vec2 p)
+{
+    if (verbs.empty())
+    {
+        moveTo(control1);
+    }
+
+    verbs.push_back(Verb::Cubic);
+    points.push_back(control1);
+    points.push_back(control2);
+    points.push_back(p);
+    version++;
+}
+
+void Path::close()
+{
+    if (!verbs.empty())
+    {
+        verbs.push_back(Verb::Close);
+        version++;
+    }
+}
+
+void Path::clear()
+{
+    verbs.clear();
+    points.clear();
+    version++;
+}
+
+// Chord error of n even steps is at most |B''| / (8 n^2)
+int quadSegments(vec2 p0, vec2 p1, vec2 p2, float tolerance)
+{
+    auto dd = length(p0 - 2.0f * p1 + p2);
+    return std::clamp(static_cast<int>(ceil(sqrt(dd / (4 * tolerance)))), 1, MAX_CURVE_SEGMENTS);
+}
+
+int cubicSegments(vec2 p0, vec2 p1, vec2 p2, vec2 p3, float tolerance)
+{
+    auto dd = std::max(length(p0 - 2.0f * p1 + p2), length(p1 - 2.0f * p2 + p3));
+    return std::clamp(static_cast<int>(ceil(sqrt(3 * dd / (4 * tolerance)))), 1, MAX_CURVE_SEGMENTS);
+}
+
+static inline vec2 perp(vec2 v)
+{
+    return vec2(-v.y, v.x);
+}
+
+static inline float cross2(vec2 a, vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+// Fan around center from direction a to direction b (both of length radius), turning
+// the short way
+static void addArc(vec2 center, vec2 a, vec2 b, float radius, float tolerance, vector<vec2>& positions, vector<uint32_t>& indices)
+{
+    auto angle = atan2(cross2(a, b), dot(a, b));
+    auto step = 2 * acos(std::clamp(1 - tolerance / std::max(radius, tolerance), -1.0f, 1.0f));
+    auto n = std::clamp(static_cast<int>(ceil(abs(angle) / std::max(step, 1e-3f))), 1, 64);
+
+    auto c = static_cast<uint32_t>(positions.size());
+    positions.push_back(center);
+    positions.push_back(center + a);
+
+    for (int i = 1; i <= n; i++)
+    {
+        auto t = angle * i / n;
+        auto cs = cos(t);
+        auto sn = sin(t);
+        positions.push_back(center + vec2(a.x * cs - a.y * sn, a.x * sn + a.y * cs));
+
+        auto last = static_cast<uint32_t>(positions.size() - 1);
+        indices.insert(indices.end(), { c, last - 1, last });
+    }
+}
+
+static void addJoin(vec2 p, vec2 d0, vec2 d1, const StrokeStyle& style, vector<vec2>& positions, vector<uint32_t>& indices)
+{
+    auto hw = style.width * 0.5f;
+    auto turn = cross2(d0, d1);
+
+    // Nearly straight, the segments already meet
+    if (abs(turn) < 1e-6f && dot(d0, d1) > 0)
+    {
+        return;
+    }
+
+    // The gap is on the outside of the turn
+    auto side = turn > 0 ? -1.0f : 1.0f;
+    auto n0 = perp(d0) * hw * side;
+    auto n1 = perp(d1) * hw * side;
+
+    if (style.join == LineJoin::Round)
+    {
+        addArc(p, n0, n1, hw, style.tolerance, positions, indices);
+        return;
+    }
+
+    auto base = static_cast<uint32_t>(positions.size());
+    positions.insert(positions.end(), { p, p + n0, p + n1 });
+    indices.insert(indices.end(), { base, base + 1, base + 2 });
+
+    if (style.join == LineJoin::Miter)
+    {
+        // Tip is where the two outer edges meet
+        auto bisector = normalize(n0 + n1);
+        auto cosHalf = dot(bisector, n0) / hw;
+
+        if (cosHalf > 1e-4f && 1 / cosHalf <= style.miterLimit)
+        {
+            positions.push_back(p + bisector * (hw / cosHalf));
+            indices.insert(indices.end(), { base + 1, base + 3, base + 2 });
+        }
+    }
+}
+
+static void addCap(vec2 p, vec2 d, const StrokeStyle& style, vector<vec2>& positions, vector<uint32_t>& indices)
+{
+    // d points away from the line
+    auto hw = style.width * 0.5f;
+    auto n = perp(d) * hw;
+
+    if (style.cap == LineCap::Round)
+    {
+        addArc(p, n, d * hw, hw, style.tolerance, positions, indices);
+        addArc(p, d * hw, -n, hw, style.tolerance, positions, indices);
+    }
+    else if (style.cap == LineCap::Square)
+    {
+        auto base = static_cast<uint32_t>(positions.size());
+        positions.insert(positions.end(), { p + n, p - n, p - n + d * hw, p + n + d * hw });
+        indices.insert(indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+    }
+}
+
+void strokePolyline(const vec2* points, size_t count, bool closed, const StrokeStyle& style, vector<vec2>& positions, vector<uint32_t>& indices)
+{
+    // Drop repeated points
+    vector<vec2> pts;
+    pts.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (pts.empty() || distance(pts.back(), points[i]) > MIN_SEGMENT)
+        {
+            pts.push_back(points[i]);
+        }
+    }
+
+    if (closed && pts.size() > 2 && distance(pts.back(), pts.front()) <= MIN_SEGMENT)
+    {
+        pts.pop_back();
+    }
+
+    if (pts.size() < 2)
+    {
+        return;
+    }
+
+    closed = closed && pts.size() > 2;
+
+    auto hw = style.width * 0.5f;
+    auto segments = closed ? pts.size() : pts.size() - 1;
+
+    for (size_t i = 0; i < segments; i++)
+    {
+        auto a = pts[i];
+        auto b = pts[(i + 1) % pts.size()];
+        auto n = perp(normalize(b - a)) * hw;
+
+        auto base = static_cast<uint32_t>(positions.size());
+        positions.insert(positions.end(), { a + n, a - n, b - n, b + n });
+        indices.insert(indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+    }
+
+    auto direction = [&](size_t i)
+    {
+        return normalize(pts[(i + 1) % pts.size()] - pts[i]);
+    };
+
+    for (size_t i = closed ? 0 : 1; i < pts.size() - (closed ? 0 : 1); i++)
+    {
+        auto prev = (i + pts.size() - 1) % pts.size();
+        addJoin(pts[i], direction(prev), direction(i), style, positions, indices);
+    }
+
+    if (!closed)
+    {
+        addCap(pts.front(), -direction(0), style, positions, indices);
+        addCap(pts.back(), direction(pts.size() - 2), style, positions, indices);
+    }
+}
+
+void strokePath(const Path& path, const StrokeStyle& style, vector<vec2>& positions, vector<uint32_t>& indices)
+{
+    path.flatten(style.tolerance, [&](const vector<vec2>& points, bool closed)
+    {
+        strokePolyline(points.data(), points.size(), closed, style, positions, indices);
+    });
+}
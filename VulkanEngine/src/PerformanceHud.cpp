@@ -0,0 +1,187 @@
+#include "PerformanceHud.hpp"
+
+#include "Renderer.hpp"
+#include "Font.hpp"
+#include "MemoryTracker.hpp"
+#include "RenderGraph.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+// Labels are refreshed at least this often, even when the HUD is over budget
+constexpr uint32_t MAX_REFRESH_INTERVAL = 60;
+
+constexpr int PADDING = 6;
+constexpr int BAR_WIDTH = 2;
+
+static string formatBytes(uint64_t bytes)
+{
+    stringstream ss;
+    ss << fixed << setprecision(1);
+
+    if (bytes >= 1024 * 1024 * 1024)
+    {
+        ss << bytes / (1024.0 * 1024.0 * 1024.0) << " GB";
+    }
+    else if (bytes >= 1024 * 1024)
+    {
+        ss << bytes / (1024.0 * 1024.0) << " MB";
+    }
+    else if (bytes >= 1024)
+    {
+        ss << bytes / 1024.0 << " KB";
+    }
+    else
+    {
+        ss << bytes << " B";
+    }
+
+    return ss.str();
+}
+
+PerformanceHud::PerformanceHud(Renderer* renderer, shared_ptr<Font> font, size_t samples) : font(font), renderer(renderer)
+{
+    frameTimes.resize(std::max(samples, size_t(1)), 0);
+    gpuTimes.resize(frameTimes.size(), 0);
+}
+
+void PerformanceHud::refreshLines()
+{
+    auto& stats = renderer->lastStats;
+    lines.clear();
+
+    auto line = [&](auto&&... values)
+    {
+        stringstream ss;
+        ss << fixed << setprecision(2);
+        (ss << ... << values);
+        lines.push_back(ss.str());
+    };
+
+    auto fps = stats.frameTime > 0 ? 1000.0f / stats.frameTime : 0.0f;
+    line("Frame ", stats.frameTime, " ms (", static_cast<int>(fps), " fps)");
+
+    if (renderer->timestampsSupported)
+    {
+        line("CPU ", stats.cpuTime, " ms, GPU ", stats.gpuTime, " ms");
+    }
+    else
+    {
+        line("CPU ", stats.cpuTime, " ms");
+    }
+
+    line("Draws ", stats.drawCalls, ", instances ", stats.instances, ", pipelines ", stats.pipelineBinds);
+    line("Shapes ", stats.shapesDrawn, " (", stats.shapesCulled, " culled), sprites ", stats.spritesDrawn, ", glyphs ", stats.glyphsDrawn);
+    line("Uploads ", formatBytes(stats.uploadBytes), ", allocations ", stats.allocations, " (", renderer->memoryTracker->getLiveAllocations(), " live)");
+
+    vk::DeviceSize usage = 0;
+    vk::DeviceSize budget = 0;
+    for (auto& i : renderer->memoryTracker->getHeaps())
+    {
+        if (i.deviceLocal)
+        {
+            usage += i.usage;
+            budget += i.budget;
+        }
+    }
+
+    line("VRAM ", formatBytes(usage), " / ", formatBytes(budget));
+    line("Caches ", formatBytes(renderer->memoryTracker->getUsage(MemoryCategory::Caches)), ", evictions ", renderer->memoryTracker->getEvictions());
+
+    auto graph = renderer->graph->getStats();
+    line("Graph passes ", graph.passes, ", barriers ", graph.barriers);
+
+    line("HUD ", cost, " ms, labels every ", refreshInterval, (refreshInterval == 1 ? " frame" : " frames"));
+}
+
+void PerformanceHud::draw()
+{
+    auto start = chrono::steady_clock::now();
+    auto& stats = renderer->lastStats;
+
+    frameTimes[next] = stats.frameTime;
+    gpuTimes[next] = stats.gpuTime;
+    next = (next + 1) % frameTimes.size();
+
+    // Building the strings is most of the cost, and changing text also misses the font's
+    // run cache, so labels can lag behind the graph
+    bool refreshed = lines.empty() || renderer->frameCount - lastRefresh >= refreshInterval;
+    if (refreshed)
+    {
+        refreshLines();
+        lastRefresh = renderer->frameCount;
+    }
+
+    auto extent = renderer->getRenderExtent();
+    auto lineHeight = static_cast<int>(ceil(font->getLineHeight()));
+    auto graphWidth = static_cast<int>(frameTimes.size()) * BAR_WIDTH;
+
+    int width = graphWidth;
+    for (auto& i : lines)
+    {
+        width = std::max(width, static_cast<int>(ceil(font->measure(i).z)));
+    }
+
+    width += PADDING * 2;
+    int height = static_cast<int>(lines.size()) * lineHeight + graphHeight + PADDING * 3;
+
+    // Screen space with y going down, turned into world space with y going up
+    int left = static_cast<int>(renderer->cameraPosition.x) + position.x;
+    int top = static_cast<int>(renderer->cameraPosition.y) + static_cast<int>(extent.height) - position.y;
+
+    renderer->drawRectangle(left, top - height, width, height, 0, backgroundColor, layer);
+
+    // Oldest frame on the left
+    int graphBottom = top - height + PADDING;
+    for (size_t i = 0; i < frameTimes.size(); i++)
+    {
+        auto index = (next + i) % frameTimes.size();
+        auto x = left + PADDING + static_cast<int>(i) * BAR_WIDTH;
+
+        auto frameTime = frameTimes[index];
+        if (frameTime <= 0)
+        {
+            continue;
+        }
+
+        auto color = frameTime > badTime ? vec4(1, 0.2f, 0.2f, 1) : frameTime > warnTime ? vec4(1, 0.8f, 0.2f, 1) : vec4(0.2f, 0.9f, 0.3f, 1);
+        auto barHeight = std::max(1, static_cast<int>(std::min(frameTime / graphScale, 1.0f) * graphHeight));
+        renderer->drawRectangle(x, graphBottom, BAR_WIDTH, barHeight, 0, color, layer + 1);
+
+        if (gpuTimes[index] > 0)
+        {
+            auto gpuHeight = std::max(1, static_cast<int>(std::min(gpuTimes[index] / graphScale, 1.0f) * graphHeight));
+            renderer->drawRectangle(x, graphBottom, BAR_WIDTH, gpuHeight, 0, vec4(0.3f, 0.5f, 1, 0.8f), layer + 2);
+        }
+    }
+
+    // Frame budget line
+    auto warnY = graphBottom + static_cast<int>(std::min(warnTime / graphScale, 1.0f) * graphHeight);
+    renderer->drawRectangle(left + PADDING, warnY, graphWidth, 1, 0, vec4(1, 1, 1, 0.4f), layer + 3);
+
+    auto baseline = top - PADDING - static_cast<int>(ceil(font->getAscent()));
+    for (auto& i : lines)
+    {
+        renderer->drawText(font, i, left + PADDING, baseline, textColor);
+        baseline -= lineHeight;
+    }
+
+    auto elapsed = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+    cost = elapsed;
+
+    // Only frames that refreshed say what a refresh costs
+    if (!refreshed)
+    {
+        return;
+    }
+
+    if (elapsed > budget)
+    {
+        refreshInterval = std::min(refreshInterval * 2, MAX_REFRESH_INTERVAL);
+    }
+    else if (elapsed < budget / 2 && refreshInterval > 1)
+    {
+        refreshInterval /= 2;
+    }
+}
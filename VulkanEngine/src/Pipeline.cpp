@@ -2,7 +2,7 @@
 
 #include "Renderer.hpp"
 
-Pipeline::Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, VertexDefinition vertexDef, vk::DeviceSize uboSize) : renderer(renderer), layout({}), handle({}), descriptorLayout({}), uboSize(uboSize)
+Pipeline::Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, VertexDefinition vertexDef, vk::DeviceSize uboSize, PipelineSettings settings) : renderer(renderer), layout({}), handle({}), descriptorLayout({}), uboSize(uboSize)
 {
     // Make UBO
     auto uboLayoutBinding = vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex);
@@ -19,8 +19,8 @@ Pipeline::Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, Verte
     }
 
     vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &vertexDef.binding;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexDef.bindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = vertexDef.bindings.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexDef.attributes.size());
     vertexInputInfo.pVertexAttributeDescriptions = vertexDef.attributes.data();
 
@@ -28,28 +28,17 @@ Pipeline::Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, Verte
     inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float) renderer->swapChain->extent.width;
-    viewport.height = (float) renderer->swapChain->extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    scissor.offset = vk::Offset2D{ 0, 0 };
-    scissor.extent = renderer->swapChain->extent;
-
+    // Set on bind, since layers draw at their own size and damage tracking can shrink the scissor
     vk::PipelineViewportStateCreateInfo viewportState = {};
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
 
     vk::PipelineRasterizationStateCreateInfo rasterizer = {};
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
     rasterizer.polygonMode = vk::PolygonMode::eFill;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = vk::CullModeFlagBits::eBack;
+    rasterizer.cullMode = settings.cullMode;
     rasterizer.frontFace = vk::FrontFace::eClockwise;
     rasterizer.depthBiasEnable = VK_FALSE;
 
@@ -57,9 +46,24 @@ Pipeline::Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, Verte
     multisampling.sampleShadingEnable = VK_FALSE;
     multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
 
+    bool hasDepth = renderer->depthFormat != vk::Format::eUndefined;
+
+    vk::PipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.depthTestEnable = hasDepth && settings.depthTest;
+    depthStencil.depthWriteEnable = hasDepth && settings.depthWrite;
+    depthStencil.depthCompareOp = vk::CompareOp::eLess;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
     vk::PipelineColorBlendAttachmentState colorBlendAttachment = {};
     colorBlendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
-    colorBlendAttachment.blendEnable = VK_FALSE;
+    colorBlendAttachment.blendEnable = settings.alphaBlending;
+    colorBlendAttachment.srcColorBlendFactor = settings.premultipliedAlpha ? vk::BlendFactor::eOne : vk::BlendFactor::eSrcAlpha;
+    colorBlendAttachment.dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+    colorBlendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+    colorBlendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+    colorBlendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+    colorBlendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
 
     vk::PipelineColorBlendStateCreateInfo colorBlending = {};
     colorBlending.logicOpEnable = VK_FALSE;
@@ -74,9 +78,12 @@ Pipeline::Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, Verte
     vector<vk::DynamicState> states = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
     auto dynamicState = vk::PipelineDynamicStateCreateInfo({}, {states});
 
+    vector<vk::DescriptorSetLayout> setLayouts = { descriptorLayout };
+    setLayouts.insert(setLayouts.end(), settings.extraSetLayouts.begin(), settings.extraSetLayouts.end());
+
     vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &*descriptorLayout;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
     pipelineLayoutInfo.pushConstantRangeCount = 0;
 
     try
@@ -96,11 +103,28 @@ Pipeline::Pipeline(Renderer* renderer, vector<shared_ptr<Shader>> shaders, Verte
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = layout;
-    pipelineInfo.renderPass = renderer->renderPass->handle;
     pipelineInfo.subpass = 0;
+
+    // With dynamic rendering pipelines only depend on the attachment formats, so they work
+    // with any target in them
+    auto colorFormat = renderer->swapChain->imageFormat;
+    vk::PipelineRenderingCreateInfo renderingInfo = {};
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    renderingInfo.depthAttachmentFormat = renderer->depthFormat;
+
+    if (renderer->enabledFeatures13.dynamicRendering)
+    {
+        pipelineInfo.pNext = &renderingInfo;
+    }
+    else
+    {
+        pipelineInfo.renderPass = renderer->renderPass->handle;
+    }
     pipelineInfo.basePipelineHandle = nullptr;
 
     try
@@ -121,9 +145,11 @@ void Pipeline::beginFrame()
 void Pipeline::bind(vki::CommandBuffer& cmds)
 {
     cmds.bindPipeline(vk::PipelineBindPoint::eGraphics, handle);
+    renderer->stats.pipelineBinds++;
 
-    cmds.setViewport(0, {viewport});
-    cmds.setScissor(0, {scissor});
+    auto extent = renderer->getRenderExtent();
+    cmds.setViewport(0, { vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f) });
+    cmds.setScissor(0, { renderer->getRenderArea() });
 }
 
 shared_ptr<UniformSet> Pipeline::getUniformSet()
@@ -0,0 +1,111 @@
+#include "RectPacker.hpp"
+
+RectPacker::RectPacker(int width, int height) : width(width), height(height)
+{
+    clear();
+}
+
+void RectPacker::clear()
+{
+    skyline.clear();
+    skyline.push_back({ 0, 0, width });
+}
+
+int RectPacker::fit(size_t index, int rectWidth, int rectHeight)
+{
+    auto x = skyline[index].x;
+    if (x + rectWidth > width)
+    {
+        return -1;
+    }
+
+    // The rectangle rests on the highest segment it spans
+    int y = 0;
+    int remaining = rectWidth;
+
+    for (auto i = index; remaining > 0; i++)
+    {
+        y = std::max(y, skyline[i].y);
+        if (y + rectHeight > height)
+        {
+            return -1;
+        }
+
+        remaining -= skyline[i].width;
+    }
+
+    return y;
+}
+
+optional<ivec2> RectPacker::pack(int rectWidth, int rectHeight)
+{
+    if (rectWidth <= 0 || rectHeight <= 0)
+    {
+        return ivec2(0, 0);
+    }
+
+    size_t best = skyline.size();
+    int bestY = numeric_limits<int>::max();
+    int bestWidth = numeric_limits<int>::max();
+
+    for (size_t i = 0; i < skyline.size(); i++)
+    {
+        auto y = fit(i, rectWidth, rectHeight);
+
+        // Lowest top edge, then the narrowest segment to keep gaps small
+        if (y >= 0 && (y + rectHeight < bestY || (y + rectHeight == bestY && skyline[i].width < bestWidth)))
+        {
+            best = i;
+            bestY = y + rectHeight;
+            bestWidth = skyline[i].width;
+        }
+    }
+
+    if (best == skyline.size())
+    {
+        return nullopt;
+    }
+
+    ivec2 pos = { skyline[best].x, bestY - rectHeight };
+
+    // Raise the skyline under the new rectangle and trim what it covers
+    skyline.insert(skyline.begin() + best, { pos.x, bestY, rectWidth });
+
+    for (auto i = best + 1; i < skyline.size();)
+    {
+        auto& prev = skyline[i - 1];
+        auto& cur = skyline[i];
+
+        if (cur.x >= prev.x + prev.width)
+        {
+            break;
+        }
+
+        auto shrink = prev.x + prev.width - cur.x;
+        cur.x += shrink;
+        cur.width -= shrink;
+
+        if (cur.width > 0)
+        {
+            break;
+        }
+
+        skyline.erase(skyline.begin() + i);
+    }
+
+    // Merge neighbours at the same height
+    for (size_t i = 0; i + 1 < skyline.size();)
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return pos;
+}
@@ -0,0 +1,633 @@
+#include "RenderGraph.hpp"
+
+#include "Renderer.hpp"
+
+#include <algorithm>
+
+struct UsageInfo
+{
+    vk::PipelineStageFlags2 stage;
+    vk::AccessFlags2 access;
+    vk::ImageLayout layout;
+    vk::ImageUsageFlags imageUsage;
+    bool write;
+};
+
+static UsageInfo getUsageInfo(ResourceUsage usage)
+{
+    using Stage = vk::PipelineStageFlagBits2;
+    using Access = vk::AccessFlagBits2;
+    using Layout = vk::ImageLayout;
+    using Usage = vk::ImageUsageFlagBits;
+
+    switch (usage)
+    {
+        case ResourceUsage::TransferRead:
+            return { Stage::eAllTransfer, Access::eTransferRead, Layout::eTransferSrcOptimal, Usage::eTransferSrc, false };
+        case ResourceUsage::TransferWrite:
+            return { Stage::eAllTransfer, Access::eTransferWrite, Layout::eTransferDstOptimal, Usage::eTransferDst, true };
+        case ResourceUsage::ComputeRead:
+            return { Stage::eComputeShader, Access::eShaderRead, Layout::eShaderReadOnlyOptimal, Usage::eSampled, false };
+        case ResourceUsage::ComputeWrite:
+            return { Stage::eComputeShader, Access::eShaderRead | Access::eShaderWrite, Layout::eGeneral, Usage::eStorage, true };
+        case ResourceUsage::IndirectRead:
+            return { Stage::eDrawIndirect, Access::eIndirectCommandRead, Layout::eUndefined, {}, false };
+        case ResourceUsage::VertexRead:
+            return { Stage::eVertexInput, Access::eVertexAttributeRead | Access::eIndexRead, Layout::eUndefined, {}, false };
+        case ResourceUsage::FragmentRead:
+            return { Stage::eFragmentShader, Access::eShaderRead, Layout::eShaderReadOnlyOptimal, Usage::eSampled, false };
+        case ResourceUsage::ColorAttachment:
+            return { Stage::eColorAttachmentOutput, Access::eColorAttachmentRead | Access::eColorAttachmentWrite, Layout::eColorAttachmentOptimal, Usage::eColorAttachment, true };
+        case ResourceUsage::DepthAttachment:
+            return { Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite, Layout::eDepthStencilAttachmentOptimal, Usage::eDepthStencilAttachment, true };
+        case ResourceUsage::Present:
+            return { Stage::eNone, Access::eNone, Layout::ePresentSrcKHR, {}, false };
+        default:
+            return { Stage::eNone, Access::eNone, Layout::eUndefined, {}, false };
+    }
+}
+
+static void hashCombine(uint64_t& hash, uint64_t value)
+{
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+}
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, size_t pass) : graph(graph), pass(pass)
+{
+
+}
+
+void RenderGraph::PassBuilder::read(Resource resource, ResourceUsage usage)
+{
+    graph.passes[pass].accesses.push_back({ resource, usage, false });
+}
+
+void RenderGraph::PassBuilder::write(Resource resource, ResourceUsage usage)
+{
+    graph.passes[pass].accesses.push_back({ resource, usage, true });
+}
+
+void RenderGraph::PassBuilder::keep()
+{
+    graph.passes[pass].keep = true;
+}
+
+RenderGraph::RenderGraph(Renderer* renderer) : renderer(renderer)
+{
+
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const string& name, vk::Buffer buffer, ResourceUsage before, ResourceUsage after)
+{
+    ResourceInfo info = {};
+    info.name = name;
+    info.imported = true;
+    info.isImage = false;
+    info.buffer = buffer;
+    info.before = before;
+    info.after = after;
+
+    resources.push_back(info);
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importImage(const string& name, vk::Image image, vk::ImageView view, vk::ImageAspectFlags aspect, ResourceUsage before, ResourceUsage after)
+{
+    ResourceInfo info = {};
+    info.name = name;
+    info.imported = true;
+    info.isImage = true;
+    info.image = image;
+    info.view = view;
+    info.aspect = aspect;
+    info.before = before;
+    info.after = after;
+
+    resources.push_back(info);
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::createImage(const string& name, uint32_t width, uint32_t height, vk::Format format)
+{
+    ResourceInfo info = {};
+    info.name = name;
+    info.imported = false;
+    info.isImage = true;
+    info.width = width;
+    info.height = height;
+    info.format = format;
+
+    switch (format)
+    {
+        case vk::Format::eD16Unorm:
+        case vk::Format::eD32Sfloat:
+        case vk::Format::eX8D24UnormPack32:
+            info.aspect = vk::ImageAspectFlagBits::eDepth;
+            break;
+        case vk::Format::eD16UnormS8Uint:
+        case vk::Format::eD24UnormS8Uint:
+        case vk::Format::eD32SfloatS8Uint:
+            info.aspect = vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+            break;
+        default:
+            info.aspect = vk::ImageAspectFlagBits::eColor;
+            break;
+    }
+
+    resources.push_back(info);
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+void RenderGraph::addPass(const string& name, function<void(PassBuilder&)> setup, function<void(vki::CommandBuffer&)> execute)
+{
+    if (!renderer->enabledFeatures13.synchronization2)
+    {
+        throw std::runtime_error("The render graph needs synchronization2 support");
+    }
+
+    passes.push_back({ name, {}, false, std::move(execute) });
+
+    PassBuilder builder(*this, passes.size() - 1);
+    setup(builder);
+}
+
+vk::Buffer RenderGraph::getBuffer(Resource resource)
+{
+    return resources[resource].buffer;
+}
+
+vk::Image RenderGraph::getImage(Resource resource)
+{
+    auto& info = resources[resource];
+    return info.imported ? info.image : *compiled->transients[resource].image;
+}
+
+vk::ImageView RenderGraph::getImageView(Resource resource)
+{
+    auto& info = resources[resource];
+    return info.imported ? info.view : *compiled->transients[resource].view;
+}
+
+void RenderGraph::execute(vki::CommandBuffer& cmds)
+{
+    erase_if(retired, [this](const auto& i) { return renderer->frameCount >= i.first + renderer->MAX_FRAMES_IN_FLIGHT; });
+
+    if (!passes.empty())
+    {
+        auto shape = hashShape();
+
+        if (!compiled || compiled->shape != shape)
+        {
+            // The frames in flight may still be using its transient images
+            if (compiled)
+            {
+                retired.push_back({ renderer->frameCount, compiled });
+            }
+
+            compiled = compile(shape);
+            compiles++;
+        }
+
+        for (size_t i = 0; i < compiled->levels.size(); i++)
+        {
+            recordBarriers(cmds, compiled->barriers[i]);
+
+            for (auto pass : compiled->levels[i])
+            {
+                passes[pass].execute(cmds);
+            }
+        }
+
+        recordBarriers(cmds, compiled->barriers.back());
+    }
+
+    passes.clear();
+    resources.clear();
+}
+
+RenderGraphStats RenderGraph::getStats()
+{
+    auto stats = compiled ? compiled->stats : RenderGraphStats{};
+    stats.compiles = compiles;
+    return stats;
+}
+
+uint64_t RenderGraph::hashShape()
+{
+    uint64_t hash = 0;
+
+    for (auto& i : resources)
+    {
+        hashCombine(hash, std::hash<string>{}(i.name));
+        hashCombine(hash, (i.imported ? 1 : 0) | (i.isImage ? 2 : 0));
+        hashCombine(hash, static_cast<uint64_t>(i.before) | static_cast<uint64_t>(i.after) << 8);
+        hashCombine(hash, static_cast<uint64_t>(static_cast<VkImageAspectFlags>(i.aspect)));
+        hashCombine(hash, static_cast<uint64_t>(i.width) | static_cast<uint64_t>(i.height) << 32);
+        hashCombine(hash, static_cast<uint64_t>(i.format));
+    }
+
+    for (auto& i : passes)
+    {
+        hashCombine(hash, std::hash<string>{}(i.name));
+        hashCombine(hash, i.keep);
+
+        for (auto& access : i.accesses)
+        {
+            hashCombine(hash, access.resource | static_cast<uint64_t>(access.usage) << 32 | static_cast<uint64_t>(access.write) << 40);
+        }
+    }
+
+    return hash;
+}
+
+shared_ptr<RenderGraph::Compiled> RenderGraph::compile(uint64_t shape)
+{
+    auto result = make_shared<Compiled>();
+    result->shape = shape;
+
+    auto passCount = passes.size();
+    auto resourceCount = resources.size();
+
+    // Everything that has to happen before each pass, and just the passes it gets data from
+    vector<vector<size_t>> dependencies(passCount);
+    vector<vector<size_t>> producers(passCount);
+
+    vector<optional<size_t>> lastWriter(resourceCount);
+    vector<vector<pair<size_t, ResourceUsage>>> readers(resourceCount);
+
+    for (size_t pass = 0; pass < passCount; pass++)
+    {
+        for (auto& access : passes[pass].accesses)
+        {
+            auto resource = access.resource;
+
+            if (lastWriter[resource] && *lastWriter[resource] != pass)
+            {
+                dependencies[pass].push_back(*lastWriter[resource]);
+                producers[pass].push_back(*lastWriter[resource]);
+            }
+
+            if (access.write)
+            {
+                for (auto& [reader, usage] : readers[resource])
+                {
+                    if (reader != pass)
+                    {
+                        dependencies[pass].push_back(reader);
+                    }
+                }
+
+                readers[resource].clear();
+                lastWriter[resource] = pass;
+            }
+            else
+            {
+                // An image can only be in one layout at a time
+                if (resources[resource].isImage)
+                {
+                    for (auto& [reader, usage] : readers[resource])
+                    {
+                        if (reader != pass && getUsageInfo(usage).layout != getUsageInfo(access.usage).layout)
+                        {
+                            dependencies[pass].push_back(reader);
+                        }
+                    }
+                }
+
+                readers[resource].push_back({ pass, access.usage });
+            }
+        }
+    }
+
+    // Keep passes with visible effects and everything they get data from
+    vector<bool> kept(passCount, false);
+
+    for (size_t pass = 0; pass < passCount; pass++)
+    {
+        kept[pass] = passes[pass].keep || any_of(passes[pass].accesses.begin(), passes[pass].accesses.end(), [this](const Access& i) { return i.write && resources[i.resource].imported; });
+    }
+
+    for (size_t pass = passCount; pass-- > 0;)
+    {
+        if (kept[pass])
+        {
+            for (auto i : producers[pass])
+            {
+                kept[i] = true;
+            }
+        }
+    }
+
+    // Each pass goes in the level after everything it depends on, so passes in the same
+    // level can share one barrier
+    vector<size_t> levels(passCount, 0);
+    size_t levelCount = 0;
+
+    for (size_t pass = 0; pass < passCount; pass++)
+    {
+        if (!kept[pass])
+        {
+            result->stats.culled++;
+            continue;
+        }
+
+        for (auto i : dependencies[pass])
+        {
+            if (kept[i])
+            {
+                levels[pass] = std::max(levels[pass], levels[i] + 1);
+            }
+        }
+
+        levelCount = std::max(levelCount, levels[pass] + 1);
+        result->stats.passes++;
+    }
+
+    result->levels.resize(levelCount);
+    result->barriers.resize(levelCount + 1);
+
+    for (size_t pass = 0; pass < passCount; pass++)
+    {
+        if (kept[pass])
+        {
+            result->levels[levels[pass]].push_back(pass);
+        }
+    }
+
+    // Walk the accesses in execution order, tracking what each resource needs to wait on
+    struct State
+    {
+        vk::PipelineStageFlags2 writeStage;
+        vk::AccessFlags2 writeAccess;
+        vk::PipelineStageFlags2 readStages;
+        // Stages that have already waited on the last write
+        vk::PipelineStageFlags2 visibleStages;
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        bool used = false;
+    };
+
+    vector<State> states(resourceCount);
+    vector<pair<size_t, size_t>> lifetimes(resourceCount, { SIZE_MAX, 0 });
+    vector<vk::ImageUsageFlags> imageUsages(resourceCount);
+
+    for (size_t i = 0; i < resourceCount; i++)
+    {
+        auto& info = resources[i];
+
+        if (info.imported)
+        {
+            auto before = getUsageInfo(info.before);
+            (before.write ? states[i].writeStage : states[i].readStages) = before.stage;
+            states[i].writeAccess = before.write ? before.access : vk::AccessFlags2();
+            states[i].layout = before.layout;
+        }
+        else
+        {
+            // Last frame, or another image sharing its memory, may still be using it
+            states[i].writeStage = vk::PipelineStageFlagBits2::eAllCommands;
+            states[i].writeAccess = vk::AccessFlagBits2::eMemoryWrite;
+        }
+    }
+
+    for (size_t level = 0; level < levelCount; level++)
+    {
+        for (auto pass : result->levels[level])
+        {
+            for (auto& access : passes[pass].accesses)
+            {
+                auto resource = access.resource;
+                auto& info = resources[resource];
+                auto& state = states[resource];
+                auto usage = getUsageInfo(access.usage);
+
+                if (!info.imported && !state.used && !access.write)
+                {
+                    throw std::runtime_error("Pass " + passes[pass].name + " reads " + info.name + " before anything writes it");
+                }
+
+                state.used = true;
+                lifetimes[resource].first = std::min(lifetimes[resource].first, level);
+                lifetimes[resource].second = std::max(lifetimes[resource].second, level);
+                imageUsages[resource] |= usage.imageUsage;
+
+                bool layoutChange = info.isImage && state.layout != usage.layout;
+                Barrier barrier = { resource, {}, {}, usage.stage, usage.access, state.layout, info.isImage ? usage.layout : state.layout };
+                bool needed;
+
+                if (access.write || layoutChange)
+                {
+                    // Everything before has to be done, since a layout change counts as a write
+                    barrier.srcStage = state.writeStage | state.readStages;
+                    barrier.srcAccess = state.writeAccess;
+                    needed = layoutChange || barrier.srcStage;
+
+                    if (access.write)
+                    {
+                        state.writeAccess = usage.access;
+                    }
+
+                    state.writeStage = usage.stage;
+                    state.readStages = access.write ? vk::PipelineStageFlags2() : usage.stage;
+                    state.visibleStages = usage.stage;
+                }
+                else
+                {
+                    // Reads in the same layout only wait if their stage hasn't seen the last write
+                    barrier.srcStage = state.writeStage;
+                    barrier.srcAccess = state.writeAccess;
+                    needed = state.writeAccess && (usage.stage & ~state.visibleStages);
+
+                    state.readStages |= usage.stage;
+                    state.visibleStages |= usage.stage;
+                }
+
+                state.layout = barrier.newLayout;
+
+                if (needed)
+                {
+                    result->barriers[level].push_back(barrier);
+                }
+            }
+        }
+    }
+
+    // Hand imported resources over to whatever uses them next
+    for (size_t i = 0; i < resourceCount; i++)
+    {
+        auto& info = resources[i];
+        auto& state = states[i];
+
+        if (!info.imported || !state.used || info.after == ResourceUsage::None)
+        {
+            continue;
+        }
+
+        auto after = getUsageInfo(info.after);
+        bool layoutChange = info.isImage && state.layout != after.layout;
+
+        Barrier barrier = { static_cast<Resource>(i), state.writeStage | state.readStages, state.writeAccess, after.stage, after.access, state.layout, info.isImage ? after.layout : state.layout };
+
+        if (layoutChange || (after.write ? bool(barrier.srcStage) : bool(state.writeAccess)))
+        {
+            result->barriers.back().push_back(barrier);
+        }
+    }
+
+    for (auto& i : result->barriers)
+    {
+        result->stats.barriers += static_cast<uint32_t>(i.size());
+    }
+
+    result->stats.levels = static_cast<uint32_t>(levelCount);
+
+    // Images are made here, now that their usage is known
+    result->transients.resize(resourceCount);
+
+    for (size_t i = 0; i < resourceCount; i++)
+    {
+        auto& info = resources[i];
+
+        if (info.imported || !states[i].used)
+        {
+            continue;
+        }
+
+        vk::ImageCreateInfo imageInfo = {};
+        imageInfo.imageType = vk::ImageType::e2D;
+        imageInfo.extent = vk::Extent3D(info.width, info.height, 1);
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = info.format;
+        imageInfo.tiling = vk::ImageTiling::eOptimal;
+        imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+        imageInfo.usage = imageUsages[i];
+        imageInfo.samples = vk::SampleCountFlagBits::e1;
+        imageInfo.sharingMode = vk::SharingMode::eExclusive;
+
+        try
+        {
+            result->transients[i].image = renderer->device.createImage(imageInfo);
+        }
+        catch (vk::SystemError err)
+        {
+            throw std::runtime_error("Error creating transient image " + info.name);
+        }
+    }
+
+    allocateTransients(*result, lifetimes);
+
+    return result;
+}
+
+void RenderGraph::allocateTransients(Compiled& result, const vector<pair<size_t, size_t>>& lifetimes)
+{
+    struct Block
+    {
+        vk::DeviceSize size = 0;
+        uint32_t memoryTypeBits = ~0u;
+        vector<pair<size_t, size_t>> lifetimes;
+        vector<Resource> images;
+    };
+
+    vector<Resource> order;
+    vector<vk::MemoryRequirements> requirements(resources.size());
+
+    for (size_t i = 0; i < resources.size(); i++)
+    {
+        if (*result.transients[i].image)
+        {
+            requirements[i] = result.transients[i].image.getMemoryRequirements();
+            order.push_back(static_cast<Resource>(i));
+        }
+    }
+
+    // Biggest first, so smaller images fit in the gaps
+    sort(order.begin(), order.end(), [&](Resource a, Resource b) { return requirements[a].size > requirements[b].size; });
+
+    vector<Block> blocks;
+
+    for (auto i : order)
+    {
+        auto& lifetime = lifetimes[i];
+
+        auto block = find_if(blocks.begin(), blocks.end(), [&](const Block& b)
+        {
+            if (!(b.memoryTypeBits & requirements[i].memoryTypeBits))
+            {
+                return false;
+            }
+
+            return none_of(b.lifetimes.begin(), b.lifetimes.end(), [&](const pair<size_t, size_t>& other) { return lifetime.first <= other.second && other.first <= lifetime.second; });
+        });
+
+        if (block == blocks.end())
+        {
+            block = blocks.insert(blocks.end(), Block{});
+        }
+
+        // Every image goes at the start of the block, which meets any alignment
+        block->size = std::max(block->size, requirements[i].size);
+        block->memoryTypeBits &= requirements[i].memoryTypeBits;
+        block->lifetimes.push_back(lifetime);
+        block->images.push_back(i);
+
+        result.stats.unaliasedBytes += requirements[i].size;
+    }
+
+    for (auto& block : blocks)
+    {
+        try
+        {
+            result.memory.push_back(renderer->memoryTracker->allocate(vk::MemoryRequirements(block.size, 0, block.memoryTypeBits), vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryCategory::Attachments));
+        }
+        catch (vk::SystemError err)
+        {
+            throw std::runtime_error("Error allocating transient image memory");
+        }
+
+        for (auto i : block.images)
+        {
+            auto& info = resources[i];
+            auto& transient = result.transients[i];
+
+            transient.image.bindMemory(result.memory.back(), 0);
+
+            // Views only see one aspect, and depth is the one that gets sampled
+            auto aspect = info.aspect & vk::ImageAspectFlagBits::eDepth ? vk::ImageAspectFlags(vk::ImageAspectFlagBits::eDepth) : info.aspect;
+            transient.view = renderer->createImageView(transient.image, info.format, aspect);
+        }
+
+        result.stats.transientBytes += block.size;
+    }
+}
+
+void RenderGraph::recordBarriers(vki::CommandBuffer& cmds, const vector<Barrier>& barriers)
+{
+    if (barriers.empty())
+    {
+        return;
+    }
+
+    vector<vk::BufferMemoryBarrier2> bufferBarriers;
+    vector<vk::ImageMemoryBarrier2> imageBarriers;
+
+    for (auto& i : barriers)
+    {
+        auto& info = resources[i.resource];
+
+        if (info.isImage)
+        {
+            auto range = vk::ImageSubresourceRange(info.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS);
+            imageBarriers.push_back(vk::ImageMemoryBarrier2(i.srcStage, i.srcAccess, i.dstStage, i.dstAccess, i.oldLayout, i.newLayout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, getImage(i.resource), range));
+        }
+        else
+        {
+            bufferBarriers.push_back(vk::BufferMemoryBarrier2(i.srcStage, i.srcAccess, i.dstStage, i.dstAccess, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, info.buffer, 0, VK_WHOLE_SIZE));
+        }
+    }
+
+    vk::DependencyInfo dependency = {};
+    dependency.setBufferMemoryBarriers(bufferBarriers);
+    dependency.setImageMemoryBarriers(imageBarriers);
+    cmds.pipelineBarrier2(dependency);
+}
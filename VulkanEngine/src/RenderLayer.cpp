@@ -0,0 +1,88 @@
+#include "RenderLayer.hpp"
+
+#include "Renderer.hpp"
+#include "Texture.hpp"
+
+RenderLayer::RenderLayer(Renderer* renderer, uint32_t width, uint32_t height, vec2 position) : renderer(renderer), width(width), height(height), position(position), depthImage({}), depthMemory({}), depthView({}), framebuffer({})
+{
+    if (width == 0 || height == 0)
+    {
+        throw std::runtime_error("Layers can't be empty");
+    }
+
+    allocate();
+    evictionCallback = renderer->memoryTracker->addEvictionCallback([this]() { return evict(); });
+}
+
+RenderLayer::~RenderLayer()
+{
+    renderer->memoryTracker->removeEvictionCallback(evictionCallback);
+}
+
+void RenderLayer::allocate()
+{
+    texture = make_shared<Texture>(renderer, width, height, renderer->swapChain->imageFormat, vk::ImageUsageFlagBits::eColorAttachment, MemoryCategory::Caches);
+
+    bool hasDepth = renderer->depthFormat != vk::Format::eUndefined;
+
+    if (hasDepth)
+    {
+        renderer->createImage(width, height, renderer->depthFormat, vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImage, depthMemory, MemoryCategory::Caches);
+        depthView = renderer->createImageView(depthImage, renderer->depthFormat, vk::ImageAspectFlagBits::eDepth);
+    }
+
+    // Dynamic rendering draws straight into the views
+    if (renderer->enabledFeatures13.dynamicRendering)
+    {
+        return;
+    }
+
+    vk::ImageView attachments[] = { *texture->view, *depthView };
+
+    vk::FramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.renderPass = renderer->layerRenderPass->handle;
+    framebufferInfo.attachmentCount = hasDepth ? 2 : 1;
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = width;
+    framebufferInfo.height = height;
+    framebufferInfo.layers = 1;
+
+    try
+    {
+        framebuffer = renderer->device.createFramebuffer(framebufferInfo);
+    }
+    catch (vk::SystemError err)
+    {
+        throw std::runtime_error("Error making layer framebuffer");
+    }
+}
+
+vk::DeviceSize RenderLayer::evict()
+{
+    // Frames in flight may still sample it, and the app may have registered the texture
+    if (!texture || texture.use_count() > 1 || lastUsed + renderer->MAX_FRAMES_IN_FLIGHT > renderer->frameCount)
+    {
+        return 0;
+    }
+
+    auto freed = texture->memory.getSize() + depthMemory.getSize();
+
+    framebuffer = nullptr;
+    depthView = nullptr;
+    depthImage = nullptr;
+    depthMemory = nullptr;
+    texture = nullptr;
+
+    valid = false;
+    return freed;
+}
+
+RenderTarget RenderLayer::getTarget()
+{
+    return { *texture->image, *texture->view, *depthImage, *depthView, *framebuffer };
+}
+
+uvec2 RenderLayer::getSize()
+{
+    return uvec2(width, height);
+}
@@ -3,8 +3,15 @@
 
 
 
-RenderPass::RenderPass(Renderer* renderer) : renderer(renderer), handle({})
+RenderPass::RenderPass(Renderer* renderer, RenderPassType type) : renderer(renderer), handle({}), type(type)
 {
+    if (renderer->enabledFeatures13.dynamicRendering)
+    {
+        return;
+    }
+
+    bool offscreen = type == RenderPassType::Offscreen;
+
     vk::AttachmentDescription colorAttachment = {};
     colorAttachment.format = renderer->swapChain->imageFormat;
     colorAttachment.samples = vk::SampleCountFlagBits::e1;
@@ -12,17 +19,35 @@ RenderPass::RenderPass(Renderer* renderer) : renderer(renderer), handle({})
     colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
     colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
     colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-    colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-    colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+    colorAttachment.initialLayout = getInitialLayout();
+    colorAttachment.finalLayout = getFinalLayout();
 
     vk::AttachmentReference colorAttachmentRef = {};
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = vk::ImageLayout::eColorAttachmentOptimal;
 
+    // Depth is only needed while the frame is being drawn
+    vk::AttachmentDescription depthAttachment = {};
+    depthAttachment.format = renderer->depthFormat;
+    depthAttachment.samples = vk::SampleCountFlagBits::e1;
+    depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+    depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+    depthAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+    depthAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+    depthAttachment.initialLayout = vk::ImageLayout::eUndefined;
+    depthAttachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    vk::AttachmentReference depthAttachmentRef = {};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+    bool hasDepth = renderer->depthFormat != vk::Format::eUndefined;
+
     vk::SubpassDescription subpass = {};
     subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = hasDepth ? &depthAttachmentRef : nullptr;
 
     vk::SubpassDependency dependency = {};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
@@ -31,13 +56,40 @@ RenderPass::RenderPass(Renderer* renderer) : renderer(renderer), handle({})
     dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
     dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
 
+    if (hasDepth)
+    {
+        // The last frame may still be testing against the shared depth image
+        dependency.srcStageMask |= vk::PipelineStageFlagBits::eLateFragmentTests;
+        dependency.dstStageMask |= vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+        dependency.srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        dependency.dstAccessMask |= vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    }
+
+    // Offscreen images get sampled by the frame once the pass is done
+    vk::SubpassDependency sampled = {};
+    sampled.srcSubpass = 0;
+    sampled.dstSubpass = VK_SUBPASS_EXTERNAL;
+    sampled.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    sampled.dstStageMask = vk::PipelineStageFlagBits::eFragmentShader;
+    sampled.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    sampled.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+    if (offscreen)
+    {
+        // and the last frame may still be sampling the old contents
+        dependency.srcStageMask |= vk::PipelineStageFlagBits::eFragmentShader;
+    }
+
+    vk::SubpassDependency dependencies[] = { dependency, sampled };
+    vk::AttachmentDescription attachments[] = { colorAttachment, depthAttachment };
+
     vk::RenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.attachmentCount = hasDepth ? 2 : 1;
+    renderPassInfo.pAttachments = attachments;
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = offscreen ? 2 : 1;
+    renderPassInfo.pDependencies = dependencies;
 
     try
     {
@@ -49,15 +101,112 @@ RenderPass::RenderPass(Renderer* renderer) : renderer(renderer), handle({})
     }
 }
 
-vk::RenderPassBeginInfo RenderPass::getBeginInfo(vki::Framebuffer& framebuffer)
+void RenderPass::begin(vki::CommandBuffer& cmds, const RenderTarget& target)
+{
+    if (*handle)
+    {
+        cmds.beginRenderPass(getBeginInfo(target.framebuffer), vk::SubpassContents::eInline);
+        return;
+    }
+
+    // Same dependencies the render pass would have
+    bool offscreen = type == RenderPassType::Offscreen;
+    bool hasDepth = renderer->depthFormat != vk::Format::eUndefined;
+
+    vector<vk::ImageMemoryBarrier2> barriers;
+
+    auto colorSrc = vk::PipelineStageFlags2(vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+    if (offscreen)
+    {
+        colorSrc |= vk::PipelineStageFlagBits2::eFragmentShader;
+    }
+
+    barriers.push_back(vk::ImageMemoryBarrier2(colorSrc, {}, vk::PipelineStageFlagBits2::eColorAttachmentOutput, vk::AccessFlagBits2::eColorAttachmentRead | vk::AccessFlagBits2::eColorAttachmentWrite,
+        getInitialLayout(), vk::ImageLayout::eColorAttachmentOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, target.image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)));
+
+    if (hasDepth)
+    {
+        // The last frame may still be testing against the shared depth image
+        auto aspect = renderer->depthFormat == vk::Format::eD32Sfloat ? vk::ImageAspectFlags(vk::ImageAspectFlagBits::eDepth) : vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+        auto tests = vk::PipelineStageFlagBits2::eEarlyFragmentTests | vk::PipelineStageFlagBits2::eLateFragmentTests;
+
+        barriers.push_back(vk::ImageMemoryBarrier2(vk::PipelineStageFlagBits2::eLateFragmentTests, vk::AccessFlagBits2::eDepthStencilAttachmentWrite, tests, vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+            vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, target.depthImage, vk::ImageSubresourceRange(aspect, 0, 1, 0, 1)));
+    }
+
+    vk::DependencyInfo dependency = {};
+    dependency.setImageMemoryBarriers(barriers);
+    cmds.pipelineBarrier2(dependency);
+
+    vk::RenderingAttachmentInfo color = {};
+    color.imageView = target.view;
+    color.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+    color.loadOp = vk::AttachmentLoadOp::eClear;
+    color.storeOp = vk::AttachmentStoreOp::eStore;
+    color.clearValue = offscreen ? vk::ClearValue(array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f }) : renderer->clearColor;
+
+    vk::RenderingAttachmentInfo depth = {};
+    depth.imageView = target.depthView;
+    depth.imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+    depth.loadOp = vk::AttachmentLoadOp::eClear;
+    depth.storeOp = vk::AttachmentStoreOp::eDontCare;
+    depth.clearValue.depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
+
+    vk::RenderingInfo renderingInfo = {};
+    renderingInfo.renderArea = renderer->getRenderArea();
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &color;
+    renderingInfo.pDepthAttachment = hasDepth ? &depth : nullptr;
+
+    cmds.beginRendering(renderingInfo);
+}
+
+void RenderPass::end(vki::CommandBuffer& cmds, const RenderTarget& target)
+{
+    if (*handle)
+    {
+        cmds.endRenderPass();
+        return;
+    }
+
+    cmds.endRendering();
+
+    // Offscreen images get sampled by the frame once the pass is done, and the rest get presented
+    bool offscreen = type == RenderPassType::Offscreen;
+
+    auto dstStage = offscreen ? vk::PipelineStageFlags2(vk::PipelineStageFlagBits2::eFragmentShader) : vk::PipelineStageFlags2();
+    auto dstAccess = offscreen ? vk::AccessFlags2(vk::AccessFlagBits2::eShaderRead) : vk::AccessFlags2();
+
+    auto barrier = vk::ImageMemoryBarrier2(vk::PipelineStageFlagBits2::eColorAttachmentOutput, vk::AccessFlagBits2::eColorAttachmentWrite, dstStage, dstAccess,
+        vk::ImageLayout::eColorAttachmentOptimal, getFinalLayout(), VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, target.image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+
+    vk::DependencyInfo dependency = {};
+    dependency.setImageMemoryBarriers(barrier);
+    cmds.pipelineBarrier2(dependency);
+}
+
+vk::ImageLayout RenderPass::getInitialLayout()
+{
+    return type == RenderPassType::Incremental ? vk::ImageLayout::ePresentSrcKHR : vk::ImageLayout::eUndefined;
+}
+
+vk::ImageLayout RenderPass::getFinalLayout()
+{
+    return type == RenderPassType::Offscreen ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::ePresentSrcKHR;
+}
+
+vk::RenderPassBeginInfo RenderPass::getBeginInfo(vk::Framebuffer framebuffer)
 {
     vk::RenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.renderPass = handle;
     renderPassInfo.framebuffer = framebuffer;
-    renderPassInfo.renderArea.offset = vk::Offset2D { 0, 0 };
-    renderPassInfo.renderArea.extent = renderer->swapChain->extent;
+    renderPassInfo.renderArea = renderer->getRenderArea();
+
+    clearValues[0] = type == RenderPassType::Offscreen ? vk::ClearValue(array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f }) : renderer->clearColor;
+    clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
 
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &renderer->clearColor;
+    renderPassInfo.clearValueCount = renderer->depthFormat != vk::Format::eUndefined ? 2 : 1;
+    renderPassInfo.pClearValues = clearValues.data();
     return renderPassInfo;
 }
@@ -1,6 +1,16 @@
 #include "Renderer.hpp"
 #include "Model.hpp"
 #include "DynamicModel.hpp"
+#include "InstanceBuffer.hpp"
+#include "StagingBuffer.hpp"
+#include "Font.hpp"
+#include "Texture.hpp"
+#include "PerformanceHud.hpp"
+#include "FrameCapture.hpp"
+
+#include <chrono>
+#include <functional>
+#include <sstream>
 
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
@@ -17,21 +27,38 @@ std::vector<uint32_t> rectangleIndices = {
     0, 1, 2, 2, 3, 0
 };
 
-std::vector<BasicVertex> triangleVertices = {
-    {0.0f, -1.25f},
-    {1.25f, 1.25f},
-    {0.0f, 1.25f}
-};
+// Shapes flushed later in a frame get a slightly nearer depth, so opaque shapes can be
+// drawn in any order without changing the result
+constexpr float SHAPE_DEPTH_STEP = 1.0f / (1 << 22);
 
-std::vector<uint32_t> triangleIndices = {
-    0, 1, 2
-};
+// Cached path strokes unused for this many frames get dropped
+constexpr uint64_t STROKE_CACHE_FRAMES = 120;
+
+// Instances built per job in drawInstances
+constexpr size_t INSTANCE_CHUNK = 8192;
 
-Renderer::Renderer(string title, GLFWwindow* window) : instance({}), device({}), physicalDevice({}), graphicsQueue({}), presentQueue({}), surface({}), window(window), commandPool({})
+Renderer::Renderer(string title, GLFWwindow* window, RendererSettings settings) : settings(settings), textureLayout({}), instance({}), device({}), physicalDevice({}), graphicsQueue({}), presentQueue({}), surface({}), window(window), commandPool({}), bindlessLayout({}), bindlessPool({}), bindlessSet({}), overdrawQueries({}), timestampQueries({})
 {
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
 
+    // Logs and records the time since the last stage finished
+    auto stageStart = chrono::high_resolution_clock::now();
+    auto stage = [&](string name)
+    {
+        auto now = chrono::high_resolution_clock::now();
+        double ms = chrono::duration<double, milli>(now - stageStart).count();
+        stageStart = now;
+
+        startupTimings.push_back({ name, ms });
+
+        stringstream msg;
+        msg << name << " (" << ms << " ms)";
+        log(msg.str());
+    };
+
+    jobs = make_shared<JobSystem>();
+
     // Init
     log("Initializing Vulkan");
 
@@ -51,6 +78,7 @@ Renderer::Renderer(string title, GLFWwindow* window) : instance({}), device({}),
         throw std::runtime_error("failed to create window surface!");
     }
     surface = vki::SurfaceKHR(instance, rawSurface);
+    stage("Created instance");
 
     // Pick device
     auto devices = instance.enumeratePhysicalDevices();
@@ -106,36 +134,206 @@ Renderer::Renderer(string title, GLFWwindow* window) : instance({}), device({}),
         queueCreateInfos.pop_back();
     }
 
+    // Enable the optional features we use when they are there
+    auto supported = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features>();
+    auto& supportedFeatures = supported.get<vk::PhysicalDeviceFeatures2>().features;
+    auto& supportedFeatures12 = supported.get<vk::PhysicalDeviceVulkan12Features>();
+    auto& supportedFeatures13 = supported.get<vk::PhysicalDeviceVulkan13Features>();
+
+    enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+    enabledFeatures12.drawIndirectCount = supportedFeatures12.drawIndirectCount;
+    enabledFeatures13.synchronization2 = supportedFeatures13.synchronization2;
+
+    // Its layout transitions are synchronization2 barriers
+    if (settings.dynamicRendering)
+    {
+        if (!supportedFeatures13.dynamicRendering || !supportedFeatures13.synchronization2)
+        {
+            log("Dynamic rendering isn't supported, using render passes");
+            this->settings.dynamicRendering = false;
+        }
+
+        enabledFeatures13.dynamicRendering = this->settings.dynamicRendering;
+    }
+
+    bindlessSupported = supportedFeatures12.descriptorIndexing && supportedFeatures12.runtimeDescriptorArray && supportedFeatures12.descriptorBindingPartiallyBound && supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind && supportedFeatures12.shaderSampledImageArrayNonUniformIndexing;
+
+    if (bindlessSupported)
+    {
+        enabledFeatures12.descriptorIndexing = true;
+        enabledFeatures12.runtimeDescriptorArray = true;
+        enabledFeatures12.descriptorBindingPartiallyBound = true;
+        enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind = true;
+        enabledFeatures12.shaderSampledImageArrayNonUniformIndexing = true;
+
+        auto props = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+        maxBindlessTextures = std::min(4096u, props.get<vk::PhysicalDeviceVulkan12Properties>().maxDescriptorSetUpdateAfterBindSampledImages);
+    }
+
+    if (settings.measureOverdraw)
+    {
+        if (!supportedFeatures.pipelineStatisticsQuery)
+        {
+            log("Pipeline statistics queries aren't supported, overdraw won't be measured");
+            this->settings.measureOverdraw = false;
+        }
+
+        enabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    }
+
+    if (settings.damageTracking)
+    {
+        for (const auto& i : physicalDevice.enumerateDeviceExtensionProperties())
+        {
+            if (string(i.extensionName.data()) == VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME)
+            {
+                incrementalPresentSupported = true;
+                deviceExtensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+            }
+        }
+    }
+
+    for (const auto& i : physicalDevice.enumerateDeviceExtensionProperties())
+    {
+        if (string(i.extensionName.data()) == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)
+        {
+            memoryBudgetSupported = true;
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+    }
+
+    vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features> devFeatures = { { enabledFeatures }, enabledFeatures12, enabledFeatures13 };
+
     auto devInfo = vk::DeviceCreateInfo({}, static_cast<uint32_t>(queueCreateInfos.size()), queueCreateInfos.data());
-    auto devFeatures = vk::PhysicalDeviceFeatures();
-    devInfo.pEnabledFeatures = &devFeatures;
+    devInfo.pNext = &devFeatures.get<vk::PhysicalDeviceFeatures2>();
     devInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
     devInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
     device = physicalDevice.createDevice(devInfo);
     graphicsQueue = device.getQueue(indices.graphicsFamily.value(), 0);
     presentQueue = device.getQueue(indices.presentFamily.value(), 0);
+    stage("Created device");
+
+    memoryTracker = make_shared<MemoryTracker>(this);
+
+    // Caches the renderer owns. The current flight frame is done by the time these run.
+    memoryTracker->addEvictionCallback([this]()
+    {
+        // Only host memory, but cheap to make again
+        strokeCache.clear();
+        return vk::DeviceSize(0);
+    });
+
+    memoryTracker->addEvictionCallback([this]()
+    {
+        auto before = memoryTracker->getUsage(MemoryCategory::DynamicGeometry);
+
+        for (auto& i : dynamicModels)
+        {
+            if (!i.models.empty())
+            {
+                i.models[currentFlightFrame].clear();
+            }
+        }
+
+        return before - memoryTracker->getUsage(MemoryCategory::DynamicGeometry);
+    });
+
+    if (settings.depthBuffer)
+    {
+        depthFormat = findDepthFormat();
+    }
 
     // Make swapchain'
     swapChain = make_unique<SwapChain>(this);
-    log("Created swap chain");
+    stage("Created swap chain");
 
     // Do things
-    basicVertShader = make_shared<Shader>(this, "VulkanEngine/shaders/shader.vert.spv", vk::ShaderStageFlagBits::eVertex);
-    basicFragShader = make_shared<Shader>(this, "VulkanEngine/shaders/shader.frag.spv", vk::ShaderStageFlagBits::eFragment);
-    elipseVertShader = make_shared<Shader>(this, "VulkanEngine/shaders/elipse.vert.spv", vk::ShaderStageFlagBits::eVertex);
-    elipseFragShader = make_shared<Shader>(this, "VulkanEngine/shaders/elipse.frag.spv", vk::ShaderStageFlagBits::eFragment);
-    log("Compiled shaders");
+    shaders = make_shared<ShaderLibrary>(this);
+    shaders->build();
+
+    basicVertShader = shaders->get("shader.vert");
+    basicFragShader = shaders->get("shader.frag");
+    shapeVertShader = shaders->get("shape.vert");
+    shapeFragShader = shaders->get("shape.frag");
+    shapeCoreVertShader = shaders->get("shapecore.vert");
+    strokeVertShader = shaders->get("stroke.vert");
+    spriteVertShader = shaders->get("sprite.vert");
+    spriteFragShader = shaders->get("sprite.frag");
+    textVertShader = shaders->get("text.vert");
+    textFragShader = shaders->get("text.frag");
+    layerFragShader = shaders->get("layer.frag");
+    instancedVertShader = shaders->get("instanced.vert");
+    gpuSceneVertShader = shaders->get("gpuscene.vert");
+    cullShader = shaders->get("cull.comp");
+    stage("Created shaders");
 
     renderPass = make_shared<RenderPass>(this);
-    log("Created base render pass");
+    layerRenderPass = make_shared<RenderPass>(this, RenderPassType::Offscreen);
+
+    if (settings.damageTracking)
+    {
+        incrementalRenderPass = make_shared<RenderPass>(this, RenderPassType::Incremental);
+    }
+    stage("Created base render pass");
+
+    auto textureBinding = vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment);
+    textureLayout = device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo({}, 1, &textureBinding));
+
+    if (bindlessSupported)
+    {
+        // One set for every frame. Slots can be written while in use as long as the
+        // frames in flight don't read them.
+        auto bindlessBinding = vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, maxBindlessTextures, vk::ShaderStageFlagBits::eFragment);
+        vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind;
+
+        vk::StructureChain<vk::DescriptorSetLayoutCreateInfo, vk::DescriptorSetLayoutBindingFlagsCreateInfo> layoutInfo = {
+            vk::DescriptorSetLayoutCreateInfo(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, 1, &bindlessBinding),
+            vk::DescriptorSetLayoutBindingFlagsCreateInfo(1, &bindingFlags)
+        };
+        bindlessLayout = device.createDescriptorSetLayout(layoutInfo.get<vk::DescriptorSetLayoutCreateInfo>());
+
+        auto poolSize = vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, maxBindlessTextures);
+        bindlessPool = device.createDescriptorPool(vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind | vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, 1, 1, &poolSize));
+
+        vk::DescriptorSetLayout setLayout = bindlessLayout;
+        bindlessSet = std::move(vki::DescriptorSets(device, vk::DescriptorSetAllocateInfo(bindlessPool, 1, &setLayout)).front());
+
+        releasedBindlessSlots.resize(MAX_FRAMES_IN_FLIGHT);
+    }
+
+    // Pipelines only read renderer state and call into the device, so they can all be made at once
+    vector<function<void()>> pipelineJobs = {
+        [&]() { basicPipeline = make_shared<TypedPipeline<BasicUBO, BasicVertex>>(this, vector<shared_ptr<Shader>>{ basicVertShader, basicFragShader }); },
+        [&]() { shapePipeline = make_shared<TypedPipeline<BasicUBO, BasicVertex, ShapeInstance>>(this, vector<shared_ptr<Shader>>{ shapeVertShader, shapeFragShader }, PipelineSettings{ .alphaBlending = true, .cullMode = vk::CullModeFlagBits::eNone, .depthTest = true }); },
+        [&]() { shapeCorePipeline = make_shared<TypedPipeline<BasicUBO, BasicVertex, ShapeInstance>>(this, vector<shared_ptr<Shader>>{ shapeCoreVertShader, basicFragShader }, PipelineSettings{ .cullMode = vk::CullModeFlagBits::eNone, .depthTest = true, .depthWrite = true }); },
+        [&]() { instancedPipeline = make_shared<TypedPipeline<BasicUBO, BasicVertex, Instance2D>>(this, vector<shared_ptr<Shader>>{ instancedVertShader, basicFragShader }, PipelineSettings{ .cullMode = vk::CullModeFlagBits::eNone }); },
+        [&]() { gpuScenePipeline = make_shared<TypedPipeline<BasicUBO, BasicVertex, GPUObject>>(this, vector<shared_ptr<Shader>>{ gpuSceneVertShader, basicFragShader }); },
+        [&]() { strokePipeline = make_shared<TypedPipeline<BasicUBO, ColorVertex>>(this, vector<shared_ptr<Shader>>{ strokeVertShader, basicFragShader }, PipelineSettings{ .alphaBlending = true, .cullMode = vk::CullModeFlagBits::eNone }); },
+        [&]() { textPipeline = make_shared<TypedPipeline<BasicUBO, BasicVertex, GlyphInstance>>(this, vector<shared_ptr<Shader>>{ textVertShader, textFragShader }, PipelineSettings{ .alphaBlending = true, .cullMode = vk::CullModeFlagBits::eNone, .extraSetLayouts = { textureLayout } }); },
+        [&]() { layerPipeline = make_shared<TypedPipeline<BasicUBO, BasicVertex, GlyphInstance>>(this, vector<shared_ptr<Shader>>{ textVertShader, layerFragShader }, PipelineSettings{ .alphaBlending = true, .premultipliedAlpha = true, .cullMode = vk::CullModeFlagBits::eNone, .extraSetLayouts = { textureLayout } }); },
+        [&]() { cullPipeline = make_shared<ComputePipeline>(this, cullShader, vector<vk::DescriptorType>(4, vk::DescriptorType::eStorageBuffer), sizeof(vec4) + sizeof(uint32_t)); }
+    };
+
+    if (bindlessSupported)
+    {
+        pipelineJobs.push_back([&]() { spritePipeline = make_shared<TypedPipeline<BasicUBO, BasicVertex, SpriteInstance>>(this, vector<shared_ptr<Shader>>{ spriteVertShader, spriteFragShader }, PipelineSettings{ .alphaBlending = true, .cullMode = vk::CullModeFlagBits::eNone, .extraSetLayouts = { bindlessLayout } }); });
+    }
 
-    basicPipeline = make_shared<Pipeline>(this, vector<shared_ptr<Shader>>{ basicVertShader, basicFragShader }, BasicVertex::getVertexDefinition(), sizeof(BasicUBO));
-    elipsePipeline = make_shared<Pipeline>(this, vector<shared_ptr<Shader>>{ elipseVertShader, elipseFragShader }, BasicVertex::getVertexDefinition(), sizeof(BasicUBO));
-    log("Created render pipelines");
+    jobs->parallelFor(pipelineJobs.size(), [&](size_t i) { pipelineJobs[i](); });
+    stage("Created render pipelines");
 
-    swapChain->populateFramebuffers(renderPass);
-    log("Created framebuffers");
+    if (!enabledFeatures13.dynamicRendering)
+    {
+        swapChain->populateFramebuffers(renderPass);
+        stage("Created framebuffers");
+    }
+
+    if (settings.damageTracking)
+    {
+        damage = make_unique<DamageTracker>(swapChain->extent, swapChain->getImageCount());
+    }
 
     // Setup commands
     vk::CommandPoolCreateInfo poolInfo = {vk::CommandPoolCreateFlagBits::eResetCommandBuffer};
@@ -151,11 +349,15 @@ Renderer::Renderer(string title, GLFWwindow* window) : instance({}), device({}),
     }
 
     // Make models
-    dynamicModels.resize(MAX_FRAMES_IN_FLIGHT);
-
     rectangle = make_shared<Model<BasicVertex>>(this, rectangleVertices, rectangleIndices);
-    triangle = make_shared<Model<BasicVertex>>(this, triangleVertices, triangleIndices);
-    log("Created typical models");
+    shapeInstances = make_shared<InstanceBuffer<ShapeInstance>>(this);
+    transformInstances = make_shared<InstanceBuffer<Instance2D>>(this);
+    glyphInstances = make_shared<InstanceBuffer<GlyphInstance>>(this);
+    spriteInstances = make_shared<InstanceBuffer<SpriteInstance>>(this);
+    strokeVertices = make_shared<InstanceBuffer<ColorVertex>>(this, 4096);
+    strokeIndices = make_shared<InstanceBuffer<uint32_t>>(this, 8192, vk::BufferUsageFlagBits::eIndexBuffer);
+    staging = make_shared<StagingBuffer>(this);
+    stage("Created typical models");
 
     // More commands
     vk::CommandBufferAllocateInfo allocInfo = {};
@@ -166,13 +368,18 @@ Renderer::Renderer(string title, GLFWwindow* window) : instance({}), device({}),
     try
     {
         commandBuffers = device.allocateCommandBuffers(allocInfo);
+        prePassCommandBuffers = device.allocateCommandBuffers(allocInfo);
+        graphCommandBuffers = device.allocateCommandBuffers(allocInfo);
+        layerCommandBuffers = device.allocateCommandBuffers(allocInfo);
     }
     catch (vk::SystemError err)
     {
         throw std::runtime_error("Error allocating command buffers");
     }
 
-    log("Created command buffers");
+    drawnLayers.resize(MAX_FRAMES_IN_FLIGHT);
+    graph = make_shared<RenderGraph>(this);
+    stage("Created command buffers");
 
     try
     {
@@ -188,11 +395,34 @@ Renderer::Renderer(string title, GLFWwindow* window) : instance({}), device({}),
         throw std::runtime_error("Error creating sync objects");
     }
 
-    log("Created syncronization objects");
+    stage("Created syncronization objects");
+
+    if (this->settings.measureOverdraw)
+    {
+        auto queryInfo = vk::QueryPoolCreateInfo({}, vk::QueryType::ePipelineStatistics, MAX_FRAMES_IN_FLIGHT, vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations);
+        overdrawQueries = device.createQueryPool(queryInfo);
+        overdrawQueried.resize(MAX_FRAMES_IN_FLIGHT, false);
+        stage("Created overdraw queries");
+    }
+
+    auto graphicsFamily = findQueueFamilies(physicalDevice).graphicsFamily.value();
+    timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+    timestampsSupported = physicalDevice.getQueueFamilyProperties()[graphicsFamily].timestampValidBits > 0 && timestampPeriod > 0;
+
+    if (timestampsSupported)
+    {
+        timestampQueries = device.createQueryPool(vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, MAX_FRAMES_IN_FLIGHT * 2));
+        timestampsQueried.resize(MAX_FRAMES_IN_FLIGHT, false);
+        stage("Created timestamp queries");
+    }
 }
 
 void Renderer::beginFrame()
 {
+    auto now = chrono::steady_clock::now();
+    auto frameTime = frameCount > 0 ? chrono::duration<float, milli>(now - frameStart).count() : 0.0f;
+    frameStart = now;
+
     auto fence = *inFlightFences[currentFlightFrame];
     if (device.waitForFences(vk::ArrayProxy<vk::Fence>(1, &fence), true, numeric_limits<uint64_t>::max()) != vk::Result::eSuccess)
     {
@@ -216,20 +446,224 @@ void Renderer::beginFrame()
 
     device.resetFences(vk::ArrayProxy<vk::Fence>(1, &fence));
     commandBuffers[currentFlightFrame].reset();
+    prePassCommandBuffers[currentFlightFrame].reset();
+    graphCommandBuffers[currentFlightFrame].reset();
+    layerCommandBuffers[currentFlightFrame].reset();
+
+    // The fence means this frame is done sampling them
+    drawnLayers[currentFlightFrame].clear();
+
+    memoryTracker->update();
+
+    // The fence means this frame's last query is done
+    uint64_t fragmentInvocations = stats.fragmentInvocations;
+    if (settings.measureOverdraw && overdrawQueried[currentFlightFrame])
+    {
+        auto res = overdrawQueries.getResult<uint64_t>(currentFlightFrame, 1, sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (res.first == vk::Result::eSuccess)
+        {
+            fragmentInvocations = res.second;
+        }
+    }
+
+    if (settings.measureOverdraw)
+    {
+        overdrawQueried[currentFlightFrame] = false;
+    }
+
+    float gpuTime = stats.gpuTime;
+    if (timestampsSupported && timestampsQueried[currentFlightFrame])
+    {
+        auto res = timestampQueries.getResults<uint64_t>(currentFlightFrame * 2, 2, 2 * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+        if (res.first == vk::Result::eSuccess)
+        {
+            gpuTime = (res.second[1] - res.second[0]) * timestampPeriod / 1000000.0f;
+        }
+
+        timestampsQueried[currentFlightFrame] = false;
+    }
+
+    recordStart = chrono::steady_clock::now();
+
+    prePassCommandBuffers[currentFlightFrame].begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
+    if (settings.measureOverdraw)
+    {
+        prePassCommandBuffers[currentFlightFrame].resetQueryPool(overdrawQueries, currentFlightFrame, 1);
+    }
+
+    if (timestampsSupported)
+    {
+        prePassCommandBuffers[currentFlightFrame].resetQueryPool(timestampQueries, currentFlightFrame * 2, 2);
+        prePassCommandBuffers[currentFlightFrame].writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueries, currentFlightFrame * 2);
+    }
+
+    graphCommandBuffers[currentFlightFrame].begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    layerCommandBuffers[currentFlightFrame].begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
     commandBuffers[currentFlightFrame].begin({vk::CommandBufferUsageFlagBits::eSimultaneousUse});
-    commandBuffers[currentFlightFrame].beginRenderPass(renderPass->getBeginInfo(swapChain->framebuffers[currentFrameImageIndex]), vk::SubpassContents::eInline);
+
+    framePassBegun = false;
+    frameArea = vk::Rect2D({ 0, 0 }, swapChain->extent);
+
+    if (!damage)
+    {
+        beginFramePass(frameArea);
+    }
 
     basicPipeline->beginFrame();
-    elipsePipeline->beginFrame();
+    shapePipeline->beginFrame();
+    shapeCorePipeline->beginFrame();
+    instancedPipeline->beginFrame();
+    gpuScenePipeline->beginFrame();
+    textPipeline->beginFrame();
+    layerPipeline->beginFrame();
+    strokePipeline->beginFrame();
+
+    if (bindlessSupported)
+    {
+        spritePipeline->beginFrame();
+
+        // This frame's fence has been waited on, and the other frame was recorded after these were released
+        auto& released = releasedBindlessSlots[currentFlightFrame];
+        for (auto i : released)
+        {
+            bindlessTextures[i] = nullptr;
+            freeBindlessSlots.push_back(i);
+        }
+        released.clear();
+    }
+
+    shapeInstances->beginFrame();
+    transformInstances->beginFrame();
+    glyphInstances->beginFrame();
+    spriteInstances->beginFrame();
+    strokeVertices->beginFrame();
+    strokeIndices->beginFrame();
+    staging->beginFrame();
+    queuedRuns.clear();
+    queuedShapes.clear();
+    queuedSprites.clear();
+    queuedFonts.clear();
+    queuedStrokeVertices.clear();
+    queuedStrokeIndices.clear();
+
+    if (frameCount % STROKE_CACHE_FRAMES == 0)
+    {
+        erase_if(strokeCache, [this](const auto& i) { return i.second.lastUsed + STROKE_CACHE_FRAMES < frameCount; });
+    }
+    shapeDepthCounter = 0;
+
+    for (auto& i : dynamicModels)
+    {
+        i.usedThisFrame = 0;
+    }
+
+    {
+        lock_guard guard(drawContextsLock);
+        drawContextView = getViewBounds();
+
+        for (auto& i : drawContexts)
+        {
+            if (auto context = i.lock())
+            {
+                context->view = drawContextView;
+            }
+        }
+    }
+
+    auto allocations = memoryTracker->getAllocationCount();
 
-    dynamicModelsThisFrame = 0;
+    lastStats = stats;
+    stats = {};
+    stats.fragmentInvocations = fragmentInvocations;
+    stats.overdraw = static_cast<float>(fragmentInvocations) / (swapChain->extent.width * swapChain->extent.height);
+    stats.frameTime = frameTime;
+    stats.cpuTime = lastCpuTime;
+    stats.gpuTime = gpuTime;
+    // Made during the last frame, since this one hasn't started yet
+    stats.allocations = static_cast<uint32_t>(allocations - lastAllocations);
+    lastAllocations = allocations;
+
+    if (capture)
+    {
+        capture->beginFrame();
+    }
 }
 
 void Renderer::endFrame()
 {
-    commandBuffers[currentFlightFrame].endRenderPass();
+    if (currentLayer)
+    {
+        throw std::runtime_error("Layer wasn't ended before the end of the frame");
+    }
+
+    flushDrawContexts();
+
+    // Queued like everything else, so damage tracking sees it, and queued last so it's
+    // drawn over the app's draws and the draw contexts'
+    if (hud)
+    {
+        hud->draw();
+    }
+
+    if (capture)
+    {
+        capture->endFrame();
+
+        if (capture->isDone())
+        {
+            capture = nullptr;
+        }
+    }
+
+    // Nothing has been drawn yet, so the pass only has to cover what changed
+    bool tracked = damage && !framePassBegun;
+    if (tracked)
+    {
+        trackQueuedDraws();
+
+        auto area = damage->getDamage(currentFrameImageIndex);
+        if (area.extent.width > 0)
+        {
+            beginFramePass(area);
+        }
+    }
+
+    if (framePassBegun)
+    {
+        flush();
+
+        if (settings.measureOverdraw)
+        {
+            commandBuffers[currentFlightFrame].endQuery(overdrawQueries, currentFlightFrame);
+        }
+
+        framePass->end(commandBuffers[currentFlightFrame], swapChain->getTarget(currentFrameImageIndex));
+        stats.redrawn = static_cast<float>(frameArea.extent.width * frameArea.extent.height) / (swapChain->extent.width * swapChain->extent.height);
+    }
+    else
+    {
+        // The image already holds this frame
+        discardQueued();
+        stats.redrawn = 0;
+    }
+
+    framePassBegun = false;
+    graph->execute(graphCommandBuffers[currentFlightFrame]);
+
+    // The main command buffer is submitted last, so this is the end of the frame
+    if (timestampsSupported)
+    {
+        commandBuffers[currentFlightFrame].writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueries, currentFlightFrame * 2 + 1);
+        timestampsQueried[currentFlightFrame] = true;
+    }
+
+    lastCpuTime = chrono::duration<float, milli>(chrono::steady_clock::now() - recordStart).count();
+
     commandBuffers[currentFlightFrame].end();
+    layerCommandBuffers[currentFlightFrame].end();
+    graphCommandBuffers[currentFlightFrame].end();
+    prePassCommandBuffers[currentFlightFrame].end();
 
     auto fence = *inFlightFences[currentFlightFrame];
 
@@ -241,10 +675,11 @@ void Renderer::endFrame()
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
-    submitInfo.commandBufferCount = 1;
-
-    auto buf = *commandBuffers[currentFlightFrame];
-    submitInfo.pCommandBuffers = &buf;
+    // Pre-pass work goes first so everything after can depend on it, then the render graph,
+    // then layers so the frame can sample them
+    vk::CommandBuffer bufs[] = { prePassCommandBuffers[currentFlightFrame], graphCommandBuffers[currentFlightFrame], layerCommandBuffers[currentFlightFrame], commandBuffers[currentFlightFrame] };
+    submitInfo.commandBufferCount = 4;
+    submitInfo.pCommandBuffers = bufs;
 
     vk::Semaphore signalSemaphores[] = { renderFinishedSemaphores[currentFlightFrame] };
     submitInfo.signalSemaphoreCount = 1;
@@ -269,6 +704,38 @@ void Renderer::endFrame()
     presentInfo.pImageIndices = &currentFrameImageIndex;
     presentInfo.pResults = nullptr;
 
+    vk::RectLayerKHR changedRect;
+    vk::PresentRegionKHR changedRegion;
+    vk::PresentRegionsKHR changedRegions;
+
+    if (damage)
+    {
+        if (incrementalPresentSupported)
+        {
+            auto changed = tracked ? damage->getChanged() : vk::Rect2D({ 0, 0 }, swapChain->extent);
+
+            // No rectangles would mean all of it changed
+            if (changed.extent.width == 0)
+            {
+                changed.extent = vk::Extent2D(1, 1);
+            }
+
+            changedRect = vk::RectLayerKHR(changed.offset, changed.extent, 0);
+            changedRegion = vk::PresentRegionKHR(1, &changedRect);
+            changedRegions = vk::PresentRegionsKHR(1, &changedRegion);
+            presentInfo.pNext = &changedRegions;
+        }
+
+        if (tracked)
+        {
+            damage->finishFrame(currentFrameImageIndex);
+        }
+        else
+        {
+            damage->invalidate(currentFrameImageIndex);
+        }
+    }
+
     vk::Result resultPresent;
     try
     {
@@ -290,6 +757,7 @@ void Renderer::endFrame()
     }
 
     currentFlightFrame = (currentFlightFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    frameCount++;
 }
 
 void Renderer::log(string txt)
@@ -305,7 +773,7 @@ void Renderer::stop()
     device.waitIdle();
 }
 
-void Renderer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Buffer& buffer, vki::DeviceMemory& bufferMemory)
+void Renderer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Buffer& buffer, TrackedMemory& bufferMemory, MemoryCategory category)
 {
     auto bufferInfo = vk::BufferCreateInfo({}, size, usage);
 
@@ -318,15 +786,9 @@ void Renderer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk:
         throw std::runtime_error("Error creating buffer");
     }
 
-    vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
-
-    vk::MemoryAllocateInfo allocInfo = {};
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
     try
     {
-        bufferMemory = device.allocateMemory(allocInfo);
+        bufferMemory = memoryTracker->allocate(buffer.getMemoryRequirements(), properties, category);
     }
     catch (vk::SystemError err)
     {
@@ -338,17 +800,25 @@ void Renderer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk:
 
 void Renderer::copyBuffer(vki::Buffer& src, vki::Buffer& dest, vk::DeviceSize size)
 {
-    auto allocInfo = vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1);
-    auto cmdBuffs = device.allocateCommandBuffers(allocInfo);
+    auto cmds = beginSingleTimeCommands();
+    cmds.copyBuffer(src, dest, vk::BufferCopy(0, 0, size));
+    endSingleTimeCommands(cmds);
+}
 
-    auto beginInfo = vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-    cmdBuffs[0].begin(beginInfo);
+vki::CommandBuffer Renderer::beginSingleTimeCommands()
+{
+    auto allocInfo = vk::CommandBufferAllocateInfo(commandPool, vk::CommandBufferLevel::ePrimary, 1);
+    auto cmds = std::move(device.allocateCommandBuffers(allocInfo).front());
 
-    cmdBuffs[0].copyBuffer(src, dest, vk::BufferCopy(0, 0, size));
+    cmds.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    return cmds;
+}
 
-    cmdBuffs[0].end();
+void Renderer::endSingleTimeCommands(vki::CommandBuffer& cmds)
+{
+    cmds.end();
 
-    vk::CommandBuffer tempBuf = cmdBuffs[0];
+    vk::CommandBuffer tempBuf = cmds;
     vk::SubmitInfo submitInfo = {};
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &tempBuf;
@@ -357,6 +827,63 @@ void Renderer::copyBuffer(vki::Buffer& src, vki::Buffer& dest, vk::DeviceSize si
     graphicsQueue.waitIdle();
 }
 
+void Renderer::createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties, vki::Image& image, TrackedMemory& imageMemory, MemoryCategory category)
+{
+    vk::ImageCreateInfo imageInfo = {};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.extent = vk::Extent3D(width, height, 1);
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    imageInfo.usage = usage;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+
+    try
+    {
+        image = device.createImage(imageInfo);
+    }
+    catch (vk::SystemError err)
+    {
+        throw std::runtime_error("Error creating image");
+    }
+
+    try
+    {
+        imageMemory = memoryTracker->allocate(image.getMemoryRequirements(), properties, category);
+    }
+    catch (vk::SystemError err)
+    {
+        throw std::runtime_error("Error allocating image memory");
+    }
+
+    image.bindMemory(imageMemory, 0);
+}
+
+vki::ImageView Renderer::createImageView(vki::Image& image, vk::Format format, vk::ImageAspectFlags aspect)
+{
+    vk::ImageViewCreateInfo info = {};
+    info.image = image;
+    info.viewType = vk::ImageViewType::e2D;
+    info.format = format;
+    info.subresourceRange.aspectMask = aspect;
+    info.subresourceRange.baseMipLevel = 0;
+    info.subresourceRange.levelCount = 1;
+    info.subresourceRange.baseArrayLayer = 0;
+    info.subresourceRange.layerCount = 1;
+
+    try
+    {
+        return device.createImageView(info);
+    }
+    catch (vk::SystemError err)
+    {
+        throw std::runtime_error("Error creating image view");
+    }
+}
+
 uint32_t Renderer::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
 {
     vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
@@ -372,6 +899,27 @@ uint32_t Renderer::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags p
     throw std::runtime_error("Could not find GPU memory type");
 }
 
+vki::CommandBuffer& Renderer::getCommandBuffer()
+{
+    if (currentLayer)
+    {
+        return layerCommandBuffers[currentFlightFrame];
+    }
+
+    // Drawn right away, so damage tracking can't tell what changed
+    if (!framePassBegun)
+    {
+        beginFramePass(vk::Rect2D({ 0, 0 }, swapChain->extent));
+    }
+
+    return commandBuffers[currentFlightFrame];
+}
+
+vki::CommandBuffer& Renderer::getPrePassCommandBuffer()
+{
+    return prePassCommandBuffers[currentFlightFrame];
+}
+
 QueueFamilyIndices Renderer::findQueueFamilies(vki::PhysicalDevice device)
 {
     QueueFamilyIndices indices;
@@ -402,6 +950,20 @@ QueueFamilyIndices Renderer::findQueueFamilies(vki::PhysicalDevice device)
     return indices;
 }
 
+vk::Format Renderer::findDepthFormat()
+{
+    for (auto format : { vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint })
+    {
+        auto props = physicalDevice.getFormatProperties(format);
+        if (props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+        {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("No supported depth format");
+}
+
 void Renderer::recreateSwapChain()
 {
     int width = 0, height = 0;
@@ -415,7 +977,16 @@ void Renderer::recreateSwapChain()
 
     swapChain.reset(nullptr);
     swapChain = make_unique<SwapChain>(this);
-    swapChain->populateFramebuffers(renderPass);
+
+    if (!enabledFeatures13.dynamicRendering)
+    {
+        swapChain->populateFramebuffers(renderPass);
+    }
+
+    if (damage)
+    {
+        damage = make_unique<DamageTracker>(swapChain->extent, swapChain->getImageCount());
+    }
 }
 
 void Renderer::framebufferResizeCallback(GLFWwindow* window, int width, int height)
@@ -424,35 +995,849 @@ void Renderer::framebufferResizeCallback(GLFWwindow* window, int width, int heig
     app->framebufferResized = true;
 }
 
-void Renderer::drawRectangle(int x, int y, int width, int height, float rotation, vec4 color)
+void Renderer::drawRectangle(int x, int y, int width, int height, float rotation, vec4 color, float layer)
 {
-    drawModel(rectangle, basicPipeline, getNewUBO(x, y, width, height, rotation, color));
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0, 0), rotation, ShapeType::Rectangle, color, vec2(0, 0), layer });
 }
 
-void Renderer::drawElipse(int x, int y, int width, int height, float rotation, vec4 color)
+void Renderer::drawElipse(int x, int y, int width, int height, float rotation, vec4 color, float layer)
 {
-    drawModel(triangle, elipsePipeline, getNewUBO(x, y, width, height, rotation, color));
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0.5f, 0.5f), rotation, ShapeType::Elipse, color, vec2(0, 0), layer });
 }
 
-void Renderer::drawPolygon(vector<BasicVertex>& points, int x, int y, int width, int height, float rotation, vec4 color)
+void Renderer::drawRoundedRectangle(int x, int y, int width, int height, float radius, float rotation, vec4 color, float layer)
 {
-    drawModel(triangulateModel(points), basicPipeline, getNewUBO(x, y, width, height, rotation, color));
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0, 0), rotation, ShapeType::RoundedRectangle, color, vec2(radius, 0), layer });
 }
 
-void Renderer::drawModelTemplateless(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, void* ubo)
+void Renderer::drawRing(int x, int y, int width, int height, float thickness, float rotation, vec4 color, float layer)
 {
-    pipeline->bind(commandBuffers[currentFlightFrame]);
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0.5f, 0.5f), rotation, ShapeType::Ring, color, vec2(0, thickness), layer });
+}
 
-    auto uniforms = pipeline->getUniformSet();
-    uniforms->setUBO(ubo);
-    uniforms->bind(commandBuffers[currentFlightFrame]);
+void Renderer::drawOutline(int x, int y, int width, int height, float thickness, float radius, float rotation, vec4 color, float layer)
+{
+    drawShape({ vec2(x, y), vec2(width, height), vec2(0, 0), rotation, ShapeType::Outline, color, vec2(radius, thickness), layer });
+}
+
+void Renderer::drawShape(const ShapeInstance& shape)
+{
+    if (capture && capture->isRecording())
+    {
+        capture->shape(shape);
+    }
+
+    if (!shape.isVisible(getViewBounds()))
+    {
+        stats.shapesCulled++;
+        return;
+    }
+
+    queuedShapes.push_back(shape);
+    queueRun(QueuedKind::Shapes, queuedShapes.size());
+}
+
+void Renderer::flushShapes(size_t from, size_t to)
+{
+    if (from == to)
+    {
+        return;
+    }
+
+    auto& cmds = getCommandBuffer();
+    auto ubo = getNewUBO();
+
+    auto runStart = queuedShapes.begin() + from;
+    auto runEnd = queuedShapes.begin() + to;
+
+    // Stable, so shapes on the same layer stay in the order they were drawn
+    stable_sort(runStart, runEnd, [](const ShapeInstance& a, const ShapeInstance& b) { return a.layer < b.layer; });
+
+    for (auto i = runStart; i != runEnd; i++)
+    {
+        i->depth = 1.0f - std::min(++shapeDepthCounter, (1u << 22) - 1) * SHAPE_DEPTH_STEP;
+    }
+
+    if (depthFormat != vk::Format::eUndefined)
+    {
+        // Solid interiors first, front to back, so everything behind them fails the depth test
+        opaqueShapes.clear();
+        for (auto i = make_reverse_iterator(runEnd); i != make_reverse_iterator(runStart); i++)
+        {
+            if (i->color.a >= 1.0f && (i->type == ShapeType::Rectangle || i->type == ShapeType::RoundedRectangle || i->type == ShapeType::Elipse))
+            {
+                opaqueShapes.push_back(*i);
+            }
+        }
+
+        if (!opaqueShapes.empty())
+        {
+            shapeCorePipeline->bind(cmds);
+
+            auto uniforms = shapeCorePipeline->getUniformSet(ubo);
+            uniforms->bind(cmds);
+
+            auto first = shapeInstances->push(cmds, 1, opaqueShapes.data(), opaqueShapes.size());
+            rectangle->drawInstanced(cmds, static_cast<uint32_t>(opaqueShapes.size()), first);
+            stats.opaqueShapes += static_cast<uint32_t>(opaqueShapes.size());
+        }
+    }
+
+    // Then everything back to front with blending. Interiors already drawn fail the
+    // depth test, which leaves the antialiased edges and translucent shapes.
+    shapePipeline->bind(cmds);
+
+    auto uniforms = shapePipeline->getUniformSet(ubo);
+    uniforms->bind(cmds);
+
+    auto first = shapeInstances->push(cmds, 1, queuedShapes.data() + from, to - from);
+    rectangle->drawInstanced(cmds, static_cast<uint32_t>(to - from), first);
+    stats.shapesDrawn += static_cast<uint32_t>(to - from);
+}
+
+void Renderer::drawPolyline(const vector<vec2>& points, const StrokeStyle& style, vec4 color, bool closed)
+{
+    if (capture && capture->isRecording())
+    {
+        capture->stroke(points, style, color, closed);
+    }
+
+    strokeScratch.clear();
+    strokeScratchIndices.clear();
+    strokePolyline(points.data(), points.size(), closed, style, strokeScratch, strokeScratchIndices);
+    queueStroke(strokeScratch, strokeScratchIndices, color);
+}
+
+void Renderer::drawPath(const Path& path, const StrokeStyle& style, vec4 color)
+{
+    if (capture && capture->isRecording())
+    {
+        capture->path(path, style, color);
+    }
+
+    auto& cached = strokeCache[path.getId()];
+
+    if (cached.positions.empty() || cached.version != path.getVersion() || cached.style != style)
+    {
+        cached.version = path.getVersion();
+        cached.style = style;
+        cached.positions.clear();
+        cached.indices.clear();
+        strokePath(path, style, cached.positions, cached.indices);
+
+        vec2 lo = vec2(numeric_limits<float>::max());
+        vec2 hi = vec2(numeric_limits<float>::lowest());
+
+        for (auto& i : cached.positions)
+        {
+            lo = glm::min(lo, i);
+            hi = glm::max(hi, i);
+        }
+
+        cached.bounds = vec4(lo, hi);
+    }
+
+    cached.lastUsed = frameCount;
+
+    auto view = getViewBounds();
+    if (cached.bounds.z < view.x || cached.bounds.w < view.y || cached.bounds.x > view.z || cached.bounds.y > view.w)
+    {
+        return;
+    }
+
+    queueStroke(cached.positions, cached.indices, color);
+}
+
+void Renderer::queueStroke(const vector<vec2>& positions, const vector<uint32_t>& indices, vec4 color)
+{
+    auto base = static_cast<uint32_t>(queuedStrokeVertices.size());
+
+    for (auto& i : positions)
+    {
+        queuedStrokeVertices.push_back({ i, color });
+    }
+
+    for (auto i : indices)
+    {
+        queuedStrokeIndices.push_back(base + i);
+    }
+
+    queueRun(QueuedKind::Strokes, queuedStrokeIndices.size());
+}
+
+void Renderer::flushStrokes(size_t from, size_t to, uint32_t firstVertex, uint32_t firstIndex)
+{
+    if (from == to)
+    {
+        return;
+    }
+
+    auto& cmds = getCommandBuffer();
+
+    strokePipeline->bind(cmds);
+
+    auto uniforms = strokePipeline->getUniformSet(getNewUBO());
+    uniforms->bind(cmds);
+
+    cmds.bindVertexBuffers(0, { strokeVertices->getBuffer() }, { 0 });
+    cmds.bindIndexBuffer(strokeIndices->getBuffer(), 0, vk::IndexType::eUint32);
+    cmds.drawIndexed(static_cast<uint32_t>(to - from), 1, firstIndex + static_cast<uint32_t>(from), static_cast<int32_t>(firstVertex), 0);
+    countDraw();
+
+    stats.strokeTriangles += static_cast<uint32_t>((to - from) / 3);
+}
+
+Sprite Renderer::registerTexture(shared_ptr<Texture> texture)
+{
+    if (!bindlessSupported)
+    {
+        throw std::runtime_error("Sprites need descriptor indexing support");
+    }
+
+    uint32_t index;
+    if (!freeBindlessSlots.empty())
+    {
+        index = freeBindlessSlots.back();
+        freeBindlessSlots.pop_back();
+        bindlessTextures[index] = texture;
+    }
+    else
+    {
+        if (bindlessTextures.size() >= maxBindlessTextures)
+        {
+            throw std::runtime_error("Out of bindless texture slots");
+        }
+
+        index = static_cast<uint32_t>(bindlessTextures.size());
+        bindlessTextures.push_back(texture);
+    }
+
+    auto imageInfo = vk::DescriptorImageInfo(texture->sampler, texture->view, vk::ImageLayout::eShaderReadOnlyOptimal);
+    auto write = vk::WriteDescriptorSet(bindlessSet, 0, index, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo);
+    device.updateDescriptorSets({ write }, {});
+
+    if (capture && capture->isRecording())
+    {
+        capture->texture(index, texture);
+    }
+
+    return { index, vec4(0, 1, 1, 0), ivec2(texture->width, texture->height) };
+}
+
+void Renderer::unregisterTexture(uint32_t index)
+{
+    releasedBindlessSlots[currentFlightFrame].push_back(index);
+}
+
+void Renderer::drawSprite(const Sprite& sprite, int x, int y, int width, int height, float rotation, vec4 color)
+{
+    drawSprite({ vec2(x, y), vec2(width, height), vec2(0, 0), rotation, sprite.texture, sprite.uv, color });
+}
+
+void Renderer::drawSprite(const SpriteInstance& sprite)
+{
+    if (!bindlessSupported)
+    {
+        throw std::runtime_error("Sprites need descriptor indexing support");
+    }
+
+    if (capture && capture->isRecording())
+    {
+        capture->sprite(sprite);
+    }
+
+    if (!sprite.isVisible(getViewBounds()))
+    {
+        return;
+    }
+
+    queuedSprites.push_back(sprite);
+    queueRun(QueuedKind::Sprites, queuedSprites.size());
+}
+
+void Renderer::flushSprites(size_t from, size_t to)
+{
+    if (from == to)
+    {
+        return;
+    }
+
+    auto& cmds = getCommandBuffer();
+
+    spritePipeline->bind(cmds);
+
+    auto uniforms = spritePipeline->getUniformSet(getNewUBO());
+    uniforms->bind(cmds);
+
+    cmds.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, spritePipeline->layout, 1, { *bindlessSet }, {});
+
+    auto first = spriteInstances->push(cmds, 1, queuedSprites.data() + from, to - from);
+    rectangle->drawInstanced(cmds, static_cast<uint32_t>(to - from), first);
+    stats.spritesDrawn += static_cast<uint32_t>(to - from);
+}
+
+void Renderer::drawText(shared_ptr<Font> font, const string& text, int x, int y, vec4 color, float scale)
+{
+    if (capture && capture->isRecording())
+    {
+        capture->text(font, text, x, y, color, scale);
+    }
+
+    auto& run = font->getRun(text);
+    auto bounds = vec4(x, y, x, y) + run.bounds * scale;
+    auto view = getViewBounds();
+
+    if (run.glyphs.empty() || bounds.z < view.x || bounds.w < view.y || bounds.x > view.z || bounds.y > view.w)
+    {
+        return;
+    }
+
+    auto index = queueRun(QueuedKind::Text, 0);
+
+    for (auto& i : run.glyphs)
+    {
+        auto& page = font->pages[i.page];
+        page.queued.push_back({ vec2(x, y) + i.offset * scale, i.size * scale, i.uv, color });
+
+        auto end = static_cast<uint32_t>(page.queued.size());
+        if (page.runs.empty() || page.runs.back().first != index)
+        {
+            page.runs.emplace_back(index, end);
+        }
+        else
+        {
+            page.runs.back().second = end;
+        }
+    }
+
+    if (find(queuedFonts.begin(), queuedFonts.end(), font) == queuedFonts.end())
+    {
+        queuedFonts.push_back(font);
+    }
+}
+
+void Renderer::flushText(uint32_t run)
+{
+    auto& cmds = getCommandBuffer();
+
+    textPipeline->bind(cmds);
+
+    auto uniforms = textPipeline->getUniformSet(getNewUBO());
+    uniforms->bind(cmds);
+
+    for (auto& font : queuedFonts)
+    {
+        // New glyphs go up in the pre-pass, before this frame's draws
+        font->upload();
+
+        for (auto& page : font->pages)
+        {
+            // Runs are flushed in order, so this run is the page's next one if it has glyphs
+            if (page.flushedRuns == page.runs.size() || page.runs[page.flushedRuns].first != run)
+            {
+                continue;
+            }
+
+            auto from = page.flushedRuns > 0 ? page.runs[page.flushedRuns - 1].second : 0;
+            auto count = page.runs[page.flushedRuns].second - from;
+            page.flushedRuns++;
+
+            page.texture->bind(cmds, *textPipeline);
+
+            auto first = glyphInstances->push(cmds, 1, page.queued.data() + from, count);
+            rectangle->drawInstanced(cmds, count, first);
+
+            stats.glyphsDrawn += count;
+            stats.textDraws++;
+        }
+    }
+}
+
+uint32_t Renderer::queueRun(QueuedKind kind, size_t end)
+{
+    if (queuedRuns.empty() || queuedRuns.back().kind != kind)
+    {
+        queuedRuns.push_back({ kind, end });
+    }
+    else
+    {
+        queuedRuns.back().end = end;
+    }
+
+    return static_cast<uint32_t>(queuedRuns.size() - 1);
+}
+
+void Renderer::flush()
+{
+    size_t shapes = 0;
+    size_t sprites = 0;
+    size_t strokes = 0;
+
+    uint32_t firstStrokeVertex = 0;
+    uint32_t firstStrokeIndex = 0;
+
+    // Stroke indices point anywhere in the queued vertices, so all of them go up at once
+    if (!queuedStrokeIndices.empty())
+    {
+        firstStrokeVertex = strokeVertices->write(queuedStrokeVertices.data(), queuedStrokeVertices.size());
+        firstStrokeIndex = strokeIndices->write(queuedStrokeIndices.data(), queuedStrokeIndices.size());
+    }
+
+    for (uint32_t i = 0; i < queuedRuns.size(); i++)
+    {
+        auto& run = queuedRuns[i];
+
+        switch (run.kind)
+        {
+        case QueuedKind::Shapes:
+            flushShapes(shapes, run.end);
+            shapes = run.end;
+            break;
+        case QueuedKind::Strokes:
+            flushStrokes(strokes, run.end, firstStrokeVertex, firstStrokeIndex);
+            strokes = run.end;
+            break;
+        case QueuedKind::Sprites:
+            flushSprites(sprites, run.end);
+            sprites = run.end;
+            break;
+        case QueuedKind::Text:
+            flushText(i);
+            break;
+        }
+    }
+
+    discardQueued();
+}
+
+void Renderer::beginFramePass(vk::Rect2D area)
+{
+    auto& cmds = commandBuffers[currentFlightFrame];
+
+    frameArea = area;
+    framePassBegun = true;
+
+    // Anything less than the whole image keeps the rest from when it was last presented
+    bool full = area.offset == vk::Offset2D(0, 0) && area.extent == swapChain->extent;
+    auto& pass = full ? renderPass : incrementalRenderPass;
+    framePass = pass;
+    pass->begin(cmds, swapChain->getTarget(currentFrameImageIndex));
+
+    if (settings.measureOverdraw)
+    {
+        cmds.beginQuery(overdrawQueries, currentFlightFrame, {});
+        overdrawQueried[currentFlightFrame] = true;
+    }
+}
+
+void Renderer::trackQueuedDraws()
+{
+    // Moving the camera or changing the clear color changes everything
+    auto clear = clearColor.color.float32;
+    damage->beginFrame(DamageTracker::hashValues(cameraPosition, clear[0], clear[1], clear[2], clear[3]));
+
+    auto camera = vec4(cameraPosition, cameraPosition);
+
+    for (const auto& i : queuedShapes)
+    {
+        damage->add(i.getBounds() - camera, DamageTracker::hashValues(i.pos, i.size, i.origin, i.rotation, i.type, i.color, i.params, i.layer));
+    }
+
+    for (size_t i = 0; i + 2 < queuedStrokeIndices.size(); i += 3)
+    {
+        auto& a = queuedStrokeVertices[queuedStrokeIndices[i]];
+        auto& b = queuedStrokeVertices[queuedStrokeIndices[i + 1]];
+        auto& c = queuedStrokeVertices[queuedStrokeIndices[i + 2]];
+
+        // Plus a pixel for rasterization
+        auto bounds = vec4(glm::min(glm::min(a.pos, b.pos), c.pos) - 1.0f, glm::max(glm::max(a.pos, b.pos), c.pos) + 1.0f);
+        damage->add(bounds - camera, DamageTracker::hashValues(a.pos, a.color, b.pos, b.color, c.pos, c.color));
+    }
+
+    for (const auto& i : queuedSprites)
+    {
+        damage->add(i.getBounds() - camera + vec4(-1, -1, 1, 1), DamageTracker::hashValues(i.pos, i.size, i.origin, i.rotation, i.texture, i.uv, i.color));
+    }
+
+    for (const auto& font : queuedFonts)
+    {
+        auto fontId = reinterpret_cast<uintptr_t>(font.get());
+
+        for (size_t page = 0; page < font->pages.size(); page++)
+        {
+            for (const auto& i : font->pages[page].queued)
+            {
+                damage->add(vec4(i.pos - 1.0f, i.pos + i.size + 1.0f) - camera, DamageTracker::hashValues(i.pos, i.size, i.uv, i.color, fontId, page));
+            }
+        }
+    }
+}
+
+void Renderer::discardQueued()
+{
+    queuedRuns.clear();
+    queuedShapes.clear();
+    queuedSprites.clear();
+    queuedStrokeVertices.clear();
+    queuedStrokeIndices.clear();
+
+    for (auto& font : queuedFonts)
+    {
+        for (auto& page : font->pages)
+        {
+            page.queued.clear();
+            page.runs.clear();
+            page.flushedRuns = 0;
+        }
+    }
+
+    queuedFonts.clear();
+}
+
+void Renderer::addDamage(int x, int y, int width, int height)
+{
+    if (damage)
+    {
+        damage->invalidate(vec4(x - cameraPosition.x, y - cameraPosition.y, x + width - cameraPosition.x, y + height - cameraPosition.y));
+    }
+}
+
+void Renderer::beginLayer(shared_ptr<RenderLayer> layer)
+{
+    if (currentLayer)
+    {
+        throw std::runtime_error("Layers can't be nested");
+    }
+
+    if (capture && capture->isRecording())
+    {
+        capture->beginLayer(layer);
+    }
+
+    // What's queued so far belongs to the frame
+    flush();
+
+    // Evicted to save memory
+    if (!layer->texture)
+    {
+        layer->allocate();
+    }
+
+    layer->lastUsed = frameCount;
+
+    currentLayer = layer;
+    layerSavedCamera = cameraPosition;
+    layerSavedDepthCounter = shapeDepthCounter;
+
+    cameraPosition = layer->position;
+    shapeDepthCounter = 0;
+
+    layerRenderPass->begin(layerCommandBuffers[currentFlightFrame], layer->getTarget());
+}
+
+void Renderer::endLayer()
+{
+    if (!currentLayer)
+    {
+        throw std::runtime_error("No layer to end");
+    }
+
+    if (capture && capture->isRecording())
+    {
+        capture->endLayer();
+    }
+
+    flush();
+
+    layerRenderPass->end(layerCommandBuffers[currentFlightFrame], currentLayer->getTarget());
+
+    currentLayer->valid = true;
+    drawnLayers[currentFlightFrame].push_back(currentLayer);
+    stats.layersRedrawn++;
+
+    currentLayer = nullptr;
+    cameraPosition = layerSavedCamera;
+    shapeDepthCounter = layerSavedDepthCounter;
+}
+
+void Renderer::drawLayer(shared_ptr<RenderLayer> layer, vec4 color)
+{
+    if (!layer->isValid())
+    {
+        throw std::runtime_error("Layer has to be drawn before it can be composited");
+    }
+
+    if (capture && capture->isRecording())
+    {
+        capture->drawLayer(layer, color);
+    }
+
+    auto size = vec2(layer->getSize());
+    auto view = getViewBounds();
+
+    if (layer->position.x + size.x < view.x || layer->position.y + size.y < view.y || layer->position.x > view.z || layer->position.y > view.w)
+    {
+        return;
+    }
+
+    // Keep draws before this underneath it
+    flush();
+
+    auto& cmds = getCommandBuffer();
+
+    layerPipeline->bind(cmds);
+
+    auto uniforms = layerPipeline->getUniformSet(getNewUBO());
+    uniforms->bind(cmds);
+
+    layer->texture->bind(cmds, *layerPipeline);
+
+    // The layer was drawn with the same projection, so its first row is at position.y
+    GlyphInstance quad = { layer->position, size, vec4(0, 0, 1, 1), color };
+    auto first = glyphInstances->push(cmds, 1, &quad, 1);
+    rectangle->drawInstanced(cmds, 1, first);
+
+    drawnLayers[currentFlightFrame].push_back(layer);
+    layer->lastUsed = frameCount;
+    stats.layersDrawn++;
+}
+
+shared_ptr<DrawContext> Renderer::createDrawContext()
+{
+    auto context = make_shared<DrawContext>(this);
+
+    lock_guard guard(drawContextsLock);
+    context->view = drawContextView;
+    drawContexts.push_back(context);
+    return context;
+}
+
+void Renderer::flushDrawContexts()
+{
+    lock_guard guard(drawContextsLock);
+    erase_if(drawContexts, [](const auto& i) { return i.expired(); });
+
+    for (auto& i : drawContexts)
+    {
+        auto context = i.lock();
+        if (!context)
+        {
+            continue;
+        }
+
+        DrawContext::Mark done;
+
+        for (auto& draw : context->models)
+        {
+            queueFromContext(*context, done, draw.queued);
+            done = draw.queued;
+
+            if (capture)
+            {
+                captureModelDraw(*draw.model, *draw.pipeline, context->ubos.data() + draw.uboOffset);
+            }
+
+            auto uniforms = beginModelDraw(*draw.pipeline);
+            uniforms->setUBO(context->ubos.data() + draw.uboOffset);
+            uniforms->bind(getCommandBuffer());
+
+            draw.model->draw(getCommandBuffer());
+        }
+
+        queueFromContext(*context, done, context->getMark());
+
+        stats.shapesCulled += context->shapesCulled;
+        context->clear();
+    }
+}
+
+void Renderer::queueFromContext(DrawContext& context, const DrawContext::Mark& from, const DrawContext::Mark& to)
+{
+    if (capture && capture->isRecording())
+    {
+        // Already culled and tessellated by the context, so recorded as they are
+        for (size_t i = from.shapes; i < to.shapes; i++)
+        {
+            capture->shape(context.shapes[i]);
+        }
+
+        for (size_t i = from.sprites; i < to.sprites; i++)
+        {
+            capture->sprite(context.sprites[i]);
+        }
+
+        if (to.strokeIndices > from.strokeIndices)
+        {
+            vector<uint32_t> indices;
+            for (size_t i = from.strokeIndices; i < to.strokeIndices; i++)
+            {
+                indices.push_back(context.strokeIndices[i] - static_cast<uint32_t>(from.strokeVertices));
+            }
+
+            capture->strokeMesh(context.strokeVertices.data() + from.strokeVertices, to.strokeVertices - from.strokeVertices, indices.data(), indices.size());
+        }
+    }
+
+    if (to.shapes > from.shapes)
+    {
+        queuedShapes.insert(queuedShapes.end(), context.shapes.begin() + from.shapes, context.shapes.begin() + to.shapes);
+        queueRun(QueuedKind::Shapes, queuedShapes.size());
+    }
+
+    if (to.sprites > from.sprites)
+    {
+        queuedSprites.insert(queuedSprites.end(), context.sprites.begin() + from.sprites, context.sprites.begin() + to.sprites);
+        queueRun(QueuedKind::Sprites, queuedSprites.size());
+    }
+
+    // Strokes only index their own vertices, so they just need moving to where the
+    // vertices end up
+    auto base = static_cast<uint32_t>(queuedStrokeVertices.size()) - static_cast<uint32_t>(from.strokeVertices);
+    queuedStrokeVertices.insert(queuedStrokeVertices.end(), context.strokeVertices.begin() + from.strokeVertices, context.strokeVertices.begin() + to.strokeVertices);
+
+    for (size_t i = from.strokeIndices; i < to.strokeIndices; i++)
+    {
+        queuedStrokeIndices.push_back(base + context.strokeIndices[i]);
+    }
+
+    if (to.strokeIndices > from.strokeIndices)
+    {
+        queueRun(QueuedKind::Strokes, queuedStrokeIndices.size());
+    }
+}
+
+void Renderer::drawPolygon(vector<BasicVertex>& points, int x, int y, int width, int height, float rotation, vec4 color)
+{
+    if (capture && capture->isRecording())
+    {
+        capture->polygon(points, nullptr, x, y, width, height, rotation, color);
+    }
+
+    drawModel(triangulateModel(points), basicPipeline, getNewUBO(x, y, width, height, rotation, color));
+}
+
+void Renderer::drawPolygon(const vector<BasicVertex>& points, const vector<vector<BasicVertex>>& holes, int x, int y, int width, int height, float rotation, vec4 color)
+{
+    if (capture && capture->isRecording())
+    {
+        capture->polygon(points, &holes, x, y, width, height, rotation, color);
+    }
+
+    drawModel(triangulateModel(points, holes), basicPipeline, getNewUBO(x, y, width, height, rotation, color));
+}
+
+void Renderer::drawInstances(shared_ptr<BaseModel> model, const TransformBatch& batch, shared_ptr<Pipeline> pipeline)
+{
+    if (batch.size() == 0)
+    {
+        return;
+    }
+
+    flush();
+
+    if (!pipeline)
+    {
+        pipeline = instancedPipeline;
+    }
+
+    if (capture && capture->isRecording())
+    {
+        capture->instances(*model, batch);
+    }
+
+    auto& cmds = getCommandBuffer();
+
+    pipeline->bind(cmds);
+
+    auto uniforms = pipeline->getUniformSet();
+    auto ubo = getNewUBO();
+    uniforms->setUBO(ubo);
+    uniforms->bind(cmds);
+
+    // Written straight into the mapped instance buffer, split between the job threads
+    // when there's enough to be worth it
+    Instance2D* instances;
+    auto first = transformInstances->allocate(cmds, 1, batch.size(), &instances);
+
+    auto chunks = (batch.size() + INSTANCE_CHUNK - 1) / INSTANCE_CHUNK;
+    jobs->parallelFor(chunks, [&](size_t i)
+    {
+        auto start = i * INSTANCE_CHUNK;
+        auto count = std::min(INSTANCE_CHUNK, batch.size() - start);
+        buildInstances(batch.x.data() + start, batch.y.data() + start, batch.width.data() + start, batch.height.data() + start, batch.rotation.data() + start, batch.color.data() + start, count, instances + start);
+    });
+
+    model->drawInstanced(cmds, static_cast<uint32_t>(batch.size()), first);
+}
+
+void Renderer::drawRectangles(const TransformBatch& batch)
+{
+    drawInstances(rectangle, batch);
+}
+
+void Renderer::drawModelTemplateless(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline, void* ubo)
+{
+    if (capture)
+    {
+        captureModelDraw(*model, *pipeline, ubo);
+    }
+
+    auto uniforms = beginModelDraw(*pipeline);
+    uniforms->setUBO(ubo);
+    uniforms->bind(getCommandBuffer());
+
+    model->draw(getCommandBuffer());
+}
+
+void Renderer::captureModelDraw(BaseModel& model, Pipeline& pipeline, const void* ubo)
+{
+    // The basic pipeline only draws polygons, which are captured with their outline
+    if (capture->isRecording() && &pipeline != basicPipeline.get())
+    {
+        capture->modelDraw(model, ubo, pipeline.getUBOSize());
+    }
+}
+
+shared_ptr<UniformSet> Renderer::beginModelDraw(Pipeline& pipeline)
+{
+    // Keep shapes and text drawn before this in order
+    flush();
+
+    pipeline.bind(getCommandBuffer());
+    return pipeline.getUniformSet();
+}
+
+vec4 Renderer::getViewBounds()
+{
+    auto extent = getRenderExtent();
+    return vec4(cameraPosition, cameraPosition + vec2(extent.width, extent.height));
+}
+
+vk::Rect2D Renderer::getRenderArea()
+{
+    if (currentLayer)
+    {
+        return vk::Rect2D({ 0, 0 }, getRenderExtent());
+    }
+
+    return frameArea;
+}
+
+vk::Extent2D Renderer::getRenderExtent()
+{
+    if (currentLayer)
+    {
+        auto size = currentLayer->getSize();
+        return { size.x, size.y };
+    }
 
-    model->draw(commandBuffers[currentFlightFrame]);
+    return swapChain->extent;
 }
 
 BasicUBO Renderer::getNewUBO()
 {
-    return {mat4(1), lookAt(vec3(0.0f, 0.0f, 1.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f)), ortho(0.0f, (float)swapChain->extent.width, 0.0f, (float)swapChain->extent.height, -1000.0f, 1000.0f)};
+    auto extent = getRenderExtent();
+    return {mat4(1), lookAt(vec3(cameraPosition, 1.0f), vec3(cameraPosition, 0.0f), vec3(0.0f, 1.0f, 0.0f)), ortho(0.0f, (float)extent.width, 0.0f, (float)extent.height, -1000.0f, 1000.0f)};
 }
 
 BasicUBO Renderer::getNewUBO(int x, int y, int width, int height, float rotation, vec4 color)
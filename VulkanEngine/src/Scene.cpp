@@ -0,0 +1,443 @@
+#include "Scene.hpp"
+
+#include "Renderer.hpp"
+#include "BaseModel.hpp"
+#include "FrameCapture.hpp"
+
+// translate * rotate * scale as a 2D affine
+static mat3 affine2D(vec2 position, float rotation, vec2 scale)
+{
+    float c = cos(rotation);
+    float s = sin(rotation);
+    return mat3(vec3(c * scale.x, s * scale.x, 0), vec3(-s * scale.y, c * scale.y, 0), vec3(position, 1));
+}
+
+SceneNode::SceneNode(Scene* scene, SceneNode* parent) : scene(scene), parent(parent)
+{
+}
+
+void SceneNode::markDirty(bool transform)
+{
+    transformDirty = transformDirty || transform;
+    instanceDirty = true;
+
+    if (!queued)
+    {
+        queued = true;
+        scene->dirtyNodes.push_back(this);
+    }
+}
+
+void SceneNode::setPosition(vec2 position)
+{
+    this->position = position;
+    markDirty(true);
+}
+
+void SceneNode::setRotation(float rotation)
+{
+    this->rotation = rotation;
+    markDirty(true);
+}
+
+void SceneNode::setScale(vec2 scale)
+{
+    this->scale = scale;
+    markDirty(true);
+}
+
+void SceneNode::setSize(vec2 size)
+{
+    this->size = size;
+    markDirty(false);
+}
+
+void SceneNode::setColor(vec4 color)
+{
+    this->color = color;
+    markDirty(false);
+}
+
+void SceneNode::setModel(shared_ptr<BaseModel> model, shared_ptr<Pipeline> pipeline)
+{
+    if (batch != nullptr)
+    {
+        scene->removeFromBatch(this);
+    }
+
+    this->model = model;
+    this->pipeline = pipeline ? pipeline : scene->renderer->instancedPipeline;
+
+    if (model)
+    {
+        scene->addToBatch(this);
+    }
+
+    markDirty(false);
+}
+
+void SceneBatch::markDirty(uint32_t slot)
+{
+    for (auto& i : frames)
+    {
+        if (i.dirtyBegin == i.dirtyEnd)
+        {
+            i.dirtyBegin = slot;
+            i.dirtyEnd = slot + 1;
+        }
+        else
+        {
+            i.dirtyBegin = std::min(i.dirtyBegin, slot);
+            i.dirtyEnd = std::max(i.dirtyEnd, slot + 1);
+        }
+    }
+}
+
+Scene::Scene(Renderer* renderer, float cellSize) : renderer(renderer), grid(cellSize)
+{
+}
+
+SceneNode* Scene::createNode(SceneNode* parent)
+{
+    nodes.push_back(make_unique<SceneNode>(this, parent));
+    auto node = nodes.back().get();
+
+    if (parent != nullptr)
+    {
+        parent->children.push_back(node);
+    }
+
+    node->markDirty(true);
+    return node;
+}
+
+SceneNode* Scene::createNode(shared_ptr<BaseModel> model, SceneNode* parent)
+{
+    auto node = createNode(parent);
+    node->setModel(model);
+    return node;
+}
+
+void Scene::destroyNode(SceneNode* node)
+{
+    auto children = node->children;
+    for (auto i : children)
+    {
+        destroyNode(i);
+    }
+
+    if (node->batch != nullptr)
+    {
+        removeFromBatch(node);
+    }
+
+    if (node->parent != nullptr)
+    {
+        erase(node->parent->children, node);
+    }
+
+    if (node->queued)
+    {
+        erase(dirtyNodes, node);
+    }
+
+    erase_if(nodes, [node](const unique_ptr<SceneNode>& i) { return i.get() == node; });
+}
+
+void Scene::update()
+{
+    if (dirtyNodes.empty())
+    {
+        return;
+    }
+
+    for (auto node : dirtyNodes)
+    {
+        if (!node->transformDirty)
+        {
+            continue;
+        }
+
+        // A dirty ancestor will redo this whole subtree anyway
+        bool ancestorDirty = false;
+        for (auto i = node->parent; i != nullptr; i = i->parent)
+        {
+            if (i->transformDirty)
+            {
+                ancestorDirty = true;
+                break;
+            }
+        }
+
+        if (!ancestorDirty)
+        {
+            updateTransform(node);
+        }
+    }
+
+    for (auto node : dirtyNodes)
+    {
+        if (node->instanceDirty)
+        {
+            writeInstance(node);
+        }
+
+        node->queued = false;
+    }
+
+    dirtyNodes.clear();
+}
+
+void Scene::updateTransform(SceneNode* node)
+{
+    auto local = affine2D(node->position, node->rotation, node->scale);
+    node->world = node->parent != nullptr ? node->parent->world * local : local;
+    node->transformDirty = false;
+
+    writeInstance(node);
+
+    for (auto i : node->children)
+    {
+        updateTransform(i);
+    }
+}
+
+void Scene::writeInstance(SceneNode* node)
+{
+    node->instanceDirty = false;
+
+    if (node->batch == nullptr)
+    {
+        updateBounds(node);
+        return;
+    }
+
+    Instance2D instance = {};
+    instance.basis = vec4(vec2(node->world[0]) * node->size.x, vec2(node->world[1]) * node->size.y);
+    instance.translation = vec2(node->world[2]);
+    instance.color = node->color;
+
+    node->batch->instances[node->slot] = instance;
+    node->batch->markDirty(node->slot);
+
+    updateBounds(node);
+}
+
+void Scene::updateBounds(SceneNode* node)
+{
+    bool indexed = node->batch != nullptr && node->model->hasBounds;
+
+    if (!indexed)
+    {
+        if (node->gridId != SpatialGrid<SceneNode*>::INVALID)
+        {
+            grid.remove(node->gridId);
+            node->gridId = SpatialGrid<SceneNode*>::INVALID;
+        }
+
+        return;
+    }
+
+    // Transform the corners of the model bounds
+    auto& instance = node->batch->instances[node->slot];
+    auto& b = node->model->bounds;
+
+    vec2 lo = vec2(numeric_limits<float>::max());
+    vec2 hi = vec2(numeric_limits<float>::lowest());
+
+    for (auto corner : { vec2(b.x, b.y), vec2(b.z, b.y), vec2(b.z, b.w), vec2(b.x, b.w) })
+    {
+        auto p = instance.translation + corner.x * vec2(instance.basis.x, instance.basis.y) + corner.y * vec2(instance.basis.z, instance.basis.w);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+
+    if (node->gridId == SpatialGrid<SceneNode*>::INVALID)
+    {
+        node->gridId = grid.insert(vec4(lo, hi), node);
+    }
+    else
+    {
+        grid.move(node->gridId, vec4(lo, hi));
+    }
+}
+
+void Scene::addToBatch(SceneNode* node)
+{
+    SceneBatch* batch = nullptr;
+
+    for (auto& i : batches)
+    {
+        if (i->model == node->model && i->pipeline == node->pipeline)
+        {
+            batch = i.get();
+            break;
+        }
+    }
+
+    if (batch == nullptr)
+    {
+        batches.push_back(make_unique<SceneBatch>());
+        batch = batches.back().get();
+        batch->model = node->model;
+        batch->pipeline = node->pipeline;
+        batch->frames.resize(renderer->MAX_FRAMES_IN_FLIGHT);
+    }
+
+    node->batch = batch;
+    node->slot = static_cast<uint32_t>(batch->instances.size());
+
+    batch->instances.push_back({});
+    batch->nodes.push_back(node);
+}
+
+void Scene::removeFromBatch(SceneNode* node)
+{
+    auto batch = node->batch;
+    auto last = static_cast<uint32_t>(batch->instances.size() - 1);
+
+    // Move the last instance into the hole
+    if (node->slot != last)
+    {
+        batch->instances[node->slot] = batch->instances[last];
+        batch->nodes[node->slot] = batch->nodes[last];
+        batch->nodes[node->slot]->slot = node->slot;
+        batch->markDirty(node->slot);
+    }
+
+    batch->instances.pop_back();
+    batch->nodes.pop_back();
+
+    node->batch = nullptr;
+    updateBounds(node);
+}
+
+void Scene::sync(SceneBatch& batch)
+{
+    auto& frame = batch.frames[renderer->currentFlightFrame];
+    auto count = batch.instances.size();
+
+    // This frame's fence has been waited on, so its old buffer is free to replace
+    if (count > frame.capacity)
+    {
+        if (frame.mapped != nullptr)
+        {
+            frame.memory.unmapMemory();
+        }
+
+        frame.capacity = std::max(count, frame.capacity * 2);
+        renderer->createBuffer(frame.capacity * sizeof(Instance2D), vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, frame.handle, frame.memory, MemoryCategory::DynamicGeometry);
+        frame.mapped = static_cast<Instance2D*>(frame.memory.mapMemory(0, frame.capacity * sizeof(Instance2D)));
+
+        frame.dirtyBegin = 0;
+        frame.dirtyEnd = static_cast<uint32_t>(count);
+    }
+
+    frame.dirtyEnd = std::min(frame.dirtyEnd, static_cast<uint32_t>(count));
+
+    if (frame.dirtyBegin < frame.dirtyEnd)
+    {
+        memcpy(frame.mapped + frame.dirtyBegin, batch.instances.data() + frame.dirtyBegin, (frame.dirtyEnd - frame.dirtyBegin) * sizeof(Instance2D));
+    }
+
+    frame.dirtyBegin = 0;
+    frame.dirtyEnd = 0;
+}
+
+void Scene::draw()
+{
+    update();
+
+    renderer->flush();
+
+    auto& cmds = renderer->getCommandBuffer();
+    auto ubo = renderer->getNewUBO();
+
+    visibleCount = 0;
+    culledCount = 0;
+
+    bool capturing = renderer->capture && renderer->capture->isRecording();
+    vector<Instance2D> captured;
+
+    if (enableCulling)
+    {
+        for (auto& batch : batches)
+        {
+            batch->visible.clear();
+        }
+
+        grid.query(renderer->getViewBounds(), [](SceneNode* node)
+        {
+            node->batch->visible.push_back(node->slot);
+        });
+    }
+
+    for (auto& batch : batches)
+    {
+        if (batch->instances.empty())
+        {
+            continue;
+        }
+
+        // Models without bounds can't be culled
+        bool culled = enableCulling && batch->model->hasBounds;
+        auto count = static_cast<uint32_t>(batch->instances.size());
+
+        if (culled && batch->visible.empty())
+        {
+            culledCount += count;
+            continue;
+        }
+
+        sync(*batch);
+
+        batch->pipeline->bind(cmds);
+
+        auto uniforms = batch->pipeline->getUniformSet();
+        uniforms->setUBO(ubo);
+        uniforms->bind(cmds);
+
+        cmds.bindVertexBuffers(1, { batch->frames[renderer->currentFlightFrame].handle }, { 0 });
+
+        if (!culled)
+        {
+            if (capturing)
+            {
+                renderer->capture->sceneInstances(*batch->model, batch->instances);
+            }
+
+            batch->model->drawInstanced(cmds, count, 0);
+            visibleCount += count;
+            continue;
+        }
+
+        // Instances stay in slot order on the GPU, so draw each run of visible slots
+        auto& visible = batch->visible;
+        sort(visible.begin(), visible.end());
+
+        // The capture doesn't keep the scene, just what it drew
+        if (capturing)
+        {
+            captured.clear();
+            for (auto i : visible)
+            {
+                captured.push_back(batch->instances[i]);
+            }
+
+            renderer->capture->sceneInstances(*batch->model, captured);
+        }
+
+        size_t start = 0;
+        for (size_t i = 1; i <= visible.size(); i++)
+        {
+            if (i == visible.size() || visible[i] != visible[i - 1] + 1)
+            {
+                batch->model->drawInstanced(cmds, static_cast<uint32_t>(i - start), visible[start]);
+                start = i;
+            }
+        }
+
+        visibleCount += static_cast<uint32_t>(visible.size());
+        culledCount += count - static_cast<uint32_t>(visible.size());
+    }
+}
@@ -8,6 +8,11 @@ Shader::Shader(Renderer* renderer, string filename, vk::ShaderStageFlagBits type
     handle = renderer->device.createShaderModule({ vk::ShaderModuleCreateFlags(), code.size(), reinterpret_cast<const uint32_t*>(code.data()) });
 }
 
+Shader::Shader(Renderer* renderer, span<const uint32_t> code, vk::ShaderStageFlagBits type) : handle({}), renderer(renderer), type(type)
+{
+    handle = renderer->device.createShaderModule({ vk::ShaderModuleCreateFlags(), code.size_bytes(), code.data() });
+}
+
 vk::PipelineShaderStageCreateInfo Shader::getStageInfo()
 {
     return vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(), type, handle, "main");
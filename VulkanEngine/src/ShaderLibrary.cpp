@@ -0,0 +1,67 @@
+#include "ShaderLibrary.hpp"
+
+#include "Renderer.hpp"
+
+// Generated by target_glsl_shaders
+#include "shader.vert.h"
+#include "shader.frag.h"
+#include "shape.vert.h"
+#include "shape.frag.h"
+#include "shapecore.vert.h"
+#include "stroke.vert.h"
+#include "sprite.vert.h"
+#include "sprite.frag.h"
+#include "text.vert.h"
+#include "text.frag.h"
+#include "layer.frag.h"
+#include "instanced.vert.h"
+#include "gpuscene.vert.h"
+#include "cull.comp.h"
+
+ShaderLibrary::ShaderLibrary(Renderer* renderer) : renderer(renderer)
+{
+    add("shader.vert", shader_vert_spv, vk::ShaderStageFlagBits::eVertex);
+    add("shader.frag", shader_frag_spv, vk::ShaderStageFlagBits::eFragment);
+    add("shape.vert", shape_vert_spv, vk::ShaderStageFlagBits::eVertex);
+    add("shape.frag", shape_frag_spv, vk::ShaderStageFlagBits::eFragment);
+    add("shapecore.vert", shapecore_vert_spv, vk::ShaderStageFlagBits::eVertex);
+    add("stroke.vert", stroke_vert_spv, vk::ShaderStageFlagBits::eVertex);
+    add("sprite.vert", sprite_vert_spv, vk::ShaderStageFlagBits::eVertex);
+    add("sprite.frag", sprite_frag_spv, vk::ShaderStageFlagBits::eFragment);
+    add("text.vert", text_vert_spv, vk::ShaderStageFlagBits::eVertex);
+    add("text.frag", text_frag_spv, vk::ShaderStageFlagBits::eFragment);
+    add("layer.frag", layer_frag_spv, vk::ShaderStageFlagBits::eFragment);
+    add("instanced.vert", instanced_vert_spv, vk::ShaderStageFlagBits::eVertex);
+    add("gpuscene.vert", gpuscene_vert_spv, vk::ShaderStageFlagBits::eVertex);
+    add("cull.comp", cull_comp_spv, vk::ShaderStageFlagBits::eCompute);
+}
+
+void ShaderLibrary::add(string name, span<const uint32_t> code, vk::ShaderStageFlagBits stage)
+{
+    entries.push_back({ name, code, stage, nullptr });
+}
+
+void ShaderLibrary::build()
+{
+    renderer->jobs->parallelFor(entries.size(), [this](size_t i)
+    {
+        auto& entry = entries[i];
+        if (!entry.shader)
+        {
+            entry.shader = make_shared<Shader>(renderer, entry.code, entry.stage);
+        }
+    });
+}
+
+shared_ptr<Shader> ShaderLibrary::get(const string& name)
+{
+    for (const auto& i : entries)
+    {
+        if (i.name == name && i.shader)
+        {
+            return i.shader;
+        }
+    }
+
+    throw std::runtime_error("Shader not built: " + name);
+}
@@ -0,0 +1,73 @@
+#include "SpriteAtlas.hpp"
+
+#include "Renderer.hpp"
+#include "Texture.hpp"
+
+#include <stb_image.h>
+
+// Edge pixels are repeated into the padding so filtering at the border stays clean
+constexpr int SPRITE_PADDING = 1;
+
+SpriteAtlas::SpriteAtlas(Renderer* renderer, uint32_t size) : packer(size, size), pixels(size * size * 4), size(size), renderer(renderer)
+{
+    texture = make_shared<Texture>(renderer, size, size, pixels.data());
+    textureIndex = renderer->registerTexture(texture).texture;
+}
+
+SpriteAtlas::~SpriteAtlas()
+{
+    renderer->unregisterTexture(textureIndex);
+}
+
+optional<Sprite> SpriteAtlas::add(const uint8_t* rgba, int width, int height)
+{
+    // Padding is copied from the edge pixels, so there have to be some
+    if (width <= 0 || height <= 0)
+    {
+        throw std::runtime_error("Sprite size must be positive, got " + to_string(width) + "x" + to_string(height));
+    }
+
+    auto pos = packer.pack(width + SPRITE_PADDING * 2, height + SPRITE_PADDING * 2);
+    if (!pos)
+    {
+        return nullopt;
+    }
+
+    for (int y = -SPRITE_PADDING; y < height + SPRITE_PADDING; y++)
+    {
+        auto srcY = std::clamp(y, 0, height - 1);
+
+        for (int x = -SPRITE_PADDING; x < width + SPRITE_PADDING; x++)
+        {
+            auto srcX = std::clamp(x, 0, width - 1);
+            auto dest = ((pos->y + SPRITE_PADDING + y) * size + pos->x + SPRITE_PADDING + x) * 4;
+            memcpy(pixels.data() + dest, rgba + (srcY * width + srcX) * 4, 4);
+        }
+    }
+
+    auto origin = *pos + SPRITE_PADDING;
+    auto atlasSize = vec2(size);
+
+    // Rows are stored top down, so the bottom of a quad samples the last row
+    return Sprite{ textureIndex, vec4(vec2(origin.x, origin.y + height) / atlasSize, vec2(origin.x + width, origin.y) / atlasSize), ivec2(width, height) };
+}
+
+optional<Sprite> SpriteAtlas::load(const string& path)
+{
+    int width, height, channels;
+    auto data = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+    if (data == nullptr)
+    {
+        throw std::runtime_error("Could not load image: " + path);
+    }
+
+    auto sprite = add(data, width, height);
+    stbi_image_free(data);
+    return sprite;
+}
+
+void SpriteAtlas::upload()
+{
+    texture->upload(pixels.data());
+}
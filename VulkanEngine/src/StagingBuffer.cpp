@@ -0,0 +1,57 @@
+#include "StagingBuffer.hpp"
+
+#include "Renderer.hpp"
+
+StagingBuffer::StagingBuffer(Renderer* renderer, vk::DeviceSize initialCapacity) : renderer(renderer)
+{
+    frames.resize(renderer->MAX_FRAMES_IN_FLIGHT);
+
+    for (auto& i : frames)
+    {
+        grow(i, initialCapacity);
+    }
+}
+
+void StagingBuffer::grow(FrameData& frame, vk::DeviceSize minCapacity)
+{
+    auto capacity = std::max(minCapacity, frame.capacity * 2);
+
+    if (frame.mapped != nullptr)
+    {
+        frame.memory.unmapMemory();
+        frame.retired.emplace_back(std::move(frame.handle), std::move(frame.memory));
+        frame.handle = { nullptr };
+        frame.memory = { nullptr };
+    }
+
+    renderer->createBuffer(capacity, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, frame.handle, frame.memory, MemoryCategory::Staging);
+    frame.mapped = static_cast<uint8_t*>(frame.memory.mapMemory(0, capacity));
+    frame.capacity = capacity;
+    frame.used = 0;
+}
+
+void StagingBuffer::beginFrame()
+{
+    auto& frame = frames[renderer->currentFlightFrame];
+    frame.used = 0;
+    frame.retired.clear();
+}
+
+void* StagingBuffer::allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::Buffer& buffer, vk::DeviceSize& offset)
+{
+    auto& frame = frames[renderer->currentFlightFrame];
+
+    auto start = (frame.used + alignment - 1) / alignment * alignment;
+    if (start + size > frame.capacity)
+    {
+        grow(frame, size);
+        start = 0;
+    }
+
+    frame.used = start + size;
+    renderer->stats.uploadBytes += size;
+
+    buffer = *frame.handle;
+    offset = start;
+    return frame.mapped + start;
+}
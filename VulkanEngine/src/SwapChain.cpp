@@ -2,7 +2,7 @@
 #include "Renderer.hpp"
 
 
-SwapChain::SwapChain(Renderer* renderer) : handle({}), renderer(renderer)
+SwapChain::SwapChain(Renderer* renderer) : handle({}), renderer(renderer), depthImage({}), depthMemory({}), depthView({})
 {
     // Init swap chain
     auto indices = renderer->findQueueFamilies(renderer->physicalDevice);
@@ -75,17 +75,23 @@ SwapChain::SwapChain(Renderer* renderer) : handle({}), renderer(renderer)
             throw std::runtime_error("failed to create image views!");
         }
     }
+
+    if (renderer->depthFormat != vk::Format::eUndefined)
+    {
+        renderer->createImage(extent.width, extent.height, renderer->depthFormat, vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::MemoryPropertyFlagBits::eDeviceLocal, depthImage, depthMemory, MemoryCategory::Attachments);
+        depthView = renderer->createImageView(depthImage, renderer->depthFormat, vk::ImageAspectFlagBits::eDepth);
+    }
 }
 
 void SwapChain::populateFramebuffers(shared_ptr<RenderPass> renderPass)
 {
     for (const auto& i : imageViews)
     {
-        vk::ImageView attachments[] = { i };
+        vk::ImageView attachments[] = { i, *depthView };
 
         vk::FramebufferCreateInfo framebufferInfo = {};
         framebufferInfo.renderPass = renderPass->handle;
-        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.attachmentCount = renderer->depthFormat != vk::Format::eUndefined ? 2 : 1;
         framebufferInfo.pAttachments = attachments;
         framebufferInfo.width = extent.width;
         framebufferInfo.height = extent.height;
@@ -102,6 +108,11 @@ void SwapChain::populateFramebuffers(shared_ptr<RenderPass> renderPass)
     }
 }
 
+RenderTarget SwapChain::getTarget(uint32_t index)
+{
+    return { images[index], *imageViews[index], *depthImage, *depthView, framebuffers.empty() ? vk::Framebuffer() : *framebuffers[index] };
+}
+
 SwapChainSupportDetails SwapChain::querySwapChainSupport(vki::PhysicalDevice device)
 {
     SwapChainSupportDetails details;
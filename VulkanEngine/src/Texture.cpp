@@ -0,0 +1,158 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "Texture.hpp"
+
+#include "Renderer.hpp"
+#include "Pipeline.hpp"
+#include "StagingBuffer.hpp"
+
+#include <stb_image.h>
+
+Texture::Texture(Renderer* renderer, uint32_t width, uint32_t height, vk::Format format, vk::ImageUsageFlags usage, MemoryCategory category) : renderer(renderer), width(width), height(height), format(format), descriptorPool({}), descriptorSet({}), image({}), memory({}), view({}), sampler({})
+{
+    renderer->createImage(width, height, format, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | usage, vk::MemoryPropertyFlagBits::eDeviceLocal, image, memory, category);
+    view = renderer->createImageView(image, format, vk::ImageAspectFlagBits::eColor);
+
+    vk::SamplerCreateInfo samplerInfo = {};
+    samplerInfo.magFilter = vk::Filter::eLinear;
+    samplerInfo.minFilter = vk::Filter::eLinear;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.maxLod = 0;
+
+    try
+    {
+        sampler = renderer->device.createSampler(samplerInfo);
+    }
+    catch (vk::SystemError err)
+    {
+        throw std::runtime_error("Error creating sampler");
+    }
+
+    auto poolSize = vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 1);
+    auto poolInfo = vk::DescriptorPoolCreateInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, 1, 1, &poolSize);
+    descriptorPool = renderer->device.createDescriptorPool(poolInfo);
+
+    vk::DescriptorSetLayout setLayout = renderer->textureLayout;
+    auto allocInfo = vk::DescriptorSetAllocateInfo(descriptorPool, 1, &setLayout);
+    descriptorSet = std::move(vki::DescriptorSets(renderer->device, allocInfo).front());
+
+    auto imageInfo = vk::DescriptorImageInfo(sampler, view, vk::ImageLayout::eShaderReadOnlyOptimal);
+    auto write = vk::WriteDescriptorSet(descriptorSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfo);
+    renderer->device.updateDescriptorSets({ write }, {});
+}
+
+Texture::Texture(Renderer* renderer, uint32_t width, uint32_t height, const void* pixels, vk::Format format) : Texture(renderer, width, height, format)
+{
+    upload(pixels);
+}
+
+shared_ptr<Texture> Texture::load(Renderer* renderer, const string& path)
+{
+    int width, height, channels;
+    auto pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+    if (pixels == nullptr)
+    {
+        throw std::runtime_error("Could not load image: " + path);
+    }
+
+    auto texture = make_shared<Texture>(renderer, static_cast<uint32_t>(width), static_cast<uint32_t>(height), pixels);
+    stbi_image_free(pixels);
+    return texture;
+}
+
+void Texture::upload(const void* pixels)
+{
+    auto size = static_cast<vk::DeviceSize>(width) * height * bytesPerPixel(format);
+
+    vki::Buffer stagingBuffer = { 0 };
+    TrackedMemory stagingMemory = { 0 };
+    renderer->createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer, stagingMemory, MemoryCategory::Staging);
+
+    void* ptr = stagingMemory.mapMemory(0, size);
+    memcpy(ptr, pixels, size);
+    stagingMemory.unmapMemory();
+
+    auto cmds = renderer->beginSingleTimeCommands();
+    auto range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+    // Everything gets replaced, so the old contents can go. Frames still sampling it finish first.
+    auto toTransfer = vk::ImageMemoryBarrier(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *image, range);
+    cmds.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toTransfer);
+
+    vk::BufferImageCopy region = {};
+    region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    region.imageExtent = vk::Extent3D(width, height, 1);
+    cmds.copyBufferToImage(*stagingBuffer, *image, vk::ImageLayout::eTransferDstOptimal, region);
+
+    auto toShader = vk::ImageMemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *image, range);
+    cmds.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, toShader);
+
+    renderer->endSingleTimeCommands(cmds);
+
+    layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+}
+
+void Texture::update(uvec2 offset, uvec2 size, const void* data, size_t rowPitch)
+{
+    if (size.x == 0 || size.y == 0)
+    {
+        return;
+    }
+
+    auto pixelSize = bytesPerPixel(format);
+    auto rowSize = size.x * pixelSize;
+
+    vk::Buffer staging;
+    vk::DeviceSize stagingOffset;
+    auto ptr = static_cast<uint8_t*>(renderer->staging->allocate(rowSize * size.y, std::max(pixelSize, 4u), staging, stagingOffset));
+
+    for (uint32_t y = 0; y < size.y; y++)
+    {
+        memcpy(ptr + y * rowSize, static_cast<const uint8_t*>(data) + y * rowPitch, rowSize);
+    }
+
+    auto& cmds = renderer->getPrePassCommandBuffer();
+    auto range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+    // Earlier frames may still be sampling the rest of the image
+    auto toTransfer = vk::ImageMemoryBarrier(vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferWrite, layout, vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *image, range);
+    cmds.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toTransfer);
+
+    vk::BufferImageCopy region = {};
+    region.bufferOffset = stagingOffset;
+    region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+    region.imageOffset = vk::Offset3D(static_cast<int32_t>(offset.x), static_cast<int32_t>(offset.y), 0);
+    region.imageExtent = vk::Extent3D(size.x, size.y, 1);
+    cmds.copyBufferToImage(staging, *image, vk::ImageLayout::eTransferDstOptimal, region);
+
+    auto toShader = vk::ImageMemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *image, range);
+    cmds.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, toShader);
+
+    layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+}
+
+void Texture::bind(vki::CommandBuffer& cmds, Pipeline& pipeline, uint32_t set)
+{
+    cmds.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline.layout, set, { *descriptorSet }, {});
+}
+
+uint32_t Texture::bytesPerPixel(vk::Format format)
+{
+    switch (format)
+    {
+    case vk::Format::eR8Unorm:
+        return 1;
+    case vk::Format::eR8G8Unorm:
+        return 2;
+    case vk::Format::eR8G8B8A8Unorm:
+    case vk::Format::eR8G8B8A8Srgb:
+    case vk::Format::eB8G8R8A8Unorm:
+    case vk::Format::eB8G8R8A8Srgb:
+        return 4;
+    default:
+        throw std::runtime_error("Unsupported texture format");
+    }
+}
@@ -0,0 +1,236 @@
+#include "TransformBatch.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_BATCH_SSE2
+#endif
+
+void TransformBatch::reserve(size_t count)
+{
+    x.reserve(count);
+    y.reserve(count);
+    width.reserve(count);
+    height.reserve(count);
+    rotation.reserve(count);
+    color.reserve(count);
+}
+
+void TransformBatch::clear()
+{
+    x.clear();
+    y.clear();
+    width.clear();
+    height.clear();
+    rotation.clear();
+    color.clear();
+}
+
+void TransformBatch::push(float x, float y, float width, float height, float rotation, vec4 color)
+{
+    this->x.push_back(x);
+    this->y.push_back(y);
+    this->width.push_back(width);
+    this->height.push_back(height);
+    this->rotation.push_back(rotation);
+    this->color.push_back(color);
+}
+
+void buildInstancesScalar(const float* x, const float* y, const float* width, const float* height, const float* rotation, const vec4* color, size_t count, Instance2D* out)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float c = std::cos(rotation[i]);
+        float s = std::sin(rotation[i]);
+
+        out[i].basis = vec4(c * width[i], s * width[i], -s * height[i], c * height[i]);
+        out[i].translation = vec2(x[i], y[i]);
+        out[i].padding = vec2(0, 0);
+        out[i].color = color[i];
+    }
+}
+
+#if defined(__AVX2__) || defined(TRANSFORM_BATCH_SSE2)
+
+// Cody-Waite split of pi / 2 and minimax polynomials on [-pi / 4, pi / 4], good to about 1e-7
+constexpr float TWO_OVER_PI = 0.636619772367581f;
+constexpr float HALF_PI_1 = 1.5703125f;
+constexpr float HALF_PI_2 = 4.837512969970703125e-4f;
+constexpr float HALF_PI_3 = 7.54978995489188216e-8f;
+
+constexpr float SIN_1 = -1.6666654611e-1f;
+constexpr float SIN_2 = 8.3321608736e-3f;
+constexpr float SIN_3 = -1.9515295891e-4f;
+
+constexpr float COS_1 = 4.166664568298827e-2f;
+constexpr float COS_2 = -1.388731625493765e-3f;
+constexpr float COS_3 = 2.443315711809948e-5f;
+
+// Writes 4 instances from transposed columns
+static inline void storeInstances(__m128 b0, __m128 b1, __m128 b2, __m128 b3, __m128 tx, __m128 ty, const vec4* color, Instance2D* out)
+{
+    _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+    auto zero = _mm_setzero_ps();
+    auto t01 = _mm_unpacklo_ps(tx, ty);
+    auto t23 = _mm_unpackhi_ps(tx, ty);
+
+    _mm_storeu_ps(&out[0].basis.x, b0);
+    _mm_storeu_ps(&out[1].basis.x, b1);
+    _mm_storeu_ps(&out[2].basis.x, b2);
+    _mm_storeu_ps(&out[3].basis.x, b3);
+
+    _mm_storeu_ps(&out[0].translation.x, _mm_movelh_ps(t01, zero));
+    _mm_storeu_ps(&out[1].translation.x, _mm_movehl_ps(zero, t01));
+    _mm_storeu_ps(&out[2].translation.x, _mm_movelh_ps(t23, zero));
+    _mm_storeu_ps(&out[3].translation.x, _mm_movehl_ps(zero, t23));
+
+    for (int i = 0; i < 4; i++)
+    {
+        out[i].color = color[i];
+    }
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+static inline void sinCos(__m256 x, __m256& sinOut, __m256& cosOut)
+{
+    // x = r + q * pi / 2
+    auto qi = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TWO_OVER_PI)));
+    auto q = _mm256_cvtepi32_ps(qi);
+
+    auto r = _mm256_sub_ps(x, _mm256_mul_ps(q, _mm256_set1_ps(HALF_PI_1)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(q, _mm256_set1_ps(HALF_PI_2)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(q, _mm256_set1_ps(HALF_PI_3)));
+
+    auto r2 = _mm256_mul_ps(r, r);
+
+    auto sinR = _mm256_add_ps(_mm256_set1_ps(SIN_2), _mm256_mul_ps(r2, _mm256_set1_ps(SIN_3)));
+    sinR = _mm256_add_ps(_mm256_set1_ps(SIN_1), _mm256_mul_ps(r2, sinR));
+    sinR = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r2, r), sinR));
+
+    auto cosR = _mm256_add_ps(_mm256_set1_ps(COS_2), _mm256_mul_ps(r2, _mm256_set1_ps(COS_3)));
+    cosR = _mm256_add_ps(_mm256_set1_ps(COS_1), _mm256_mul_ps(r2, cosR));
+    cosR = _mm256_mul_ps(_mm256_mul_ps(r2, r2), cosR);
+    cosR = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(r2, _mm256_set1_ps(0.5f))), cosR);
+
+    // Odd quadrants swap sin and cos, then fix the signs
+    auto one = _mm256_set1_epi32(1);
+    auto two = _mm256_set1_epi32(2);
+    auto swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(qi, one), one));
+
+    auto s = _mm256_blendv_ps(sinR, cosR, swap);
+    auto c = _mm256_blendv_ps(cosR, sinR, swap);
+
+    auto sinSign = _mm256_slli_epi32(_mm256_and_si256(qi, two), 30);
+    auto cosSign = _mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(qi, one), two), 30);
+
+    sinOut = _mm256_xor_ps(s, _mm256_castsi256_ps(sinSign));
+    cosOut = _mm256_xor_ps(c, _mm256_castsi256_ps(cosSign));
+}
+
+void buildInstances(const float* x, const float* y, const float* width, const float* height, const float* rotation, const vec4* color, size_t count, Instance2D* out)
+{
+    size_t i = 0;
+    auto sign = _mm256_set1_ps(-0.0f);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 s, c;
+        sinCos(_mm256_loadu_ps(rotation + i), s, c);
+
+        auto w = _mm256_loadu_ps(width + i);
+        auto h = _mm256_loadu_ps(height + i);
+        auto tx = _mm256_loadu_ps(x + i);
+        auto ty = _mm256_loadu_ps(y + i);
+
+        auto b0 = _mm256_mul_ps(c, w);
+        auto b1 = _mm256_mul_ps(s, w);
+        auto b2 = _mm256_xor_ps(_mm256_mul_ps(s, h), sign);
+        auto b3 = _mm256_mul_ps(c, h);
+
+        storeInstances(_mm256_castps256_ps128(b0), _mm256_castps256_ps128(b1), _mm256_castps256_ps128(b2), _mm256_castps256_ps128(b3), _mm256_castps256_ps128(tx), _mm256_castps256_ps128(ty), color + i, out + i);
+        storeInstances(_mm256_extractf128_ps(b0, 1), _mm256_extractf128_ps(b1, 1), _mm256_extractf128_ps(b2, 1), _mm256_extractf128_ps(b3, 1), _mm256_extractf128_ps(tx, 1), _mm256_extractf128_ps(ty, 1), color + i + 4, out + i + 4);
+    }
+
+    buildInstancesScalar(x + i, y + i, width + i, height + i, rotation + i, color + i, count - i, out + i);
+}
+
+#elif defined(TRANSFORM_BATCH_SSE2)
+
+static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+static inline void sinCos(__m128 x, __m128& sinOut, __m128& cosOut)
+{
+    // x = r + q * pi / 2
+    auto qi = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI)));
+    auto q = _mm_cvtepi32_ps(qi);
+
+    auto r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(HALF_PI_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(HALF_PI_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(HALF_PI_3)));
+
+    auto r2 = _mm_mul_ps(r, r);
+
+    auto sinR = _mm_add_ps(_mm_set1_ps(SIN_2), _mm_mul_ps(r2, _mm_set1_ps(SIN_3)));
+    sinR = _mm_add_ps(_mm_set1_ps(SIN_1), _mm_mul_ps(r2, sinR));
+    sinR = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r2, r), sinR));
+
+    auto cosR = _mm_add_ps(_mm_set1_ps(COS_2), _mm_mul_ps(r2, _mm_set1_ps(COS_3)));
+    cosR = _mm_add_ps(_mm_set1_ps(COS_1), _mm_mul_ps(r2, cosR));
+    cosR = _mm_mul_ps(_mm_mul_ps(r2, r2), cosR);
+    cosR = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, _mm_set1_ps(0.5f))), cosR);
+
+    // Odd quadrants swap sin and cos, then fix the signs
+    auto one = _mm_set1_epi32(1);
+    auto two = _mm_set1_epi32(2);
+    auto swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(qi, one), one));
+
+    auto s = select(swap, sinR, cosR);
+    auto c = select(swap, cosR, sinR);
+
+    auto sinSign = _mm_slli_epi32(_mm_and_si128(qi, two), 30);
+    auto cosSign = _mm_slli_epi32(_mm_and_si128(_mm_add_epi32(qi, one), two), 30);
+
+    sinOut = _mm_xor_ps(s, _mm_castsi128_ps(sinSign));
+    cosOut = _mm_xor_ps(c, _mm_castsi128_ps(cosSign));
+}
+
+void buildInstances(const float* x, const float* y, const float* width, const float* height, const float* rotation, const vec4* color, size_t count, Instance2D* out)
+{
+    size_t i = 0;
+    auto sign = _mm_set1_ps(-0.0f);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 s, c;
+        sinCos(_mm_loadu_ps(rotation + i), s, c);
+
+        auto w = _mm_loadu_ps(width + i);
+        auto h = _mm_loadu_ps(height + i);
+
+        auto b0 = _mm_mul_ps(c, w);
+        auto b1 = _mm_mul_ps(s, w);
+        auto b2 = _mm_xor_ps(_mm_mul_ps(s, h), sign);
+        auto b3 = _mm_mul_ps(c, h);
+
+        storeInstances(b0, b1, b2, b3, _mm_loadu_ps(x + i), _mm_loadu_ps(y + i), color + i, out + i);
+    }
+
+    buildInstancesScalar(x + i, y + i, width + i, height + i, rotation + i, color + i, count - i, out + i);
+}
+
+#else
+
+void buildInstances(const float* x, const float* y, const float* width, const float* height, const float* rotation, const vec4* color, size_t count, Instance2D* out)
+{
+    buildInstancesScalar(x, y, width, height, rotation, color, count, out);
+}
+
+#endif
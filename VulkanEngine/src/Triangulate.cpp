@@ -0,0 +1,292 @@
+#include "Triangulate.hpp"
+
+#include "CDT.h"
+
+// Past some size ear clipping's O(n^2) loses to CDT. 64 is a guess that hasn't been
+// measured yet, run the triangulation benchmark against the real CDT and set it from that.
+constexpr size_t EAR_CLIP_MAX_POINTS = 64;
+
+static inline float cross2(vec2 a, vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+static float signedArea(const vec2* points, size_t count)
+{
+    float area = 0;
+    for (size_t i = 0, j = count - 1; i < count; j = i++)
+    {
+        area += cross2(points[j], points[i]);
+    }
+
+    return area * 0.5f;
+}
+
+// O(n^2), only used on outlines small enough for ear clipping
+static bool isSimple(const vec2* points, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        auto a = points[i];
+        auto b = points[(i + 1) % count];
+
+        // Neighbouring edges always share a point, so skip them
+        for (size_t j = i + 2; j < count && !(i == 0 && j == count - 1); j++)
+        {
+            auto c = points[j];
+            auto d = points[(j + 1) % count];
+
+            auto o1 = cross2(b - a, c - a);
+            auto o2 = cross2(b - a, d - a);
+            auto o3 = cross2(d - c, a - c);
+            auto o4 = cross2(d - c, b - c);
+
+            if (((o1 > 0 && o2 < 0) || (o1 < 0 && o2 > 0)) && ((o3 > 0 && o4 < 0) || (o3 < 0 && o4 > 0)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool isConvex(const vec2* points, size_t count)
+{
+    if (count < 3)
+    {
+        return false;
+    }
+
+    float turn = 0;
+    int xFlips = 0;
+    int yFlips = 0;
+    float lastX = 0;
+    float lastY = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        auto a = points[i];
+        auto b = points[(i + 1) % count];
+        auto c = points[(i + 2) % count];
+
+        auto cross = cross2(b - a, c - b);
+        if (cross != 0)
+        {
+            if (turn != 0 && (cross > 0) != (turn > 0))
+            {
+                return false;
+            }
+
+            turn = cross;
+        }
+
+        // A convex outline changes horizontal and vertical direction twice each at most
+        auto d = c - b;
+        if (d.x != 0)
+        {
+            xFlips += lastX != 0 && (d.x > 0) != (lastX > 0);
+            lastX = d.x;
+        }
+
+        if (d.y != 0)
+        {
+            yFlips += lastY != 0 && (d.y > 0) != (lastY > 0);
+            lastY = d.y;
+        }
+    }
+
+    return xFlips <= 2 && yFlips <= 2;
+}
+
+void triangulateFan(size_t count, vector<uint32_t>& indices)
+{
+    for (uint32_t i = 1; i + 1 < count; i++)
+    {
+        indices.insert(indices.end(), { 0, i, i + 1 });
+    }
+}
+
+bool triangulateEarClip(const vec2* points, size_t count, vector<uint32_t>& indices)
+{
+    if (count < 3)
+    {
+        return false;
+    }
+
+    auto area = signedArea(points, count);
+    if (area == 0 || !isSimple(points, count))
+    {
+        return false;
+    }
+
+    // Work counter clockwise
+    vector<uint32_t> remaining(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        remaining[i] = area > 0 ? i : static_cast<uint32_t>(count - 1 - i);
+    }
+
+    auto start = indices.size();
+
+    size_t i = 0;
+    size_t sinceLastEar = 0;
+
+    while (remaining.size() > 3)
+    {
+        // Went all the way around without an ear, so it isn't simple
+        if (sinceLastEar > remaining.size())
+        {
+            indices.resize(start);
+            return false;
+        }
+
+        auto n = remaining.size();
+        auto prev = remaining[(i + n - 1) % n];
+        auto cur = remaining[i % n];
+        auto next = remaining[(i + 1) % n];
+
+        auto a = points[prev];
+        auto b = points[cur];
+        auto c = points[next];
+
+        bool ear = cross2(b - a, c - b) > 0;
+
+        for (size_t j = 0; ear && j < n; j++)
+        {
+            auto k = remaining[j];
+            if (k == prev || k == cur || k == next)
+            {
+                continue;
+            }
+
+            auto p = points[k];
+            if (p == a || p == b || p == c)
+            {
+                continue;
+            }
+
+            if (cross2(b - a, p - a) >= 0 && cross2(c - b, p - b) >= 0 && cross2(a - c, p - c) >= 0)
+            {
+                ear = false;
+            }
+        }
+
+        if (ear)
+        {
+            indices.insert(indices.end(), { prev, cur, next });
+
+            // Step back so the previous vertex gets checked again
+            auto removed = i % n;
+            remaining.erase(remaining.begin() + removed);
+            i = removed > 0 ? removed - 1 : n - 2;
+            sinceLastEar = 0;
+        }
+        else
+        {
+            i = (i + 1) % n;
+            sinceLastEar++;
+        }
+    }
+
+    indices.insert(indices.end(), { remaining[0], remaining[1], remaining[2] });
+    return true;
+}
+
+void triangulateCDT(const vec2* points, size_t count, const vector<pair<uint32_t, uint32_t>>& edges, vector<uint32_t>& indices, vector<vec2>& added)
+{
+    auto getX = [](const vec2& p) { return p.x; };
+    auto getY = [](const vec2& p) { return p.y; };
+    auto getStart = [](const pair<uint32_t, uint32_t>& e) { return e.first; };
+    auto getEnd = [](const pair<uint32_t, uint32_t>& e) { return e.second; };
+    auto makeEdge = [](CDT::VertInd a, CDT::VertInd b) { return pair<uint32_t, uint32_t>(a, b); };
+
+    // CDT can't take the same point twice, so those are merged and mapped back after
+    vector<vec2> vertices(points, points + count);
+    auto constraints = edges;
+    auto duplicates = CDT::RemoveDuplicatesAndRemapEdges<float>(vertices, getX, getY, constraints.begin(), constraints.end(), getStart, getEnd, makeEdge);
+
+    // Edges between merged points are gone
+    erase_if(constraints, [](const pair<uint32_t, uint32_t>& e) { return e.first == e.second; });
+
+    vector<uint32_t> original(vertices.size());
+    for (size_t i = count; i-- > 0;)
+    {
+        original[duplicates.mapping[i]] = static_cast<uint32_t>(i);
+    }
+
+    // Self intersecting outlines are split where their edges cross
+    CDT::Triangulation<float> cdt(CDT::VertexInsertionOrder::Auto, CDT::IntersectingConstraintEdges::TryResolve, 0);
+    cdt.insertVertices(vertices.begin(), vertices.end(), getX, getY);
+
+    if (constraints.empty())
+    {
+        // Nothing to tell inside from outside, so fill the hull
+        cdt.eraseSuperTriangle();
+    }
+    else
+    {
+        cdt.insertEdges(constraints.begin(), constraints.end(), getStart, getEnd);
+        cdt.eraseOuterTrianglesAndHoles();
+    }
+
+    added.clear();
+    for (size_t i = vertices.size(); i < cdt.vertices.size(); i++)
+    {
+        added.emplace_back(cdt.vertices[i].x, cdt.vertices[i].y);
+    }
+
+    auto remap = [&](CDT::VertInd i) { return i < vertices.size() ? original[i] : static_cast<uint32_t>(count + i - vertices.size()); };
+
+    for (const auto& i : cdt.triangles)
+    {
+        indices.insert(indices.end(), { remap(i.vertices[0]), remap(i.vertices[1]), remap(i.vertices[2]) });
+    }
+}
+
+static void addRing(uint32_t first, size_t count, vector<pair<uint32_t, uint32_t>>& edges)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        edges.emplace_back(first + i, first + static_cast<uint32_t>((i + 1) % count));
+    }
+}
+
+TriangulationMethod triangulatePolygon(const vec2* points, size_t count, vector<uint32_t>& indices, vector<vec2>& added)
+{
+    added.clear();
+
+    if (isConvex(points, count))
+    {
+        triangulateFan(count, indices);
+        return TriangulationMethod::Fan;
+    }
+
+    if (count <= EAR_CLIP_MAX_POINTS && triangulateEarClip(points, count, indices))
+    {
+        return TriangulationMethod::EarClip;
+    }
+
+    vector<pair<uint32_t, uint32_t>> edges;
+    addRing(0, count, edges);
+    triangulateCDT(points, count, edges, indices, added);
+    return TriangulationMethod::CDT;
+}
+
+void triangulatePolygon(const vector<vec2>& outline, const vector<vector<vec2>>& holes, const vector<pair<uint32_t, uint32_t>>& edges, vector<uint32_t>& indices, vector<vec2>& added)
+{
+    vector<vec2> points = outline;
+    vector<pair<uint32_t, uint32_t>> allEdges;
+
+    addRing(0, outline.size(), allEdges);
+
+    for (const auto& i : holes)
+    {
+        addRing(static_cast<uint32_t>(points.size()), i.size(), allEdges);
+        points.insert(points.end(), i.begin(), i.end());
+    }
+
+    allEdges.insert(allEdges.end(), edges.begin(), edges.end());
+
+    triangulateCDT(points.data(), points.size(), allEdges, indices, added);
+}
@@ -15,7 +15,7 @@ UniformSet::UniformSet(Pipeline* pipeline, vki::DescriptorSetLayout& descriptorL
         uniformBuffers.push_back({0});
         uniformBuffersMemory.push_back({0});
 
-        pipeline->renderer->createBuffer(uboSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, uniformBuffers[i], uniformBuffersMemory[i]);
+        pipeline->renderer->createBuffer(uboSize, vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, uniformBuffers[i], uniformBuffersMemory[i], MemoryCategory::Uniforms);
         uniformBuffersMapped.push_back(uniformBuffersMemory[i].mapMemory(0, uboSize));
     }
 
@@ -32,7 +32,13 @@ UniformSet::UniformSet(Pipeline* pipeline, vki::DescriptorSetLayout& descriptorL
 
 void UniformSet::setUBO(void* ubo)
 {
-    memcpy(uniformBuffersMapped[pipeline->renderer->currentFlightFrame], ubo, uboSize);
+    memcpy(getMappedUBO(), ubo, uboSize);
+}
+
+void* UniformSet::getMappedUBO()
+{
+    pipeline->renderer->stats.uploadBytes += uboSize;
+    return uniformBuffersMapped[pipeline->renderer->currentFlightFrame];
 }
 
 void UniformSet::bind(vki::CommandBuffer& cmds)
@@ -2,7 +2,7 @@
 
 
 
-Window::Window(string title, int width, int height)
+Window::Window(string title, int width, int height, RendererSettings settings)
 {
     glfwInit();
 
@@ -11,7 +11,7 @@ Window::Window(string title, int width, int height)
 
     window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
 
-    renderer = make_unique<Renderer>(title, window);
+    renderer = make_unique<Renderer>(title, window, settings);
 }
 
 Window::~Window()
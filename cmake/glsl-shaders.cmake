@@ -25,10 +25,34 @@ else()
     message(STATUS "glslangValidator not found!")
 endif()
 
+set(GLSL_SHADERS_SCRIPT_DIR ${CMAKE_CURRENT_LIST_DIR} CACHE INTERNAL "")
+
+# Generates <shader>.h with the compiled SPIR-V as a constexpr uint32_t array named
+# after the file, e.g. shader.vert becomes shader_vert_spv. The headers go in a spirv
+# directory in the target's binary dir, which is added as a private include directory.
+function(_glsl_spirv_header TARGET_NAME GLSL_FILE SPV_FILE)
+    cmake_path(GET GLSL_FILE FILENAME SHADER_NAME)
+    cmake_path(ABSOLUTE_PATH SPV_FILE BASE_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR} NORMALIZE)
+    string(MAKE_C_IDENTIFIER "${SHADER_NAME}_spv" SPIRV_NAME)
+
+    set(HEADER_DIR ${CMAKE_CURRENT_BINARY_DIR}/spirv)
+    set(HEADER ${HEADER_DIR}/${SHADER_NAME}.h)
+
+    add_custom_command(
+        OUTPUT ${HEADER}
+        COMMAND ${CMAKE_COMMAND} -DINPUT=${SPV_FILE} -DOUTPUT=${HEADER} -DNAME=${SPIRV_NAME}
+        -P ${GLSL_SHADERS_SCRIPT_DIR}/spirv-header.cmake
+        DEPENDS ${SPV_FILE} ${GLSL_SHADERS_SCRIPT_DIR}/spirv-header.cmake)
+
+    target_sources(${TARGET_NAME} PRIVATE ${HEADER})
+    target_include_directories(${TARGET_NAME} PRIVATE ${HEADER_DIR})
+endfunction()
+
 # This function acts much like the 'target_sources' function, as in raw GLSL
 # shader files can be passed in and will be compiled using 'glslangValidator',
 # provided it is available, where the compiled files will be located where the
-# sources files are but with the '.spv' suffix appended.
+# sources files are but with the '.spv' suffix appended. Each one also gets a
+# generated header with the SPIR-V embedded, see _glsl_spirv_header.
 #
 # The first argument is the target that the files are associated with, and will
 # be compiled as if it were a source file for it. All provided shaders are also
@@ -75,6 +99,7 @@ function(target_glsl_shaders TARGET_NAME)
             MAIN_DEPENDENCY ${GLSL_FILE})
 
         target_sources(${TARGET_NAME} INTERFACE ${GLSL_FILE}.spv)
+        _glsl_spirv_header(${TARGET_NAME} ${GLSL_FILE} ${GLSL_FILE}.spv)
     endforeach()
 
     foreach(GLSL_FILE IN LISTS target_glsl_shaders_PUBLIC)
@@ -86,6 +111,7 @@ function(target_glsl_shaders TARGET_NAME)
             MAIN_DEPENDENCY ${GLSL_FILE})
 
         target_sources(${TARGET_NAME} PUBLIC ${GLSL_FILE})
+        _glsl_spirv_header(${TARGET_NAME} ${GLSL_FILE} ${GLSL_FILE}.spv)
     endforeach()
 
     foreach(GLSL_FILE IN LISTS target_glsl_shaders_PRIVATE)
@@ -96,5 +122,6 @@ function(target_glsl_shaders TARGET_NAME)
             MAIN_DEPENDENCY ${GLSL_FILE})
 
         target_sources(${TARGET_NAME} PRIVATE ${GLSL_FILE}.spv)
+        _glsl_spirv_header(${TARGET_NAME} ${GLSL_FILE} ${GLSL_FILE}.spv)
     endforeach()
 endfunction()
\ No newline at end of file
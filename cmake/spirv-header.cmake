@@ -0,0 +1,19 @@
+# Writes a SPIR-V binary out as a C++ header with a constexpr uint32_t array, so
+# shaders can be built into the executable instead of loaded at runtime.
+#
+# Run with cmake -P and:
+# INPUT - The .spv file
+# OUTPUT - The header to write
+# NAME - Name of the array
+
+file(READ "${INPUT}" SPIRV HEX)
+
+# SPIR-V is a stream of little endian words
+string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1, " WORDS "${SPIRV}")
+# CMake regexes have no {n}, so spell out 8 words per line
+string(REPEAT "0x[0-9a-f]+, " 8 LINE)
+string(REGEX REPLACE "(${LINE})" "\\1\n    " WORDS "${WORDS}")
+string(REGEX REPLACE " +\n" "\n" WORDS "${WORDS}")
+string(STRIP "${WORDS}" WORDS)
+
+file(WRITE "${OUTPUT}" "// Generated from ${INPUT}\n#pragma once\n\n#include <cstdint>\n\nconstexpr uint32_t ${NAME}[] = {\n    ${WORDS}\n};\n")